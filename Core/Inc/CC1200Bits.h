@@ -87,21 +87,19 @@
 #define PKT_CFG0_PKT_BIT_LEN 2
 #define PKT_CFG0_UART_MODE_EN 1
 #define PKT_CFG0_UART_SWAP_EN 0
-#define PKT_CFG0_PKT_FORMAT 0
-#define PKT_CFG0_APPEND_STATUS 0
 
 #define RFEND_CFG1_RXOFF_MODE 4
 #define RFEND_CFG1_RX_TIME 1
 #define RFEND_CFG1_RX_TIME_QUAL 0
 
-#define RFEND_CFG0_RXOFF_MODE 2
-#define RFEND_CFG0_RX_TIME 0
-
 #define RFEND_CFG0_CAL_END_WAKE_UP_EN 6
 #define RFEND_CFG0_TXOFF_MODE 4
 #define RFEND_CFG0_TERM_ON_BAD_PACKET_EN 3
 #define RFEND_CFG0_ANT_DIV_RX_TERM_CFG 0
 
+#define FIFO_CFG_CRC_AUTOFLUSH 7
+#define FIFO_CFG_FIFO_THR 0
+
 #define FS_CFG_FS_LOCK_EN 4
 #define FS_CFG_FSD_BANDSELECT 0
 
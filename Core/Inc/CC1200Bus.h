@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2019-2023 USC Rocket Propulsion Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CC1200_CC1200BUS_H
+#define CC1200_CC1200BUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/**
+ *  Platform services used by the CC1200 driver: the SPI bus and chip select, the reset
+ *  line, delays and a timestamp counter.  CC1200HALBus binds them to the STM32 HAL;
+ *  other implementations let the driver run against a model of the chip.
+ */
+class CC1200Bus
+{
+public:
+    // SPI clock classes.  The chip accepts a faster clock for most transactions than
+    // for reads from extended memory.
+    enum class ClockClass : uint8_t
+    {
+        FAST,
+        EXTENDED_READ
+    };
+
+    virtual ~CC1200Bus() = default;
+
+    /**
+     * Prepare the bus for use.  Called from CC1200::begin().
+     */
+    virtual void begin() {}
+
+    /**
+     * Assert chip select, opening a transaction
+     * @param clockClass SPI clock to use until deselect()
+     */
+    virtual void select(ClockClass clockClass) = 0;
+
+    /**
+     * Wait for the bus to go idle and release chip select, ending the transaction
+     */
+    virtual void deselect() = 0;
+
+    /**
+     * Blocking full duplex transfer within the current transaction
+     * @param txData Bytes to send, or nullptr to send zeros
+     * @param rxData Buffer for the received bytes, or nullptr to discard them
+     * @param len Number of bytes
+     * @return true on success
+     */
+    virtual bool transfer(uint8_t const* txData, uint8_t* rxData, size_t len) = 0;
+
+    /**
+     * Blocking write that leaves at least the given gap between bytes on the bus
+     * @param data Bytes to send
+     * @param len Number of bytes
+     * @param gapNs Minimum time between the end of one byte and the start of the next
+     * @return true on success
+     */
+    virtual bool writePaced(uint8_t const* data, size_t len, uint32_t gapNs) = 0;
+
+    /**
+     * Start a transfer in the background within the current transaction.  Completion is
+     * reported through the handler set with setTransferCompleteHandler().  Without
+     * rxData the transfer is transmit only; without txData a constant zero byte is sent.
+     * @param txData Bytes to send, or nullptr to send zeros; must stay valid until completion
+     * @param rxData Buffer for the received bytes, or nullptr to discard them; must stay
+     *               valid until completion
+     * @param len Number of bytes
+     * @return true if the transfer was started
+     */
+    virtual bool startTransfer(uint8_t const* txData, uint8_t* rxData, size_t len) = 0;
+
+    /**
+     * Start a background transfer that the SPI interrupt moves a byte at a time instead of
+     * DMA.  Otherwise the same as startTransfer(), and reported the same way.  Without
+     * txData the bytes sent are unspecified, so it is only for transfers where the chip
+     * ignores them.
+     * @param txData Bytes to send, or nullptr; must stay valid until completion
+     * @param rxData Buffer for the received bytes, or nullptr to discard them; must stay
+     *               valid until completion
+     * @param len Number of bytes
+     * @return true if the transfer was started
+     */
+    virtual bool startTransferIT(uint8_t const* txData, uint8_t* rxData, size_t len) = 0;
+
+    /**
+     * Stop a background transfer started with startTransfer() or startTransferIT(), e.g.
+     * one whose completion never came.  Its completion is not reported.  The transaction
+     * stays open.
+     */
+    virtual void abortTransfer() = 0;
+
+    /**
+     * Get ready to wait for a background transfer.  Call before starting the transfer,
+     * so a wakeWaiter() that comes before waitUntil() is not lost.
+     */
+    virtual void prepareWait() {}
+
+    /**
+     * Wait until a condition set by a background transfer's completion holds.  This
+     * version spins on the timestamp counter; a bus on an RTOS can block the calling
+     * task until wakeWaiter() instead.
+     * @param done Condition to wait for; checked again after every wake
+     * @param timeoutUs Longest time to wait
+     * @return true if the condition holds, false on timeout
+     */
+    virtual bool waitUntil(std::function<bool()> const& done, uint32_t timeoutUs)
+    {
+        uint32_t const start = getTimestamp();
+        uint32_t const timeoutTicks = timeoutUs * (getTimestampFrequency() / 1000000);
+        while(!done())
+        {
+            if(getTimestamp() - start > timeoutTicks)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Wake a task blocked in waitUntil().  May be called from interrupt context.
+     */
+    virtual void wakeWaiter() {}
+
+    /**
+     * Set the function called when a background transfer finishes.  It may be called
+     * from interrupt context.
+     * @param handler Called with true on success, false on error
+     */
+    void setTransferCompleteHandler(std::function<void(bool)> handler) { transferCompleteHandler = handler; }
+
+    /**
+     * Get the SPI clock used for a transaction class
+     * @param clockClass Transaction class
+     * @return SPI clock frequency in Hz
+     */
+    virtual uint32_t getClockFrequency(ClockClass clockClass) const = 0;
+
+    /**
+     * Drive the chip's reset line
+     * @param asserted true to hold the chip in reset
+     */
+    virtual void setReset(bool asserted) = 0;
+
+    /**
+     * Wait for at least the given time, yielding to other tasks if possible
+     * @param ms Delay in milliseconds
+     */
+    virtual void delayMs(uint32_t ms) = 0;
+
+    /**
+     * Get a millisecond tick count
+     * @return Milliseconds since an arbitrary epoch
+     */
+    virtual uint32_t getMillis() = 0;
+
+    /**
+     * Get a free running high resolution counter, which wraps at 2^32
+     * @return Counter value
+     */
+    virtual uint32_t getTimestamp() = 0;
+
+    /**
+     * Get the rate of the getTimestamp() counter
+     * @return Counts per second
+     */
+    virtual uint32_t getTimestampFrequency() const = 0;
+
+protected:
+    // Called by implementations when a background transfer finishes
+    void signalTransferComplete(bool success)
+    {
+        if(transferCompleteHandler)
+        {
+            transferCompleteHandler(success);
+        }
+    }
+
+private:
+    std::function<void(bool)> transferCompleteHandler;
+};
+
+#endif //CC1200_CC1200BUS_H
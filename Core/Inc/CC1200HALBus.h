@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2019-2023 USC Rocket Propulsion Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CC1200_CC1200HALBUS_H
+#define CC1200_CC1200HALBUS_H
+
+#include "CC1200Bus.h"
+#include "stm32f4xx_hal.h"
+#include "cmsis_os.h"
+
+/**
+ *  CC1200 bus on an STM32 SPI peripheral in master mode, with chip select on the
+ *  hardware NSS output, using the STM32 HAL and FreeRTOS.
+ */
+class CC1200HALBus : public CC1200Bus
+{
+private:
+    // STM32 HAL handles
+    SPI_HandleTypeDef* hspi;
+    GPIO_TypeDef* csPort;
+    uint16_t csPin;
+    GPIO_TypeDef* rstPort;
+    uint16_t rstPin;
+
+    // SPI CR1 baud rate bits for each clock class.  At a 96MHz kernel clock both come out
+    // as /16 (6MHz); see SPI_MAX_FREQ.
+    uint32_t fastPrescaler = SPI_BAUDRATEPRESCALER_256;
+    uint32_t extReadPrescaler = SPI_BAUDRATEPRESCALER_256;
+
+    // Transfers up to this many bytes use the polled register-level path instead of the HAL
+    size_t polledMaxLen;
+
+    // Released by wakeWaiter() for the task blocked in waitUntil().  Created on first use
+    // once the scheduler runs; until then, and in interrupt context, waits spin.
+    osSemaphoreId_t wakeSemaphore = nullptr;
+    bool canBlock();
+
+    void configureClocks();
+
+    // Polled full duplex transfer on the SPI data and status registers, for the short
+    // transactions where HAL call overhead dominates.  If gapCycles is nonzero, each byte
+    // waits for the previous one to finish plus that many cycles instead of being pipelined.
+    bool polledTransfer(uint8_t const* txData, uint8_t* rxData, size_t len, uint32_t gapCycles);
+
+public:
+    /**
+     * Constructor for the STM32 HAL bus
+     * @param hspi_handle Pointer to SPI handle
+     * @param cs_port GPIO port for chip select pin
+     * @param cs_pin GPIO pin for chip select
+     * @param rst_port GPIO port for reset pin
+     * @param rst_pin GPIO pin for reset
+     */
+    CC1200HALBus(SPI_HandleTypeDef* hspi_handle,
+                 GPIO_TypeDef* cs_port, uint16_t cs_pin,
+                 GPIO_TypeDef* rst_port, uint16_t rst_pin);
+
+    void begin() override;
+    void select(ClockClass clockClass) override;
+    void deselect() override;
+    bool transfer(uint8_t const* txData, uint8_t* rxData, size_t len) override;
+    bool writePaced(uint8_t const* data, size_t len, uint32_t gapNs) override;
+    bool startTransfer(uint8_t const* txData, uint8_t* rxData, size_t len) override;
+    bool startTransferIT(uint8_t const* txData, uint8_t* rxData, size_t len) override;
+    void abortTransfer() override;
+    uint32_t getClockFrequency(ClockClass clockClass) const override;
+    void setReset(bool asserted) override;
+    void delayMs(uint32_t ms) override;
+    uint32_t getMillis() override;
+    uint32_t getTimestamp() override;
+    uint32_t getTimestampFrequency() const override;
+    void prepareWait() override;
+    bool waitUntil(std::function<bool()> const& done, uint32_t timeoutUs) override;
+    void wakeWaiter() override;
+
+    /**
+     * Get the SPI handle this bus drives
+     * @return SPI handle
+     */
+    SPI_HandleTypeDef* getSPI() { return hspi; }
+
+    /**
+     * Set the largest SPI transfer that uses the polled register-level path.  Longer
+     * transfers go through the HAL driver.
+     * @param maxLen Threshold in bytes; 0 sends every transfer through the HAL
+     */
+    void setPolledMaxLen(size_t maxLen) { polledMaxLen = maxLen; }
+
+    /**
+     * Get the largest SPI transfer that uses the polled register-level path
+     * @return Threshold in bytes
+     */
+    size_t getPolledMaxLen() const { return polledMaxLen; }
+
+    /**
+     * DMA or interrupt driven transfer complete callback (called from the HAL SPI callbacks)
+     */
+    void dmaTransferCompleteCallback() { signalTransferComplete(true); }
+
+    /**
+     * DMA or interrupt driven transfer error callback (called from the HAL SPI callbacks)
+     */
+    void dmaTransferErrorCallback() { signalTransferComplete(false); }
+};
+
+#endif //CC1200_CC1200HALBUS_H
@@ -0,0 +1,419 @@
+/*
+ * Copyright (c) 2019-2023 USC Rocket Propulsion Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Compile-time PHY profiles for the CC1200.
+//
+// A CC1200PhyProfile describes a radio configuration in physical units.  compileCC1200Profile()
+// turns it into a complete register image (standard registers 0x00-0x2E and extended
+// registers 0x00-0x39) plus a report of the values the chip will actually achieve, so
+// that CC1200::begin() / applyProfile() only have to burst the image to the chip.
+// The same calculation functions are used by the runtime setters.
+//
+
+#ifndef CC1200_CC1200PROFILE_H
+#define CC1200_CC1200PROFILE_H
+
+#include "CC1200_HAL.h"
+#include "CC1200Bits.h"
+
+#include <array>
+#include <cstdint>
+
+// frequency of the chip's crystal oscillator
+#define CC1200_OSC_FREQ 40000000 // hz
+
+// Register settings for one symbol rate.  See user guide section 5.1, equation 4.
+struct CC1200SymbolRateSetting
+{
+    bool valid;
+    uint8_t exponent; // SRATE_E
+    uint32_t mantissa; // SRATE_M, 20 bits
+    float actualHz;
+};
+
+// Register settings for one FSK deviation.  See user guide section 5.2.1, equation 5.
+struct CC1200DeviationSetting
+{
+    bool valid;
+    uint8_t exponent; // DEV_E
+    uint8_t mantissa; // DEV_M
+    float actualHz;
+};
+
+// Register settings for one carrier frequency.  See user guide section 9.12, equation 21.
+struct CC1200FrequencySetting
+{
+    bool valid;
+    uint8_t bandSelect; // FS_CFG.FSD_BANDSELECT
+    uint32_t freq; // FREQ2..FREQ0, 24 bits
+    float actualHz;
+};
+
+// Register settings for one RX filter bandwidth.  See user guide section 6.1, equation 10.
+struct CC1200RXBandwidthSetting
+{
+    bool valid;
+    uint8_t adcCicDecfact; // CHAN_BW.ADC_CIC_DECFACT table index
+    uint8_t bbCicDecfact; // CHAN_BW.BB_CIC_DECFACT
+    float actualHz;
+};
+
+// helper function: integer division rounded to nearest
+constexpr uint64_t cc1200RoundedDiv(uint64_t num, uint64_t den)
+{
+    return (num + den / 2) / den;
+}
+
+constexpr CC1200SymbolRateSetting calcCC1200SymbolRate(uint32_t symbolRateHz)
+{
+    // SRATE_E > 0: Rs = (2^20 + SRATE_M) * 2^SRATE_E * fxosc / 2^39
+    for(uint8_t exponent = 15; exponent >= 1; --exponent)
+    {
+        uint64_t m = cc1200RoundedDiv(static_cast<uint64_t>(symbolRateHz) << (39 - exponent), CC1200_OSC_FREQ);
+        if(m >= (1ULL << 20) && m < (1ULL << 21))
+        {
+            float actual = static_cast<float>(m) * static_cast<float>(1ULL << exponent) *
+                           (static_cast<float>(CC1200_OSC_FREQ) / static_cast<float>(1ULL << 39));
+            return {true, exponent, static_cast<uint32_t>(m - (1ULL << 20)), actual};
+        }
+    }
+
+    // SRATE_E = 0: Rs = SRATE_M * fxosc / 2^38
+    uint64_t m = cc1200RoundedDiv(static_cast<uint64_t>(symbolRateHz) << 38, CC1200_OSC_FREQ);
+    if(m == 0 || m >= (1ULL << 20))
+    {
+        return {false, 0, 0, 0.0f};
+    }
+    float actual = static_cast<float>(m) * (static_cast<float>(CC1200_OSC_FREQ) / static_cast<float>(1ULL << 38));
+    return {true, 0, static_cast<uint32_t>(m), actual};
+}
+
+constexpr CC1200DeviationSetting calcCC1200Deviation(uint32_t deviationHz)
+{
+    // DEV_E > 0: fdev = fxosc * (256 + DEV_M) * 2^DEV_E / 2^22
+    for(uint8_t exponent = 7; exponent >= 1; --exponent)
+    {
+        uint64_t m = cc1200RoundedDiv(static_cast<uint64_t>(deviationHz) << (22 - exponent), CC1200_OSC_FREQ);
+        if(m >= 256 && m < 512)
+        {
+            float actual = static_cast<float>(m) * static_cast<float>(1U << exponent) *
+                           (static_cast<float>(CC1200_OSC_FREQ) / static_cast<float>(1ULL << 22));
+            return {true, exponent, static_cast<uint8_t>(m - 256), actual};
+        }
+    }
+
+    // DEV_E = 0: fdev = fxosc * DEV_M / 2^21
+    uint64_t m = cc1200RoundedDiv(static_cast<uint64_t>(deviationHz) << 21, CC1200_OSC_FREQ);
+    if(m >= 256)
+    {
+        return {false, 0, 0, 0.0f};
+    }
+    float actual = static_cast<float>(m) * (static_cast<float>(CC1200_OSC_FREQ) / static_cast<float>(1ULL << 21));
+    return {true, 0, static_cast<uint8_t>(m), actual};
+}
+
+constexpr CC1200FrequencySetting calcCC1200Frequency(CC1200::Band band, uint32_t frequencyHz)
+{
+    uint32_t loDivider = 0;
+    uint8_t bandSelect = 0;
+    uint32_t minHz = 0;
+    uint32_t maxHz = 0;
+
+    switch(band)
+    {
+        case CC1200::Band::BAND_820_960MHz:
+            loDivider = 4;
+            bandSelect = 0b0010;
+            minHz = 820000000;
+            maxHz = 960000000;
+            break;
+
+        case CC1200::Band::BAND_410_480MHz:
+        case CC1200::Band::BAND_410_480MHz_HIGH_IF:
+            loDivider = 8;
+            bandSelect = 0b0100;
+            minHz = 410000000;
+            maxHz = 480000000;
+            break;
+
+        case CC1200::Band::BAND_136_160MHz:
+            loDivider = 24;
+            bandSelect = 0b1011;
+            minHz = 136700000;
+            maxHz = 160000000;
+            break;
+    }
+
+    if(loDivider == 0 || frequencyHz < minHz || frequencyHz > maxHz)
+    {
+        return {false, 0, 0, 0.0f};
+    }
+
+    // fRF = FREQ * fxosc / (LO divider * 2^16)
+    uint64_t freq = cc1200RoundedDiv(static_cast<uint64_t>(frequencyHz) * loDivider << 16, CC1200_OSC_FREQ);
+    float actual = static_cast<float>(freq) * (static_cast<float>(CC1200_OSC_FREQ) / static_cast<float>(loDivider << 16));
+    return {true, bandSelect, static_cast<uint32_t>(freq), actual};
+}
+
+constexpr CC1200RXBandwidthSetting calcCC1200RXBandwidth(uint32_t bandwidthHz, bool preferHigherCICDec = false)
+{
+    // RX filter BW = fxosc / (decimation factor * BB_CIC_DECFACT * 2)
+    // The user guide recommends the highest ADC decimation factor among equivalent settings.
+    constexpr uint32_t decimationFactors[] = {12, 24, 48};
+    constexpr uint8_t maxBbCicDecfact = 44;
+
+    CC1200RXBandwidthSetting best = {false, 0, 0, 0.0f};
+    uint32_t bestError = UINT32_MAX;
+
+    for(uint8_t adcIndex = 0; adcIndex < 3; ++adcIndex)
+    {
+        for(uint8_t bbCicDecfact = 1; bbCicDecfact <= maxBbCicDecfact; ++bbCicDecfact)
+        {
+            uint32_t divisor = decimationFactors[adcIndex] * bbCicDecfact * 2;
+            uint32_t bw = static_cast<uint32_t>(cc1200RoundedDiv(CC1200_OSC_FREQ, divisor));
+            uint32_t error = bw > bandwidthHz ? bw - bandwidthHz : bandwidthHz - bw;
+
+            bool tieWins = preferHigherCICDec ? bbCicDecfact > best.bbCicDecfact : adcIndex > best.adcCicDecfact;
+            if(error < bestError || (error == bestError && tieWins))
+            {
+                bestError = error;
+                best = {true, adcIndex, bbCicDecfact,
+                        static_cast<float>(CC1200_OSC_FREQ) / static_cast<float>(divisor)};
+            }
+        }
+    }
+
+    return best;
+}
+
+// Radio configuration in physical units
+struct CC1200PhyProfile
+{
+    CC1200::Band band;
+    uint32_t carrierHz;
+    uint32_t symbolRateHz;
+    uint32_t deviationHz;
+    uint32_t rxBandwidthHz;
+    CC1200::ModFormat modulation;
+
+    uint32_t syncWord; // right-aligned, sent MSB first
+    uint8_t syncWordBits; // 0, 11, 16, 18, 24 or 32
+    uint8_t syncThreshold; // SYNC_CFG1.SYNC_THR
+
+    uint8_t preambleLengthCfg; // PREAMBLE_CFG1.NUM_PREAMBLE
+    uint8_t preambleWordCfg; // PREAMBLE_CFG1.PREAMBLE_WORD
+
+    CC1200::PacketMode packetMode;
+    uint8_t packetLength; // fixed length, or maximum length in variable length mode
+    bool crcEnabled;
+    bool appendStatus;
+    bool stayInRX; // RFEND_CFG1.RXOFF_MODE: RX instead of IDLE after a packet
+};
+
+// Values the chip achieves with a compiled profile
+struct CC1200ProfileReport
+{
+    bool valid;
+    char const* error; // nullptr if valid
+    float carrierHz;
+    float symbolRateHz;
+    float deviationHz;
+    float rxBandwidthHz;
+};
+
+// Complete register image for a profile
+struct CC1200RegisterImage
+{
+    std::array<uint8_t, CC1200::NUM_REGISTERS> registers;
+    std::array<uint8_t, CC1200::NUM_EXT_CONFIG_REGISTERS> extRegisters;
+
+    // driver state implied by the image
+    CC1200::PacketMode packetMode;
+    bool appendStatus;
+
+    CC1200ProfileReport achieved;
+
+    constexpr uint8_t& operator[](CC1200::Register reg) { return registers[static_cast<uint8_t>(reg)]; }
+    constexpr uint8_t& operator[](CC1200::ExtRegister reg) { return extRegisters[static_cast<uint8_t>(reg)]; }
+};
+
+// Register reset values, user guide section 7.  Used as the base of every image.
+constexpr std::array<uint8_t, CC1200::NUM_REGISTERS> CC1200_RESET_REGISTERS = {
+    0x06, 0x07, 0x30, 0x3C, 0x93, 0x0B, 0x51, 0xDE, // 0x00 IOCFG3 - SYNC0
+    0xAA, 0x03, 0x06, 0x03, 0x4C, 0x14, 0xDA, 0xC4, // 0x08 SYNC_CFG1 - IQIC
+    0x94, 0x46, 0x0D, 0x43, 0xA9, 0x2A, 0x36, 0x00, // 0x10 CHAN_BW - AGC_CS_THR
+    0x00, 0xB1, 0x20, 0x52, 0xC3, 0x80, 0x00, 0x0B, // 0x18 AGC_GAIN_ADJUST - SETTLING_CFG
+    0x02, 0x08, 0x21, 0x00, 0x00, 0x00, 0x04, 0x03, // 0x20 FS_CFG - PKT_CFG1
+    0x00, 0x0F, 0x00, 0x7F, 0x56, 0x0F, 0x00        // 0x28 PKT_CFG0 - PKT_LEN
+};
+
+constexpr std::array<uint8_t, CC1200::NUM_EXT_CONFIG_REGISTERS> CC1200_RESET_EXT_REGISTERS = {
+    0x00, 0x20, 0x0B, 0x00, 0x00, 0x08, 0x01, 0x00, // 0x00 IF_MIX_CFG - RCCAL_FINE
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, // 0x08 RCCAL_COARSE - IF_ADC2
+    0x5A, 0x1A, 0x08, 0x5A, 0x00, 0x20, 0x00, 0x00, // 0x10 IF_ADC1 - FS_CAL0
+    0x28, 0x01, 0x00, 0x03, 0xFF, 0x1F, 0x00, 0x51, // 0x18 FS_CHP - FS_PFD
+    0x2C, 0x11, 0x00, 0x14, 0x00, 0x00, 0x00, 0x81, // 0x20 FS_PRE - FS_VCO0
+    0x00, 0x02, 0x00, 0x00, 0x10, 0x00, 0x00, 0x01, // 0x28 GBIAS6 - IFAMP
+    0x01, 0x01, 0x0C, 0xA0, 0x03, 0x04, 0x00, 0x00, // 0x30 LNA - XOSC0
+    0x00, 0x00                                      // 0x38 ANALOG_SPARE - PA_CFG3
+};
+
+constexpr CC1200RegisterImage compileCC1200Profile(CC1200PhyProfile const& profile, bool preferHigherCICDec = false)
+{
+    CC1200RegisterImage image = {CC1200_RESET_REGISTERS, CC1200_RESET_EXT_REGISTERS,
+                                 profile.packetMode, profile.appendStatus,
+                                 {true, nullptr, 0.0f, 0.0f, 0.0f, 0.0f}};
+
+    using Register = CC1200::Register;
+    using ExtRegister = CC1200::ExtRegister;
+
+    // Synthesizer, ADC and crystal settings that SmartRF Studio recommends over the
+    // reset values for every configuration
+    image[ExtRegister::IF_ADC1] = 0xEE;
+    image[ExtRegister::IF_ADC0] = 0x10;
+    image[ExtRegister::FS_DIG1] = 0x07;
+    image[ExtRegister::FS_DIG0] = 0xAF;
+    image[ExtRegister::FS_CAL1] = 0x40;
+    image[ExtRegister::FS_CAL0] = 0x0E;
+    image[ExtRegister::FS_DIVTWO] = 0x03;
+    image[ExtRegister::FS_DSM0] = 0x33;
+    image[ExtRegister::FS_DVC0] = 0x17;
+    image[ExtRegister::FS_PFD] = 0x00;
+    image[ExtRegister::FS_PRE] = 0x6E;
+    image[ExtRegister::FS_REG_DIV_CML] = 0x1C;
+    image[ExtRegister::FS_SPARE] = 0xAC;
+    image[ExtRegister::FS_VCO0] = 0xB5;
+    image[ExtRegister::XOSC5] = 0x0E;
+    image[ExtRegister::XOSC1] = 0x03;
+
+    auto fail = [&image](char const* error)
+    {
+        image.achieved.valid = false;
+        image.achieved.error = error;
+        return image;
+    };
+
+    // carrier frequency
+    CC1200FrequencySetting freq = calcCC1200Frequency(profile.band, profile.carrierHz);
+    if(!freq.valid)
+    {
+        return fail("carrier frequency outside of band");
+    }
+    image[ExtRegister::FREQ2] = (freq.freq >> 16) & 0xFF;
+    image[ExtRegister::FREQ1] = (freq.freq >> 8) & 0xFF;
+    image[ExtRegister::FREQ0] = freq.freq & 0xFF;
+    image[Register::FS_CFG] = (1 << FS_CFG_FS_LOCK_EN) | (freq.bandSelect << FS_CFG_FSD_BANDSELECT);
+    image.achieved.carrierHz = freq.actualHz;
+
+    // symbol rate
+    CC1200SymbolRateSetting symbolRate = calcCC1200SymbolRate(profile.symbolRateHz);
+    if(!symbolRate.valid)
+    {
+        return fail("symbol rate out of range");
+    }
+    image[Register::SYMBOL_RATE2] = (symbolRate.exponent << SYMBOL_RATE2_SRATE_E) | ((symbolRate.mantissa >> 16) & 0xF);
+    image[Register::SYMBOL_RATE1] = (symbolRate.mantissa >> 8) & 0xFF;
+    image[Register::SYMBOL_RATE0] = symbolRate.mantissa & 0xFF;
+    image.achieved.symbolRateHz = symbolRate.actualHz;
+
+    // modulation and deviation
+    CC1200DeviationSetting deviation = calcCC1200Deviation(profile.deviationHz);
+    if(!deviation.valid)
+    {
+        return fail("deviation out of range");
+    }
+    image[Register::DEVIATION_M] = deviation.mantissa;
+    image[Register::MODCFG_DEV_E] = (static_cast<uint8_t>(profile.modulation) << MODCFG_DEV_E_MOD_FORMAT) |
+                                    (deviation.exponent << MODCFG_DEV_E_DEV_E);
+    image.achieved.deviationHz = deviation.actualHz;
+
+    // RX filter
+    CC1200RXBandwidthSetting rxBandwidth = calcCC1200RXBandwidth(profile.rxBandwidthHz, preferHigherCICDec);
+    if(!rxBandwidth.valid)
+    {
+        return fail("RX filter bandwidth out of range");
+    }
+    if(rxBandwidth.actualHz < 2.0f * symbolRate.actualHz)
+    {
+        // user guide section 6.1
+        return fail("RX filter bandwidth must be at least twice the symbol rate");
+    }
+    image[Register::CHAN_BW] = (rxBandwidth.adcCicDecfact << CHAN_BW_ADC_CIC_DECFACT) |
+                               (rxBandwidth.bbCicDecfact << CHAN_BW_BB_CIC_DECFACT);
+    image.achieved.rxBandwidthHz = rxBandwidth.actualHz;
+
+    // sync word
+    uint8_t syncMode = 0;
+    switch(profile.syncWordBits)
+    {
+        case 0: syncMode = 0; break;
+        case 11: syncMode = 1; break;
+        case 16: syncMode = 2; break;
+        case 18: syncMode = 3; break;
+        case 24: syncMode = 4; break;
+        case 32: syncMode = 5; break;
+        default:
+            return fail("unsupported sync word length");
+    }
+    image[Register::SYNC3] = (profile.syncWord >> 24) & 0xFF;
+    image[Register::SYNC2] = (profile.syncWord >> 16) & 0xFF;
+    image[Register::SYNC1] = (profile.syncWord >> 8) & 0xFF;
+    image[Register::SYNC0] = profile.syncWord & 0xFF;
+    image[Register::SYNC_CFG1] = (syncMode << SYNC_CFG1_SYNC_MODE) | ((profile.syncThreshold & 0x1F) << SYNC_CFG1_SYNC_THR);
+
+    // preamble
+    image[Register::PREAMBLE_CFG1] = ((profile.preambleLengthCfg & 0xF) << PREAMBLE_CFG1_NUM_PREAMBLE) |
+                                     ((profile.preambleWordCfg & 0x3) << PREAMBLE_CFG1_PREAMBLE_WORD);
+
+    // packet format
+    if(profile.packetMode == CC1200::PacketMode::FIXED_LENGTH && profile.packetLength == 0)
+    {
+        return fail("fixed length packets need a nonzero length");
+    }
+    image[Register::PKT_CFG1] = ((profile.crcEnabled ? 0b01 : 0b00) << PKT_CFG1_CRC_CFG) |
+                                ((profile.appendStatus ? 1 : 0) << PKT_CFG1_APPEND_STATUS);
+    image[Register::PKT_CFG0] = (profile.packetMode == CC1200::PacketMode::VARIABLE_LENGTH ? 0b01 : 0b00) << PKT_CFG0_LENGTH_CONFIG;
+    image[Register::PKT_LEN] = profile.packetLength;
+
+    // state after a received packet
+    image[Register::RFEND_CFG1] = (image[Register::RFEND_CFG1] & ~(0b11 << RFEND_CFG1_RXOFF_MODE)) |
+                                  ((profile.stayInRX ? 0b11 : 0b00) << RFEND_CFG1_RXOFF_MODE);
+
+    return image;
+}
+
+// Default profile: 4FSK at 915 MHz, 100 kbps, variable length packets with CRC
+constexpr CC1200PhyProfile CC1200_DEFAULT_PROFILE = {
+    CC1200::Band::BAND_820_960MHz,
+    915000000, // carrier
+    50000, // symbol rate
+    25000, // deviation
+    208300, // RX filter bandwidth
+    CC1200::ModFormat::FSK4,
+    0x930B51DE, 32, 10, // sync word, sync bits, sync threshold
+    5, 0, // 4 byte preamble of 0xAA
+    CC1200::PacketMode::VARIABLE_LENGTH,
+    127, // maximum payload that fits in the FIFO with its length byte
+    true, // CRC
+    true, // status bytes, which give each received packet its RSSI, LQI and CRC result
+    true // stay in RX, so back to back packets are not missed
+};
+
+constexpr CC1200RegisterImage CC1200_DEFAULT_IMAGE = compileCC1200Profile(CC1200_DEFAULT_PROFILE);
+static_assert(CC1200_DEFAULT_IMAGE.achieved.valid, "default CC1200 profile does not compile");
+
+#endif //CC1200_CC1200PROFILE_H
@@ -17,30 +17,112 @@
 #ifndef CC1200_CC1200_HAL_H
 #define CC1200_CC1200_HAL_H
 
-#include "stm32f4xx_hal.h"
+#include "CC1200Bus.h"
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <cstdio>
 #include <chrono>
 #include <functional>
 #include <string>
 
+struct CC1200RegisterImage;
+
+// Slots in the long packet receive ring.  Must be a power of two.
+#ifndef CC1200_LONG_RX_SLOTS
+#define CC1200_LONG_RX_SLOTS 4
+#endif
+
+// Largest payload a long packet receive ring slot holds
+#ifndef CC1200_LONG_RX_MAX_LEN
+#define CC1200_LONG_RX_MAX_LEN 512
+#endif
+
+// Bytes in each of the framed stream TX and RX rings.  Must be a power of two.
+#ifndef CC1200_STREAM_RING_LEN
+#define CC1200_STREAM_RING_LEN 1024
+#endif
+
+// Largest payload of a framed stream frame, at most 255 bytes.  Each frame adds
+// CC1200_STREAM_FRAME_OVERHEAD bytes of sync, sequence number, length and CRC.
+#ifndef CC1200_STREAM_FRAME_PAYLOAD
+#define CC1200_STREAM_FRAME_PAYLOAD 120
+#endif
+#define CC1200_STREAM_FRAME_OVERHEAD 6
+
+// Bytes in the batched packet transmit queue, length bytes included.  Must be a power of
+// two.
+#ifndef CC1200_TX_QUEUE_LEN
+#define CC1200_TX_QUEUE_LEN 1024
+#endif
+
+// Bytes in the packet receive staging buffer.  It must hold the longest packet with its
+// length and status bytes (258); the default also leaves room for a full FIFO behind it.
+#ifndef CC1200_RX_STAGE_LEN
+#define CC1200_RX_STAGE_LEN 384
+#endif
+
+// Buffers in the receive packet pool.  Must be a power of two.
+#ifndef CC1200_RX_POOL_SLOTS
+#define CC1200_RX_POOL_SLOTS 8
+#endif
+
+// FIFO transfers at least this long go by DMA; shorter ones go through polled SPI, where
+// DMA setup would cost more than the transfer.  calibrateTransfers() replaces it with the
+// crossover measured on the live bus.
+#ifndef CC1200_DMA_MIN_LEN
+#define CC1200_DMA_MIN_LEN 32
+#endif
+
+// FIFO transfers shorter than the DMA threshold and at least this long are moved by the SPI
+// interrupt, a byte at a time.  Off until calibrateTransfers() finds it faster than polling.
+#ifndef CC1200_IT_MIN_LEN
+#define CC1200_IT_MIN_LEN SIZE_MAX
+#endif
+
+// Time, beyond the measured FIFO service time, that the FIFO threshold leaves for
+// interrupt latency and higher priority tasks before the FIFO runs dry or full
+#ifndef CC1200_FIFO_SERVICE_MARGIN_US
+#define CC1200_FIFO_SERVICE_MARGIN_US 200
+#endif
+
+// DMA staging buffers for each direction of continuous streaming, each holding up to a
+// FIFO of data.  Must be a power of two.
+#ifndef CC1200_STREAMING_DMA_BUFFERS
+#define CC1200_STREAMING_DMA_BUFFERS 4
+#endif
+
+// Descriptors in the asynchronous SPI transaction queue.  Must be a power of two.
+#ifndef CC1200_SPI_QUEUE_LEN
+#define CC1200_SPI_QUEUE_LEN 8
+#endif
+
+// Entries in the SPI transaction trace ring.  Must be a power of two.
+#ifndef CC1200_SPI_TRACE_LEN
+#define CC1200_SPI_TRACE_LEN 128
+#endif
+
 /**
- *  Driver for the CC1200 radio communications IC using STM32 HAL.
- *  This class provides basic functions and register level IO with the chip.
+ *  Driver for the CC1200 radio communications IC.
+ *  This class provides basic functions and register level IO with the chip.  All
+ *  hardware access goes through a CC1200Bus (CC1200HALBus on the STM32).
  */
 class CC1200
 {
 private:
-    // STM32 HAL handles
-    SPI_HandleTypeDef* hspi;
-    GPIO_TypeDef* csPort;
-    uint16_t csPin;
-    GPIO_TypeDef* rstPort;
-    uint16_t rstPin;
+    // SPI bus, reset line and timing services
+    CC1200Bus& bus;
 
     // Output to print debug messages to
     FILE* debugStream;
 
 public:
+    // Size of the configuration register spaces: the whole standard space, and the
+    // extended space up to ANALOG_SPARE/PA_CFG3 (0x00-0x39).  Higher extended addresses
+    // hold status and FIFO pointer registers.
+    static constexpr size_t NUM_REGISTERS = 0x2F;
+    static constexpr size_t NUM_EXT_CONFIG_REGISTERS = 0x3A;
+
     // register definitions
     enum class Register : uint8_t
     {
@@ -315,6 +397,165 @@ public:
         RAMP_400US = 7
     };
 
+    // flags in SPITraceEntry
+    static constexpr uint8_t SPI_TRACE_FAILED = 1 << 0;
+    static constexpr uint8_t SPI_TRACE_DMA = 1 << 1;
+
+    // Progress of a long packet transmission
+    enum class LongTxStatus : uint8_t
+    {
+        IDLE,       // none started
+        ACTIVE,     // on air, refilled from the TX FIFO threshold interrupt
+        DONE,       // whole packet sent
+        UNDERFLOW,  // TX FIFO ran dry mid packet; the packet was cut short
+        FAILED      // SPI error or timeout
+    };
+
+    /**
+     * A received packet.  It points into the driver's receive buffer rather than being
+     * copied out, and the link metrics come from the status bytes the radio appends to
+     * the packet (APPEND_STATUS), which arrive in the same FIFO burst as the payload.
+     */
+    struct PacketDescriptor
+    {
+        uint8_t const* data;        // payload, valid until the next packet reception call
+        size_t length;              // payload length
+        bool hasStatus;             // rssi, lqi and crcOk come from appended status bytes
+        int8_t rssi;                // RSSI in dBm during the packet; RSSI_INVALID if not appended
+        uint8_t lqi;                // link quality indicator, lower is better; 0 if not appended
+        bool crcOk;                 // CRC_OK from the appended status; true if not appended
+        uint32_t timestamp;         // bus timestamp of the FIFO read that completed the packet
+        uint32_t sequence;          // packets handed out before this one since power up
+    };
+
+    /**
+     * A buffer in the receive packet pool.  DMA writes the packet straight into it, and
+     * it belongs to the caller from acquireRxPoolPacket() until releaseRxPoolPacket().
+     */
+    struct RxPoolPacket
+    {
+        PacketDescriptor packet;    // data points into buffer
+
+        // The length byte, up to 256 payload bytes and the two appended status bytes
+        uint8_t buffer[1 + 256 + 2] __attribute__((aligned(4)));
+    };
+
+    /**
+     * A piece of a packet for enqueuePacketSegments()
+     */
+    struct TxSegment
+    {
+        uint8_t const* data;
+        size_t len;
+    };
+
+    /**
+     * A packet in the long packet receive ring
+     */
+    struct LongRxPacket
+    {
+        uint16_t length;            // payload bytes in data
+        bool hasStatus;             // status holds the appended RSSI and LQI/CRC_OK bytes
+        bool crcOk;                 // CRC_OK from the appended status; true if not appended
+        uint8_t status[2];
+        uint8_t data[CC1200_LONG_RX_MAX_LEN];
+    };
+
+    /**
+     * Framed stream counters, cleared when the stream starts
+     */
+    struct FramedStreamStats
+    {
+        uint32_t txFrames;          // frames sent, idle frames included
+        uint32_t txIdleFrames;      // empty frames sent while the TX ring was empty
+        uint32_t txUnderflows;      // TX FIFO ran dry and the transmission was restarted
+        uint32_t rxFrames;          // frames received with a good CRC, idle frames included
+        uint32_t rxIdleFrames;
+        uint32_t rxBadFrames;       // frames with a bad CRC or length
+        uint32_t rxLostFrames;      // frames missing from the sequence numbers
+        uint32_t rxRingOverflows;   // good frames dropped because the RX ring was full
+        uint32_t rxFifoOverflows;
+        uint32_t rxResyncs;         // RX restarted to find the radio sync word again
+    };
+
+    /**
+     * FIFO error counters, kept since power up.  Latency runs from the first status byte
+     * showing RX_FIFO_ERROR or TX_FIFO_ERROR to the first one showing the chip out of it,
+     * whichever code recovered.
+     */
+    struct FifoRecoveryStats
+    {
+        uint32_t rxFifoErrors;
+        uint32_t txFifoErrors;
+        uint32_t recoveries;
+        uint32_t lastLatencyUs;
+        uint32_t maxLatencyUs;
+    };
+
+    // Transfer lengths timed by calibrateTransfers()
+    static constexpr size_t NUM_TRANSFER_CALIBRATION_POINTS = 5;
+
+    /**
+     * Result of calibrateTransfers(): the best time of a burst read of each length through
+     * polled SPI, the SPI interrupt and DMA, and the crossovers picked from them
+     */
+    struct TransferCalibration
+    {
+        bool valid;
+        uint16_t length[NUM_TRANSFER_CALIBRATION_POINTS];
+        uint32_t polledNs[NUM_TRANSFER_CALIBRATION_POINTS];
+        uint32_t itNs[NUM_TRANSFER_CALIBRATION_POINTS];
+        uint32_t dmaNs[NUM_TRANSFER_CALIBRATION_POINTS];
+        size_t itMinLen;    // SIZE_MAX if the interrupt was never faster than polling
+        size_t dmaMinLen;   // SIZE_MAX if DMA was never faster than both
+    };
+
+    /**
+     * Continuous streaming byte counts and rates since the stream started.  The rates
+     * run to now while a direction is streaming, and to when it stopped after that.
+     */
+    struct StreamingThroughput
+    {
+        uint32_t txBytes;           // bytes written to the TX FIFO, pattern fill included
+        uint32_t rxBytes;           // bytes drained into the RX buffers
+        uint32_t rxDroppedBytes;    // bytes drained and discarded because every RX buffer was taken
+        uint32_t txBytesPerSecond;
+        uint32_t rxBytesPerSecond;
+    };
+
+    /**
+     * One SPI transaction for the asynchronous queue: a header, then a span of bytes sent
+     * and received by DMA, in one chip select window.  The buffers must stay valid until
+     * the descriptor completes.
+     */
+    struct SPIDescriptor
+    {
+        uint8_t header[2];      // command byte, then the address of extended register and memory accesses
+        uint8_t headerLen;      // 1 or 2
+        uint8_t const* txData;  // bytes sent after the header, or nullptr to send zeros
+        uint8_t* rxData;        // buffer for the bytes clocked back, or nullptr to discard them
+        size_t len;             // bytes after the header; at most 256 if either buffer is nullptr
+        // Called from the DMA completion interrupt with ok false on an SPI error.  It must
+        // not make SPI calls or submit descriptors.  May be nullptr.
+        void (*onComplete)(SPIDescriptor const& descriptor, bool ok, void* context);
+        void* context;
+        uint8_t status;         // status byte clocked back by the header, filled in on completion
+    };
+
+    /**
+     * One SPI transaction (chip select window) in the trace ring
+     */
+    struct SPITraceEntry
+    {
+        uint32_t timestamp; // bus timestamp at chip select
+        uint32_t duration;  // bus timestamp ticks from chip select to deselect
+        uint16_t length;    // bytes after the header
+        uint8_t header;     // first header byte: R/W and burst bits plus address or command
+        uint8_t address;    // second header byte of extended register and memory accesses, else 0
+        uint8_t status;     // status byte clocked back by the header
+        uint8_t flags;      // SPI_TRACE_* bits
+    };
+
 private:
     // chip data variables
     bool chipReady = false;
@@ -330,20 +571,59 @@ private:
     PacketMode _packetMode = PacketMode::FIXED_LENGTH;
     bool _appendStatus = false;
 
+    // Received bytes pulled out of the RX FIFO and not yet handed out.  Packets are
+    // parsed from rxStageStart; a partly received packet waits at the end for the rest.
+    uint8_t rxStage[CC1200_RX_STAGE_LEN];
+    size_t rxStageStart = 0;
+    size_t rxStageLen = 0;
+    uint32_t rxFifoOverflows = 0;
+
+    // Bus timestamps of the last FIFO read and of the one before it.  Packets that were
+    // already complete before the last read end before rxStageOlderEnd.
+    uint32_t rxStageTime = 0;
+    uint32_t rxStageOlderTime = 0;
+    size_t rxStageOlderEnd = 0;
+    uint32_t rxSequence = 0;
+
+    // Receive packet pool.  drainToRxPool() fills free buffers in place and queues the
+    // complete ones on rxPoolReady; the consumer takes them from there and frees them.
+    RxPoolPacket rxPool[CC1200_RX_POOL_SLOTS];
+    volatile bool rxPoolInUse[CC1200_RX_POOL_SLOTS] = {};
+    uint8_t rxPoolReady[CC1200_RX_POOL_SLOTS];
+    volatile uint32_t rxPoolReadyHead = 0;
+    volatile uint32_t rxPoolReadyTail = 0;
+    int rxPoolOpen = -1;                    // buffer of the packet being received, or -1
+    size_t rxPoolExpected = 0;              // FIFO bytes of the open packet after any length byte
+    size_t rxPoolReceived = 0;              // of those, read so far
+
+    // RAM shadow of the configuration registers.  Filled at begin() and updated on
+    // every write, so setters can modify fields without reading back.
+    uint8_t regShadow[NUM_REGISTERS] = {};
+    uint8_t extRegShadow[NUM_EXT_CONFIG_REGISTERS] = {};
+    bool shadowValid = false;
+
+    // Open ConfigTransaction nesting depth, and the shadowed registers written since the
+    // outermost one was opened (bit n = address n)
+    uint8_t configTxnDepth = 0;
+    uint64_t regDirty = 0;
+    uint64_t extRegDirty = 0;
+
     // Status byte from the last SPI transaction
-    uint8_t lastStatus = 0;
+    volatile uint8_t lastStatus = 0;
     
-    // Debug flag for SPI communication
+    // Debug flag for driver messages
     bool debugEnabled = false;
 
+    // SPI transaction trace ring.  spiTraceCount counts every entry recorded since the
+    // last clear; the newest is at (spiTraceCount - 1) % CC1200_SPI_TRACE_LEN.
+    SPITraceEntry spiTrace[CC1200_SPI_TRACE_LEN] = {};
+    uint32_t spiTraceCount = 0;
+    bool spiTraceEnabled = false;
+
     // DMA transfer state
     volatile bool dmaTransferComplete = false;
     volatile bool dmaTransferError = false;
-    volatile bool dmaTransferInProgress = false;
-    
-    // DMA buffers (must be aligned for DMA)
-    uint8_t dmaTxBuffer[256] __attribute__((aligned(4)));
-    uint8_t dmaRxBuffer[256] __attribute__((aligned(4)));
+    volatile bool dmaChained = false; // the transfer is one part of an open transaction
     
     // Continuous streaming state
     volatile bool continuousStreamingTx = false;
@@ -356,31 +636,353 @@ private:
     uint32_t streamingTxErrors = 0;
     uint32_t streamingRxErrors = 0;
 
+    // Continuous streaming DMA staging.  A TX buffer is filled from streamingTxRing, or
+    // with the pattern, while the ones before it are on the wire; RX buffers are drained
+    // into by DMA and handed to the application.  Head counts buffers queued, Done those
+    // whose transfer finished (set by the DMA completion interrupt), and streamingRxTail
+    // those the application released.  Only the first streamingDMABuffers are used.
+    struct StreamingBuffer
+    {
+        uint8_t data[128] __attribute__((aligned(4))); // a FIFO's worth
+        size_t len;
+    };
+    StreamingBuffer streamingTxBuffers[CC1200_STREAMING_DMA_BUFFERS];
+    StreamingBuffer streamingRxBuffers[CC1200_STREAMING_DMA_BUFFERS];
+    size_t streamingDMABuffers = CC1200_STREAMING_DMA_BUFFERS;
+    uint32_t streamingTxHead = 0;
+    volatile uint32_t streamingTxDone = 0;
+    uint32_t streamingRxHead = 0;
+    volatile uint32_t streamingRxDone = 0;
+    uint32_t streamingRxTail = 0;
+    uint8_t streamingTxRing[CC1200_STREAM_RING_LEN];
+    volatile uint32_t streamingTxRingHead = 0;
+    volatile uint32_t streamingTxRingTail = 0;
+    uint32_t streamingTxBytes = 0;
+    uint32_t streamingRxBytes = 0;
+    uint32_t streamingRxDroppedBytes = 0;
+    uint32_t streamingTxStartMs = 0;
+    uint32_t streamingTxStopMs = 0;
+    uint32_t streamingRxStartMs = 0;
+    uint32_t streamingRxStopMs = 0;
+
+    // FIFO levels as far as the streaming task knows them.  They are only read while the
+    // SPI queue is idle.  Until the next read, the TX level is at most the last one plus
+    // the bytes queued since, and the RX level at least the last one less the bytes
+    // queued to be read since.
+    size_t streamingTxFifoLevel = 0;
+    size_t streamingRxFifoLevel = 0;
+
+    // Burst transaction state, used for the trace entry
+    uint8_t spiTxnHeader = 0;
+    uint8_t spiTxnAddress = 0;
+    size_t spiTxnLen = 0;
+    bool spiTxnOk = true;
+    bool spiTxnDMA = false;
+    uint32_t spiTxnStart = 0;
+
+    // FIFO error recovery.  loadStatusByte() latches a FIFO error from any status byte;
+    // fifoResumeState is the mode the last RX, TX or IDLE strobe put the chip in.
+    volatile bool fifoErrorPending = false;
+    uint32_t fifoErrorTime = 0;
+    State fifoResumeState = State::IDLE;
+    FifoRecoveryStats fifoRecoveryStats = {};
+
+    // FIFO_THR used by the interrupt driven paths, and what it leaves to service the FIFO.
+    // spiDataBytes counts burst data bytes, so FIFO service time can be split into bus
+    // time and overhead.
+    uint8_t fifoThreshold;
+    uint32_t fifoHeadroomUs = 0;
+    uint32_t fifoServiceOverheadTicks = 0;
+    uint32_t spiDataBytes = 0;
+
+    // FIFO transfers of at least dmaMinLen bytes go by DMA, and shorter ones of at least
+    // itMinLen bytes through the SPI interrupt
+    size_t dmaMinLen = CC1200_DMA_MIN_LEN;
+    size_t itMinLen = CC1200_IT_MIN_LEN;
+    TransferCalibration transferCalibration = {};
+
+    // Asynchronous SPI transaction queue.  Tasks submit at spiQueueHead; the DMA completion
+    // interrupt runs descriptors from spiQueueTail.  spiQueueRunning is claimed by
+    // whichever of the two starts the queue, and held until it is empty.
+    SPIDescriptor spiQueue[CC1200_SPI_QUEUE_LEN];
+    volatile uint32_t spiQueueHead = 0;
+    volatile uint32_t spiQueueTail = 0;
+    std::atomic<bool> spiQueueRunning{false};
+
+    // Set while a chip select window is open.  Interrupt handlers that need the bus defer
+    // their work to when it is released instead of interleaving with the transaction.
+    volatile bool spiBusy = false;
+
+    // Long packet transmission.  Shared between task context and the GPIO0 interrupt.
+    uint8_t const* longTxData = nullptr;
+    size_t longTxLen = 0;                   // payload length
+    volatile size_t longTxWritten = 0;
+    volatile bool longTxActive = false;
+    volatile bool longTxSwitchToFixed = false; // switch to fixed length before the last 256 bytes
+    volatile bool longTxUnderflow = false;
+    volatile bool longTxError = false;
+    volatile bool longTxRefillPending = false;
+    volatile bool longTxRefilling = false;
+    LongTxStatus longTxStatus = LongTxStatus::IDLE;
+    uint32_t longTxUnderflows = 0;
+    uint8_t longTxSavedPktCfg0 = 0;
+    uint8_t longTxSavedPktLen = 0;
+    uint8_t longTxSavedFifoCfg = 0;
+    uint8_t longTxSavedIocfg0 = 0;
+
+    // Long packet reception.  The drain, from the GPIO2/GPIO3 interrupts or whoever frees
+    // the bus, fills the slot at longRxHead; the task empties the one at longRxTail.
+    LongRxPacket longRxRing[CC1200_LONG_RX_SLOTS];
+    volatile uint32_t longRxHead = 0;
+    volatile uint32_t longRxTail = 0;
+    size_t longRxFixedLen = 0;              // 0 for variable length packets
+    bool longRxStatusAppended = false;
+    volatile bool longRxActive = false;
+    volatile bool longRxDrainPending = false;
+    volatile bool longRxDraining = false;
+    bool longRxPacketOpen = false;          // a packet is partly drained
+    bool longRxDropping = false;            // the open packet is discarded (ring full)
+    bool longRxSwitchToFixed = false;       // switch to fixed length before the last 256 bytes
+    size_t longRxPayloadLen = 0;            // of the open packet
+    size_t longRxExpected = 0;              // FIFO bytes of the open packet after any length byte
+    size_t longRxReceived = 0;              // of those, drained so far
+    uint32_t longRxDropped = 0;
+    uint32_t longRxOverflows = 0;
+    std::function<void()> longRxPacketHandler;
+    uint8_t longRxSavedPktCfg0 = 0;
+    uint8_t longRxSavedPktLen = 0;
+    uint8_t longRxSavedFifoCfg = 0;
+    uint8_t longRxSavedIocfg2 = 0;
+    uint8_t longRxSavedIocfg3 = 0;
+    uint8_t longRxSavedRfendCfg1 = 0;
+
+    // Framed streaming.  The task fills the TX ring and empties the RX ring; the FIFO
+    // service, from the GPIO0/GPIO2 interrupts or whoever frees the bus, does the rest.
+    // Only one direction runs at a time.
+    enum class StreamRxState : uint8_t
+    {
+        SYNC0,
+        SYNC1,
+        SEQUENCE,
+        LENGTH,
+        PAYLOAD,
+        CRC_HIGH,
+        CRC_LOW
+    };
+    uint8_t streamTxRing[CC1200_STREAM_RING_LEN];
+    uint8_t streamRxRing[CC1200_STREAM_RING_LEN];
+    volatile uint32_t streamTxHead = 0;
+    volatile uint32_t streamTxTail = 0;
+    volatile uint32_t streamRxHead = 0;
+    volatile uint32_t streamRxTail = 0;
+    volatile bool streamTxActive = false;
+    volatile bool streamRxActive = false;
+    volatile bool streamTxDraining = false; // stopping: send what is queued, then no idle frames
+    volatile bool streamServicePending = false;
+    volatile bool streamServicing = false;
+    uint8_t streamTxFrame[CC1200_STREAM_FRAME_PAYLOAD + CC1200_STREAM_FRAME_OVERHEAD];
+    size_t streamTxFrameLen = 0;
+    size_t streamTxFramePos = 0;            // bytes of streamTxFrame already in the FIFO
+    uint8_t streamTxSequence = 0;
+    StreamRxState streamRxState = StreamRxState::SYNC0;
+    uint8_t streamRxSequence = 0;
+    uint8_t streamRxLength = 0;
+    size_t streamRxPayloadPos = 0;
+    uint16_t streamRxCrc = 0;               // running CRC of the frame being parsed
+    uint16_t streamRxFrameCrc = 0;          // CRC field of the frame being parsed
+    bool streamRxDropping = false;          // the frame does not fit in the RX ring
+    bool streamRxSequenceValid = false;
+    uint8_t streamRxNextSequence = 0;
+    size_t streamRxUnframedBytes = 0;       // bytes since the last good frame
+    FramedStreamStats streamStats = {};
+    uint8_t streamSavedPktCfg0 = 0;
+    uint8_t streamSavedFifoCfg = 0;
+    uint8_t streamSavedIocfg0 = 0;
+    uint8_t streamSavedIocfg2 = 0;
+
+    // Batched packet transmission.  The task queues packets, each a length byte and its
+    // payload, at txQueueHead; the refill, from the GPIO0/GPIO3 interrupts or whoever
+    // frees the bus, bursts them into the TX FIFO from txQueueTail.
+    uint8_t txQueueRing[CC1200_TX_QUEUE_LEN];
+    volatile uint32_t txQueueHead = 0;
+    volatile uint32_t txQueueTail = 0;
+    uint32_t txQueueFrameStart = 0;         // the packet the tail is in, or last passed
+    uint32_t txQueueFrameEnd = 0;
+    uint32_t txQueueLastFrameStart = 0;     // the last packet wholly written to the FIFO
+    volatile bool txQueueActive = false;
+    volatile bool txQueueRefillArmed = false; // the FIFO was filled, so a threshold edge follows
+    volatile bool txQueueRefillPending = false;
+    volatile bool txQueueRefilling = false;
+    volatile bool txQueueError = false;
+    volatile bool txQueueOnAir = false;
+    volatile bool txQueueFifoEmpty = true;
+    bool txQueueStayInTx = false;           // TXOFF_MODE as last written: TX, else FSTXON
+    uint8_t txQueueEmptyTxPolls = 0;
+    uint32_t txQueueUnderflows = 0;
+    uint8_t txQueueSavedPktCfg0 = 0;
+    uint8_t txQueueSavedFifoCfg = 0;
+    uint8_t txQueueSavedIocfg0 = 0;
+    uint8_t txQueueSavedIocfg3 = 0;
+    uint8_t txQueueSavedRfendCfg0 = 0;
+
+    // Packet reception helpers
+    bool pullRXFIFO();
+    size_t stagedPacketSize(size_t offset, size_t& payloadLen);
+    size_t completeStagedBytes();
+    bool nextStagedPacket(PacketDescriptor& packet);
+    void decodePacketStatus(PacketDescriptor& packet, uint8_t const* status) const;
+    void dropRxPoolPacket();
+    bool receiveStagedPacket(PacketDescriptor& packet);
+    size_t copyStagedPacket(char* buffer, size_t bufferLen);
+
     // Helper functions
     void loadStatusByte(uint8_t status);
-    void select();
-    void deselect();
-    uint8_t spiTransfer(uint8_t data);
-    
-    // DMA helper functions
-    bool spiTransferDMA(uint8_t* txData, uint8_t* rxData, size_t len);
-    bool spiTransferDMANonBlocking(uint8_t* txData, uint8_t* rxData, size_t len);
-    bool isDMATransferComplete();
+    void recordSPITrace(uint8_t header, uint8_t address, size_t len, uint8_t flags);
+    void releaseSPI();
+
+    // Record the time a FIFO service took, for updateFifoThreshold()
+    void recordFifoService(uint32_t startTime, uint32_t startBytes);
+
+    // Long packet transmission helpers
+    void serviceLongTx();
+    void refillLongTx();
+    LongTxStatus finishLongTx(LongTxStatus status);
+
+    // Batched packet transmission helpers
+    void serviceTxQueue();
+    void refillTxQueue();
+    void flushTxQueueFifo();
+    bool writeTxOffMode(bool stayInTx);
+    void restoreTxQueueConfig();
+
+    // Long packet reception helpers
+    void serviceLongRx();
+    void drainLongRx();
+    bool drainLongRxBytes(size_t fifoLen);
+    void completeLongRxPacket();
+    void recoverLongRxOverflow();
+    void rearmLongRxLengthMode();
+    void restoreLongRxConfig();
+
+    // Framed streaming helpers
+    bool configureFramedStream(bool tx);
+    void restoreFramedStreamConfig();
+    void framedStreamFifoCallback();
+    void serviceFramedStream();
+    void refillFramedStreamTx();
+    bool primeFramedStreamTx();
+    size_t buildFramedStreamTx(uint8_t* out, size_t maxLen);
+    void drainFramedStreamRx();
+    bool parseFramedStreamRx(uint8_t const* data, size_t len);
+    void restartFramedStreamRx();
+
+    // Writes PKT_CFG0 with the given LENGTH_CONFIG straight to the chip, bypassing the
+    // register shadow and any open ConfigTransaction, for length switches mid packet
+    bool writeLengthConfig(uint8_t pktCfg0, uint8_t lengthConfig);
+
+    // Burst SPI engine.  One transaction is one chip select window: the header bytes
+    // (which clock back status bytes) go out in one transfer and the payload in one more,
+    // instead of one bus call per byte.  spiBegin() picks the clock class from the header
+    // unless it is given one.
+    void spiBegin(uint8_t const* header, size_t headerLen);
+    void spiBegin(uint8_t const* header, size_t headerLen, CC1200Bus::ClockClass clockClass);
+    void spiWriteBytes(uint8_t const* data, size_t len);
+    void spiReadBytes(uint8_t* data, size_t len); // data may be nullptr to discard bytes
+    bool spiEnd();
+    bool spiBurstWrite(uint8_t const* header, size_t headerLen, uint8_t const* data, size_t len);
+    bool spiBurstRead(uint8_t const* header, size_t headerLen, uint8_t* data, size_t len);
+
+    // How a FIFO transfer moves its payload
+    enum class TransferMethod
+    {
+        POLLED,
+        INTERRUPT,
+        DMA
+    };
+
+    // Burst read with the payload moved by the given method
+    bool spiBurstRead(uint8_t const* header, size_t headerLen, uint8_t* data, size_t len, TransferMethod method);
+
+    // Register shadow helpers
+    uint8_t readCachedRegister(Register reg);
+    uint8_t readCachedRegister(ExtRegister reg);
+    void updateShadow(Register startReg, uint8_t const* values, size_t numRegisters);
+    void updateShadow(ExtRegister startReg, uint8_t const* values, size_t numRegisters);
+
+    // Burst write to configuration registers, paced to leave the inter-byte gap the chip
+    // requires (user guide table 1)
+    bool spiConfigBurstWrite(uint8_t const* header, size_t headerLen, uint8_t const* data, size_t len);
+
+    // Config transaction helpers
+    bool flushConfig();
+
+    // SPI queue helpers.  runSPIQueue() is called with spiQueueRunning claimed and starts
+    // descriptors until one is in flight or the queue is empty.
+    void runSPIQueue();
+    bool startSPIDescriptor(SPIDescriptor& descriptor);
+    void finishSPIDescriptor(bool ok);
+    void resetSPIQueue();
+    static void onStreamingTransferDone(SPIDescriptor const& descriptor, bool ok, void* context);
+    static void onStreamingTxBufferDone(SPIDescriptor const& descriptor, bool ok, void* context);
+    static void onStreamingRxBufferDone(SPIDescriptor const& descriptor, bool ok, void* context);
+    void stageStreamingTx();
+    void drainStreamingRx();
+
+    // Within a transaction opened by spiBegin(), move bytes with the given method, waiting
+    // for a background transfer to finish.  Writes run transmit only.
+    void spiWriteBytes(uint8_t const* data, size_t len, TransferMethod method);
+    void spiReadBytes(uint8_t* data, size_t len, TransferMethod method);
+    void spiBytesBackground(uint8_t const* txData, uint8_t* rxData, size_t len, TransferMethod method);
+
+    // Method for a FIFO transfer of len bytes, from dmaMinLen and itMinLen
+    TransferMethod fifoTransferMethod(size_t len) const;
+
+    // One TX FIFO burst made of the header and the segments, each moved by the method its
+    // length picks
+    bool writeTxFifoSegments(uint8_t const* header, size_t headerLen, TxSegment const* segments, size_t count);
+
+    // One RX FIFO burst, moved by the method its length picks
+    bool readRXFIFO(uint8_t* data, size_t len);
+
+    // Best time of a few burst reads of FIFO memory on the FAST clock, in timestamp counts
+    uint32_t timeFifoMemoryRead(uint8_t* buffer, size_t len, TransferMethod method);
 
 public:
+    /**
+     * Groups register writes from any number of setters into one update of the chip.
+     * While a transaction is open, writeRegister() and writeRegisters() only update the
+     * register shadow.  commit() then sends the modified registers in address order,
+     * merging neighbouring addresses into burst writes.  Transactions may be nested, in
+     * which case only the outermost commit talks to the chip.  A transaction that goes out
+     * of scope without being committed is committed by the destructor.
+     */
+    class ConfigTransaction
+    {
+    public:
+        explicit ConfigTransaction(CC1200& radio);
+        ~ConfigTransaction();
+
+        ConfigTransaction(ConfigTransaction const&) = delete;
+        ConfigTransaction& operator=(ConfigTransaction const&) = delete;
+
+        /**
+         * Send the collected writes to the chip
+         * @return true if all register bursts were written successfully
+         */
+        bool commit();
+
+    private:
+        CC1200& radio;
+        bool open = true;
+    };
+
     /**
      * Constructor for the CC1200 driver
-     * @param hspi_handle Pointer to SPI handle
-     * @param cs_port GPIO port for chip select pin
-     * @param cs_pin GPIO pin for chip select
-     * @param rst_port GPIO port for reset pin
-     * @param rst_pin GPIO pin for reset
-     * @param _debugStream File stream for debug output
+     * @param _bus Bus the chip is attached to; must outlive the driver
+     * @param _sendStringToDebugUart Function for debug output
      * @param _isCC1201 Set to true if using CC1201 variant
      */
-    CC1200(SPI_HandleTypeDef* hspi_handle, 
-           GPIO_TypeDef* cs_port, uint16_t cs_pin,
-           GPIO_TypeDef* rst_port, uint16_t rst_pin,
+    CC1200(CC1200Bus& _bus,
            std::function<void(const std::string&)> _sendStringToDebugUart, 
            bool _isCC1201 = false);
 
@@ -389,11 +991,27 @@ public:
      */
     void reset();
     /**
-     * Initialize the CC1200 chip
+     * Initialize the CC1200 chip with the default PHY profile (CC1200_DEFAULT_IMAGE)
      * @return true if initialization was successful
      */
     bool begin();
 
+    /**
+     * Initialize the CC1200 chip with the given PHY profile
+     * @param image Register image produced by compileCC1200Profile()
+     * @return true if initialization was successful
+     */
+    bool begin(CC1200RegisterImage const& image);
+
+    /**
+     * Switch to another PHY profile.  Only registers that differ from the current
+     * configuration are written, coalesced into bursts.  Should be called in IDLE; the
+     * synthesizer is recalibrated on the next calibration event.
+     * @param image Register image produced by compileCC1200Profile()
+     * @return true if the registers were written successfully
+     */
+    bool applyProfile(CC1200RegisterImage const& image);
+
     /**
      * Get the number of bytes in the TX FIFO
      * @return Number of bytes in TX FIFO
@@ -407,7 +1025,8 @@ public:
     size_t getRXFIFOLen();
 
     /**
-     * Enqueue a packet to be transmitted
+     * Enqueue a packet to be transmitted.  The payload goes by DMA if it is at least
+     * getDMAMinLen() bytes long, and through polled SPI otherwise.
      * @param data Pointer to data buffer
      * @param len Length of data
      * @return true if packet was successfully enqueued
@@ -415,21 +1034,339 @@ public:
     bool enqueuePacket(char const* data, size_t len);
 
     /**
-     * Check if a packet has been received
+     * Check if a packet has been received.  Whatever is in the RX FIFO is moved into
+     * the driver's receive buffer, so the check costs the same SPI traffic as a receive.
      * @return true if a packet is available
      */
     bool hasReceivedPacket();
 
     /**
-     * Receive a packet
+     * Receive a packet.  The RX FIFO is read in one burst and any further packets it
+     * held are kept for the next call, so back to back packets cost no extra SPI.  The
+     * burst goes by DMA if it is at least getDMAMinLen() bytes long.
      * @param buffer Buffer to store received data
-     * @param bufferLen Size of buffer
+     * @param bufferLen Size of buffer; longer packets are cut short
      * @return Number of bytes received
      */
     size_t receivePacket(char* buffer, size_t bufferLen);
 
     /**
-     * Write data to the TX FIFO in stream mode
+     * Receive a packet without copying it.  Same FIFO handling as receivePacket(), with
+     * the packet's RSSI, LQI and CRC result taken from its appended status bytes, so the
+     * metrics describe that packet and cost no register reads.
+     * @param packet Filled in with the packet; its data stays valid until the next
+     *               packet reception call
+     * @return false if no complete packet has been received
+     */
+    bool receivePacket(PacketDescriptor& packet);
+
+    /**
+     * Function called for each packet by drainReceivedPackets()
+     * @param packet The packet; its data is valid during the call
+     */
+    typedef std::function<void(PacketDescriptor const& packet)> PacketHandler;
+
+    /**
+     * Hand out every complete packet received so far.  NUM_RXBYTES is read once and the
+     * whole RX FIFO burst out, whatever number of packets it holds; a packet still
+     * arriving is kept until the rest of it is read on a later call.  With RXOFF_MODE
+     * set to RX (the default profile does) the radio receives back to back packets while
+     * this runs.  Call it more often than the FIFO takes to fill at the air rate.
+     * @param handler Called for each packet, oldest first.  It must not call back into
+     *                packet reception.
+     * @return Number of packets handled
+     */
+    size_t drainReceivedPackets(PacketHandler const& handler);
+
+    /**
+     * Get the number of times the RX FIFO overflowed during packet reception.  An
+     * overflow loses the packet being received and anything behind it in the FIFO.
+     * @return Overflow count since power up
+     */
+    uint32_t getRXFIFOOverflows() const { return rxFifoOverflows; }
+
+    /**
+     * Receive packets straight into the buffers of the receive pool.  NUM_RXBYTES is read
+     * once; then each packet's length byte is read and its payload and status bytes are
+     * burst into a free buffer, by DMA if the burst is at least getDMAMinLen() bytes
+     * long.  A packet still arriving keeps
+     * its buffer and is finished on a later call.  Complete packets are queued for
+     * acquireRxPoolPacket().  If every buffer is taken, packets wait in the RX FIFO until
+     * one is released.  Do not mix with receivePacket() or drainReceivedPackets(), which
+     * read the same FIFO.
+     * @return Number of packets completed
+     */
+    size_t drainToRxPool();
+
+    /**
+     * Take the oldest packet received by drainToRxPool().  Only one task may take packets;
+     * the buffer can be handed on and released from anywhere.
+     * @return The packet, owned by the caller until releaseRxPoolPacket(), or nullptr if
+     *         none is waiting
+     */
+    RxPoolPacket* acquireRxPoolPacket();
+
+    /**
+     * Return a buffer from acquireRxPoolPacket() to the pool.  Buffers may be released in
+     * any order.
+     * @param packet The buffer
+     */
+    void releaseRxPoolPacket(RxPoolPacket* packet);
+
+    /**
+     * Start transmitting a packet that may be longer than the TX FIFO.  The FIFO is
+     * filled, TX is strobed, and the rest of the packet is written while it is on air
+     * from txFifoThresholdCallback(), which must be called from the GPIO0 interrupt.
+     * In variable length mode, payloads up to 255 bytes go out as variable length
+     * packets.  Longer payloads, and any payload in fixed length mode, go out as a fixed
+     * length packet of len bytes, sent in infinite length mode until fewer than 256 bytes
+     * are left.  The packet configuration is restored when the transmission finishes.
+     * @param data Payload, which must stay valid until the transmission finishes
+     * @param len Payload length
+     * @return false if a long packet or framed stream is already running, the TX FIFO
+     *         is not empty, or the first FIFO write failed
+     */
+    bool startLongPacketTx(uint8_t const* data, size_t len);
+
+    /**
+     * Check on the long packet transmission and clean up once it has finished.  Call
+     * from task context until the result is no longer ACTIVE.
+     * @return Transmission progress; UNDERFLOW and FAILED leave the TX FIFO flushed
+     */
+    LongTxStatus pollLongPacketTx();
+
+    /**
+     * Transmit a packet that may be longer than the TX FIFO and wait for it to finish
+     * @param data Payload
+     * @param len Payload length
+     * @param timeoutMs Time allowed for the whole packet
+     * @return DONE on success, otherwise the reason it failed
+     */
+    LongTxStatus transmitLongPacket(uint8_t const* data, size_t len, uint32_t timeoutMs);
+
+    /**
+     * Refill the TX FIFO of a long packet transmission, framed stream or TX queue.  Call
+     * from the interrupt on the rising edge of CC1200 GPIO0, which those set up as an
+     * inverted TXFIFO_THR output.  If the SPI bus is in use, the refill runs as soon as
+     * it is freed.
+     */
+    void txFifoThresholdCallback();
+
+    /**
+     * Get the number of long packet transmissions cut short by a TX FIFO underflow
+     * @return Underflow count since power up
+     */
+    uint32_t getLongTxUnderflows() const { return longTxUnderflows; }
+
+    /**
+     * Start the batched packet transmit queue.  Packets queued with queuePacket() go out
+     * back to back as variable length packets.  As many as fit are written to the TX FIFO
+     * in one burst, and TXOFF_MODE is TX while another packet follows the one on air, so
+     * the radio goes straight on to the next without leaving TX.  After the last one it
+     * waits in FSTXON, so the next packet starts without calibrating.  The FIFO is
+     * refilled from txFifoThresholdCallback() on the GPIO0 interrupt and
+     * packetEndCallback() on the GPIO3 interrupt, with pollTxQueue() catching up on lost
+     * edges.
+     * @return false if a long packet, framed stream or the queue is already running, or
+     *         the configuration could not be written
+     */
+    bool startTxQueue();
+
+    /**
+     * Stop the TX queue, flush the TX FIFO and restore the packet configuration
+     * @param drainTimeoutMs Time allowed for the queued packets to go out first; 0 drops them
+     * @return true if every queued packet was sent
+     */
+    bool stopTxQueue(uint32_t drainTimeoutMs = 0);
+
+    /**
+     * Queue a packet for the TX queue.  The packet is copied, so the buffer can be reused
+     * at once.  Task context only.
+     * @param data Payload
+     * @param len Payload length, up to 255 bytes
+     * @return false if the queue is not running, the packet is too long or there is no room
+     */
+    bool queuePacket(uint8_t const* data, size_t len);
+
+    /**
+     * Get the free space in the TX queue.  A packet takes its length plus one byte.
+     * @return Free bytes
+     */
+    size_t getTxQueueFree() const;
+
+    /**
+     * Check on the TX queue, catching up on any lost interrupt edge.  Called from
+     * processContinuousStreaming().
+     * @return true while packets are queued or on air
+     */
+    bool pollTxQueue();
+
+    /**
+     * @return true while the TX queue is running
+     */
+    bool isTxQueueActive() const { return txQueueActive; }
+
+    /**
+     * Get the number of TX queue packets cut short by a TX FIFO underflow
+     * @return Underflow count since power up
+     */
+    uint32_t getTxQueueUnderflows() const { return txQueueUnderflows; }
+
+    /**
+     * Start receiving packets that may be longer than the RX FIFO.  The FIFO is drained
+     * into a ring of CC1200_LONG_RX_SLOTS packet slots while packets arrive, from
+     * rxFifoThresholdCallback() on the GPIO2 interrupt, and each packet is finished from
+     * packetEndCallback() on the GPIO3 interrupt.  The chip stays in RX between packets.
+     * Fixed length packets over 256 bytes are received in infinite length mode until
+     * fewer than 256 bytes are left, then in fixed length mode.  Packets with CRC errors
+     * are kept, with crcOk cleared when status bytes are appended.
+     * @param fixedLen Payload length of fixed length packets, or 0 to receive variable
+     *                 length packets
+     * @return false if a long packet or framed stream is already running, or fixedLen
+     *         is over CC1200_LONG_RX_MAX_LEN
+     */
+    bool startLongPacketRx(size_t fixedLen = 0);
+
+    /**
+     * Stop receiving long packets, flush the RX FIFO and restore the packet
+     * configuration.  Packets already in the ring stay there.
+     */
+    void stopLongPacketRx();
+
+    /**
+     * @return true while long packet reception is running
+     */
+    bool isLongPacketRxActive() const { return longRxActive; }
+
+    /**
+     * Get the oldest complete packet in the receive ring without copying it
+     * @return The packet, valid until releaseLongRxPacket(), or nullptr if the ring is empty
+     */
+    LongRxPacket const* peekLongRxPacket() const;
+
+    /**
+     * Return the slot of the packet from peekLongRxPacket() to the ring
+     */
+    void releaseLongRxPacket();
+
+    /**
+     * Set a function to run when a packet lands in the receive ring.  It runs in
+     * interrupt context, so it should only signal a task.
+     * @param handler Function to call, or nullptr for none
+     */
+    void setLongRxPacketHandler(std::function<void()> handler) { longRxPacketHandler = handler; }
+
+    /**
+     * Drain the RX FIFO into the receive ring.  Call from the interrupt on the rising
+     * edge of CC1200 GPIO2, which startLongPacketRx() sets up as RXFIFO_THR.
+     */
+    void rxFifoThresholdCallback();
+
+    /**
+     * Finish a packet: drain the rest of a long received packet, or start the next TX
+     * queue packet.  Call from the interrupt on the rising edge of CC1200 GPIO3, which
+     * startLongPacketRx() and startTxQueue() set up as an inverted PKT_SYNC_RXTX output.
+     */
+    void packetEndCallback();
+
+    /**
+     * Get the packets lost because the receive ring was full
+     * @return Dropped packet count since power up
+     */
+    uint32_t getLongRxDropped() const { return longRxDropped; }
+
+    /**
+     * Get the packets lost to RX FIFO overflows during long packet reception
+     * @return Overflow count since power up
+     */
+    uint32_t getLongRxOverflows() const { return longRxOverflows; }
+
+    /**
+     * Start transmitting a framed byte stream as one infinite length packet.  Bytes
+     * queued with framedStreamWrite() go out in frames of up to CC1200_STREAM_FRAME_PAYLOAD
+     * bytes, each with a sync word, sequence number, length and CRC-16, so the receiver
+     * can find frame boundaries again after errors.  When the TX ring is empty, empty
+     * frames keep the link up.  The TX FIFO is refilled from txFifoThresholdCallback() on
+     * the GPIO0 interrupt, with pollFramedStream() catching up on lost edges.
+     * Start the receiver first: it only finds the radio sync word at the start of the
+     * transmission.
+     * @return false if a long packet or framed stream is already running, or on an SPI error
+     */
+    bool startFramedStreamTx();
+
+    /**
+     * Stop the framed stream transmission
+     * @param drainTimeoutMs Time to wait for the queued bytes to go out first; 0 stops
+     *                       at once and discards them
+     * @return true if every queued byte was sent
+     */
+    bool stopFramedStreamTx(uint32_t drainTimeoutMs = 0);
+
+    /**
+     * Queue bytes for the framed stream transmission
+     * @param data Bytes to send
+     * @param len Number of bytes
+     * @return Bytes queued, fewer than len if the TX ring is full
+     */
+    size_t framedStreamWrite(uint8_t const* data, size_t len);
+
+    /**
+     * @return Free space in the framed stream TX ring
+     */
+    size_t getFramedStreamTxFree() const { return CC1200_STREAM_RING_LEN - (streamTxHead - streamTxTail); }
+
+    /**
+     * Start receiving a framed byte stream sent by startFramedStreamTx(), in infinite
+     * length mode.  The RX FIFO is drained from rxFifoThresholdCallback() on the GPIO2
+     * interrupt, with pollFramedStream() picking up the bytes below the threshold.  Only
+     * the payloads of good frames reach the RX ring.  If no good frame turns up for four
+     * frame lengths, RX restarts to find the radio sync word again.
+     * @return false if a long packet or framed stream is already running, or on an SPI error
+     */
+    bool startFramedStreamRx();
+
+    /**
+     * Stop receiving the framed stream.  Bytes already in the RX ring can still be read.
+     */
+    void stopFramedStreamRx();
+
+    /**
+     * Read received framed stream bytes
+     * @param buffer Buffer to store the bytes
+     * @param maxLen Size of buffer
+     * @return Bytes read
+     */
+    size_t framedStreamRead(uint8_t* buffer, size_t maxLen);
+
+    /**
+     * @return Bytes waiting in the framed stream RX ring
+     */
+    size_t getFramedStreamRxAvailable() const { return streamRxHead - streamRxTail; }
+
+    /**
+     * Service the framed stream FIFO from task context: refill or drain whatever the
+     * interrupts left.  Called from processContinuousStreaming().
+     */
+    void pollFramedStream();
+
+    /**
+     * @return true while the framed stream is transmitting
+     */
+    bool isFramedStreamTxActive() const { return streamTxActive; }
+
+    /**
+     * @return true while the framed stream is receiving
+     */
+    bool isFramedStreamRxActive() const { return streamRxActive; }
+
+    /**
+     * @return Framed stream counters since the last start
+     */
+    FramedStreamStats getFramedStreamStats() const { return streamStats; }
+
+    /**
+     * Write data to the TX FIFO in stream mode, by DMA if at least getDMAMinLen() bytes
+     * fit
      * @param buffer Data to write
      * @param count Number of bytes to write
      * @return Number of bytes written
@@ -445,7 +1382,8 @@ public:
     bool writeStreamBlocking(const char* buffer, size_t count);
 
     /**
-     * Read data from the RX FIFO in stream mode
+     * Read data from the RX FIFO in stream mode, by DMA if at least getDMAMinLen() bytes
+     * are read
      * @param buffer Buffer to store data
      * @param maxLen Maximum number of bytes to read
      * @return Number of bytes read
@@ -462,36 +1400,16 @@ public:
     bool readStreamBlocking(char* buffer, size_t count, std::chrono::microseconds timeout);
 
     /**
-     * DMA-enabled packet transmission
-     * @param data Pointer to data buffer
-     * @param len Length of data
-     * @return true if packet was successfully enqueued
-     */
-    bool enqueuePacketDMA(char const* data, size_t len);
-
-    /**
-     * DMA-enabled packet reception
-     * @param buffer Buffer to store received data
-     * @param bufferLen Size of buffer
-     * @return Number of bytes received
+     * Enqueue a packet gathered from several buffers, e.g. a header, payload and trailer,
+     * without copying them together.  The packet goes into the TX FIFO in one chip select
+     * window.  Segments of at least getDMAMinLen() bytes are sent by DMA straight from
+     * their buffers, and shorter ones through polled SPI.
+     * @param segments Segments in packet order
+     * @param count Number of segments
+     * @return true if the packet was enqueued; false if it is too long or does not fit
+     *         in the TX FIFO
      */
-    size_t receivePacketDMA(char* buffer, size_t bufferLen);
-
-    /**
-     * DMA-enabled stream write
-     * @param buffer Data to write
-     * @param count Number of bytes to write
-     * @return Number of bytes written
-     */
-    size_t writeStreamDMA(const char* buffer, size_t count);
-
-    /**
-     * DMA-enabled stream read
-     * @param buffer Buffer to store data
-     * @param maxLen Maximum number of bytes to read
-     * @return Number of bytes read
-     */
-    size_t readStreamDMA(char* buffer, size_t maxLen);
+    bool enqueuePacketSegments(TxSegment const* segments, size_t count);
 
     /**
      * Start continuous streaming transmission
@@ -508,6 +1426,49 @@ public:
      */
     bool startContinuousStreamingRx(bool verbose = false);
 
+    /**
+     * Queue data for continuous streaming TX.  Each processContinuousStreaming() call
+     * copies it into the next free DMA staging buffer while the buffers before it are
+     * on the wire.  The pattern fills the link whenever nothing is queued.
+     * @param data Bytes to send
+     * @param len Number of bytes
+     * @return Bytes queued; fewer than len if the ring of CC1200_STREAM_RING_LEN bytes is full
+     */
+    size_t writeStreamingTx(char const* data, size_t len);
+
+    /**
+     * Take the oldest buffer of continuous streaming RX data, without copying it.  The
+     * driver drains the RX FIFO into the other buffers in the meantime.  While every
+     * buffer is taken, drained data is discarded and counted in getStreamingThroughput().
+     * @param len Set to the number of bytes in the buffer
+     * @return The data, or nullptr if no buffer is ready.  Valid until
+     *         releaseStreamingRxBuffer().
+     */
+    uint8_t const* acquireStreamingRxBuffer(size_t& len);
+
+    /**
+     * Give the buffer from acquireStreamingRxBuffer() back to the driver
+     */
+    void releaseStreamingRxBuffer();
+
+    /**
+     * Set how many DMA staging buffers continuous streaming uses in each direction.  One
+     * gives single buffering: a chunk is only prepared once the previous one is done.
+     * @param count Buffers, 1 to CC1200_STREAMING_DMA_BUFFERS
+     * @return false while streaming or if count is out of range
+     */
+    bool setStreamingDMABuffers(size_t count);
+
+    /**
+     * @return DMA staging buffers continuous streaming uses in each direction
+     */
+    size_t getStreamingDMABuffers() const { return streamingDMABuffers; }
+
+    /**
+     * @return Continuous streaming byte counts and rates
+     */
+    StreamingThroughput getStreamingThroughput();
+
     /**
      * Stop continuous streaming transmission
      */
@@ -541,24 +1502,48 @@ public:
                                    uint32_t& txErrors, uint32_t& rxErrors);
 
     /**
-     * Process continuous streaming (call regularly from main loop)
+     * Process continuous streaming (call regularly from main loop).  Also recovers from
+     * FIFO errors, so a wedged radio is restarted within one call.  Never waits for the
+     * transfers an earlier call queued; while they run it stages against what it last
+     * read of the FIFO levels.
      */
     void processContinuousStreaming();
 
     /**
-     * DMA transfer complete callback (called by HAL)
+     * Recover from a FIFO error seen in any status byte: flush the FIFO, strobe IDLE and
+     * go back to RX if the chip was receiving, or to TX if continuous streaming TX is on.
+     * Long packets, framed streams and the TX queue recover on their own, so nothing is
+     * done while one of them runs.
+     * @return true if the chip was recovered
+     */
+    bool recoverFifoError();
+
+    /**
+     * @return true if a status byte has shown a FIFO error the chip is not yet out of
+     */
+    bool isFifoErrorPending() const { return fifoErrorPending; }
+
+    /**
+     * @return FIFO error and recovery counters since power up
+     */
+    FifoRecoveryStats getFifoRecoveryStats() const { return fifoRecoveryStats; }
+
+    /**
+     * DMA transfer complete callback (called by the bus)
      */
     void dmaTransferCompleteCallback();
 
     /**
-     * DMA transfer error callback (called by HAL)
+     * DMA transfer error callback (called by the bus)
      */
     void dmaTransferErrorCallback();
 
     /**
-     * Set the state to transition to after receiving a packet
+     * Set the state to transition to after receiving a packet (RFEND_CFG1.RXOFF_MODE)
      * @param goodPacket State to transition to after receiving a good packet
-     * @param badPacket State to transition to after receiving a bad packet
+     * @param badPacket State to transition to after a bad packet (CRC, length or address
+     *                  error).  RX sets TERM_ON_BAD_PACKET_EN; any other state means bad
+     *                  packets follow goodPacket.
      */
     void setOnReceiveState(State goodPacket, State badPacket);
 
@@ -583,10 +1568,44 @@ public:
     void configureGPIO(uint8_t gpioNumber, GPIOMode mode, bool outputInvert = false);
 
     /**
-     * Configure FIFO mode
+     * Configure FIFO mode, with the FIFO threshold chosen by updateFifoThreshold()
      */
     void configureFIFOMode();
 
+    /**
+     * Choose the FIFO threshold used by long packets, framed streams and the TX queue.
+     * The threshold is set as high as possible, so each interrupt moves as many bytes as
+     * possible, while the bytes left in the FIFO when it fires still last, at the current
+     * symbol rate and modulation, for twice the time to service the FIFO plus
+     * CC1200_FIFO_SERVICE_MARGIN_US.  Service time is the SPI time for the bytes moved plus
+     * the worst recent overhead, which decays by 1/16 with each service timed after it.
+     * Until a service has been timed, the threshold goes no higher than the fixed default
+     * of 63.  Called whenever one of those paths starts; nothing changes while one is
+     * running.
+     * @return FIFO_THR value: TXFIFO_THR deasserts below 127 - FIFO_THR bytes and
+     *         RXFIFO_THR asserts above FIFO_THR bytes, so either leaves at least
+     *         126 - FIFO_THR bytes of headroom
+     */
+    uint8_t updateFifoThreshold();
+
+    /**
+     * @return FIFO_THR value in use
+     */
+    uint8_t getFifoThreshold() const { return fifoThreshold; }
+
+    /**
+     * Get the air time covered by the bytes left in (or free in) the FIFO when the FIFO
+     * threshold interrupt fires
+     * @return Headroom in us, or 0 if the symbol rate is not known
+     */
+    uint32_t getFifoHeadroomUs() const { return fifoHeadroomUs; }
+
+    /**
+     * Get the worst recent FIFO service overhead, beyond the SPI time of the bytes moved
+     * @return Overhead in us
+     */
+    uint32_t getFifoServiceOverheadUs() const;
+
     /**
      * Set the packet mode
      * @param mode Packet mode
@@ -733,8 +1752,9 @@ public:
     void setAGCSettleWait(uint8_t settleWaitCfg);
 
     /**
-     * Get RSSI register value
-     * @return RSSI value in dBm
+     * Get the RSSI the radio is measuring now.  This is whatever is on air at the time
+     * of the read; the RSSI of a received packet is in its PacketDescriptor.
+     * @return RSSI in dBm, in 1/16 dB steps, or RSSI_INVALID if no valid value is available
      */
     float getRSSIRegister();
 
@@ -745,8 +1765,9 @@ public:
     void setRSSIOffset(int8_t adjust);
 
     /**
-     * Get LQI register value
-     * @return LQI value
+     * Get LQI register value, which holds the LQI and CRC_OK of the last packet
+     * received.  Prefer the PacketDescriptor, which ties them to their packet.
+     * @return LQI_VAL register: CRC_OK in bit 7, LQI below it
      */
     uint8_t getLQIRegister();
 
@@ -779,6 +1800,14 @@ public:
      */
     void writeRegisters(Register startReg, uint8_t const* values, size_t numRegisters);
 
+    /**
+     * Read multiple registers in one burst
+     * @param startReg Starting register address
+     * @param values Buffer to store the values
+     * @param numRegisters Number of registers to read
+     */
+    void readRegisters(Register startReg, uint8_t* values, size_t numRegisters);
+
     /**
      * Read an extended register
      * @param reg Extended register address
@@ -801,6 +1830,14 @@ public:
      */
     void writeRegisters(ExtRegister startReg, uint8_t const* values, size_t numRegisters);
 
+    /**
+     * Read multiple extended registers in one burst
+     * @param startReg Starting extended register address
+     * @param values Buffer to store the values
+     * @param numRegisters Number of registers to read
+     */
+    void readRegisters(ExtRegister startReg, uint8_t* values, size_t numRegisters);
+
     /**
      * Send a command
      * @param command Command to send
@@ -808,24 +1845,104 @@ public:
     void sendCommand(Command command);
 
     /**
-     * Read a byte from the RX FIFO
-     * @param address FIFO address
+     * Read a byte of RX FIFO memory by direct access, without dequeuing it
+     * @param address FIFO RAM address (0-127).  The oldest unread byte is at RXFIRST,
+     *                not at 0.
      * @return Byte read
      */
     uint8_t readRXFIFOByte(uint8_t address);
 
     /**
-     * Update the internal state
+     * Update the internal state with a NOP strobe
      */
     void updateState();
+
+    /**
+     * Get the chip state.  Every SPI transaction clocks back a status byte, so this is
+     * as fresh as the most recent access to the chip and costs no SPI traffic.
+     * @return State from the last status byte
+     */
+    State getState() const { return state; }
+
+    /**
+     * Check the CHIP_RDYn bit of the last status byte
+     * @return true if the crystal is running and the chip is ready
+     */
+    bool isChipReady() const { return chipReady; }
+
+    /**
+     * Get the raw status byte from the last SPI transaction
+     * @return Status byte
+     */
+    uint8_t getLastStatus() const { return lastStatus; }
+
+    /**
+     * Spin on NOP strobes until the chip reports the given state
+     * @param target State to wait for
+     * @param timeoutUs Timeout in microseconds
+     * @return true if the chip reached the state before the timeout
+     */
+    bool waitForState(State target, uint32_t timeoutUs);
+
+    /**
+     * Spin on NOP strobes until the chip reports that it is ready
+     * @param timeoutUs Timeout in microseconds
+     * @return true if the chip became ready before the timeout
+     */
+    bool waitForChipReady(uint32_t timeoutUs);
     
     /**
-     * Enable SPI debug output
+     * Get the SPI clock the driver uses for a transaction class
+     * @param extendedRead true for reads from extended registers or FIFO memory, which are
+     *                     limited to 7.7MHz; false for every other transaction (10MHz limit)
+     * @return SPI clock frequency in Hz
+     */
+    uint32_t getSPIFrequency(bool extendedRead) const;
+
+    /**
+     * Time burst reads of FIFO memory through polled SPI, the SPI interrupt and DMA at
+     * several lengths, on the clock the FIFO bursts use.  FIFO transfers then go by DMA from the shortest length at which
+     * DMA was fastest, and below that through the interrupt from the shortest length at
+     * which it beat polling.  begin() calls this; the chip must be idle.
+     * @return false if a timed transfer failed; the crossovers are then left as they were
+     */
+    bool calibrateTransfers();
+
+    /**
+     * @return The result of the last calibrateTransfers()
+     */
+    TransferCalibration const& getTransferCalibration() const { return transferCalibration; }
+
+    /**
+     * Set the shortest FIFO transfer that goes by DMA, overriding the calibration
+     * @param len Length in bytes; 0 sends every transfer by DMA, SIZE_MAX none
+     */
+    void setDMAMinLen(size_t len) { dmaMinLen = len; }
+
+    /**
+     * @return The shortest FIFO transfer that goes by DMA
+     */
+    size_t getDMAMinLen() const { return dmaMinLen; }
+
+    /**
+     * Set the shortest FIFO transfer that goes through the SPI interrupt, overriding the
+     * calibration.  Transfers long enough for DMA still go by DMA.
+     * @param len Length in bytes; SIZE_MAX for none
+     */
+    void setITMinLen(size_t len) { itMinLen = len; }
+
+    /**
+     * @return The shortest FIFO transfer that goes through the SPI interrupt
+     */
+    size_t getITMinLen() const { return itMinLen; }
+
+    /**
+     * Enable driver debug messages
      */
     void enableDebug() { debugEnabled = true; }
     
     /**
-     * Disable SPI debug output
+     * Disable driver debug messages
      */
     void disableDebug() { debugEnabled = false; }
     
@@ -835,8 +1952,77 @@ public:
      */
     bool isDebugEnabled() const { return debugEnabled; }
 
+    /**
+     * Start or stop recording SPI transactions in the trace ring.  Recording a
+     * transaction costs two timestamp reads and a 16 byte store.
+     * @param enabled true to record
+     */
+    void setSPITraceEnabled(bool enabled) { spiTraceEnabled = enabled; }
+
+    /**
+     * @return true if SPI transactions are being recorded
+     */
+    bool isSPITraceEnabled() const { return spiTraceEnabled; }
+
+    /**
+     * Empty the trace ring
+     */
+    void clearSPITrace() { spiTraceCount = 0; }
+
+    /**
+     * @return Transactions recorded since the last clear, including those overwritten
+     */
+    uint32_t getSPITraceTotal() const { return spiTraceCount; }
+
+    /**
+     * @return Entries currently held in the trace ring
+     */
+    size_t getSPITraceLen() const;
+
+    /**
+     * Get an entry from the trace ring.  Stop recording while reading entries out, or
+     * the ring may move underneath the caller.
+     * @param index Entry index, 0 being the oldest held
+     * @param entry Filled in with the entry
+     * @return false if index is not below getSPITraceLen()
+     */
+    bool getSPITraceEntry(size_t index, SPITraceEntry& entry) const;
+
+    /**
+     * @return Frequency of the trace timestamps and durations in Hz
+     */
+    uint32_t getSPITraceFrequency() const { return bus.getTimestampFrequency(); }
+
+    /**
+     * @return Frequency of the PacketDescriptor timestamps in Hz
+     */
+    uint32_t getTimestampFrequency() const { return bus.getTimestampFrequency(); }
+
+    /**
+     * Queue an SPI transaction to run in the background.  If the bus is idle it starts
+     * at once; otherwise the DMA completion interrupt starts it when the ones ahead of it
+     * finish, so queued transactions run back to back.  Call from one task only.  Other
+     * SPI calls wait for the queue to drain before they use the bus.
+     * @param descriptor Transaction to run; copied into the queue
+     * @return false if the queue is full or the descriptor is invalid
+     */
+    bool submitSPI(SPIDescriptor const& descriptor);
+
+    /**
+     * @return true if no queued SPI transaction is waiting or in flight
+     */
+    bool isSPIQueueIdle() const { return !spiQueueRunning; }
+
+    /**
+     * Wait for the queued SPI transactions to finish
+     * @param timeoutUs Longest time to wait
+     * @return true if the queue is idle
+     */
+    bool waitSPIQueueIdle(uint32_t timeoutUs);
+
     // Constants
     static constexpr float ASK_MIN_POWER_OFF = -17.5f;
+    static constexpr int8_t RSSI_INVALID = -128; // dBm, reported when there is no RSSI
 };
 
 #endif //CC1200_CC1200_HAL_H
@@ -13,6 +13,12 @@
 #define VCP_TX_BUFFER_SIZE 256
 #define VCP_CMD_BUFFER_SIZE 64
 #define VCP_MAX_ARGS 8
+#define VCP_TX_LONG_MAX_LEN 1024 // longest radio_tx_long test packet
+#define VCP_TX_LONG_TIMEOUT_MS 2000
+#define VCP_RX_LONG_DUMP_LEN 32 // payload bytes radio_rx_long prints
+#define VCP_FSTREAM_DRAIN_TIMEOUT_MS 2000
+#define VCP_TX_BURST_DRAIN_TIMEOUT_MS 2000
+#define VCP_RX_POLL_MS 1 // packet receive poll interval, well under a FIFO fill time
 
 /**
  * @brief VCP Menu class to handle command parsing and menu display
@@ -112,21 +118,25 @@ private:
     void cmdRadioLQI(int argc, char* argv[]);
     void cmdRadioRSSI(int argc, char* argv[]);
     void cmdRadioRX(int argc, char* argv[]);
+    void cmdRadioRXLong(int argc, char* argv[]);
     void cmdRadioStatus(int argc, char* argv[]);
     void cmdRadioStreamRX(int argc, char* argv[]);
     void cmdRadioStreamTX(int argc, char* argv[]);
+    void cmdRadioFramedStreamTX(int argc, char* argv[]);
+    void cmdRadioFramedStreamRX(int argc, char* argv[]);
     void cmdRadioTX(int argc, char* argv[]);
+    void cmdRadioTXLong(int argc, char* argv[]);
+    void cmdRadioTXBurst(int argc, char* argv[]);
     void cmdRadioVersion(int argc, char* argv[]);
     void cmdRestart(int argc, char* argv[]);
     void cmdSysInfo(int argc, char* argv[]);
     void cmdRadioDebugOn(int argc, char* argv[]);
     void cmdRadioDebugOff(int argc, char* argv[]);
+    void cmdRadioSPIBench(int argc, char* argv[]);
+    void cmdRadioSPITrace(int argc, char* argv[]);
     
-    // DMA command handlers
-    void cmdRadioTXDMA(int argc, char* argv[]);
-    void cmdRadioRXDMA(int argc, char* argv[]);
-    void cmdRadioStreamTXDMA(int argc, char* argv[]);
-    void cmdRadioStreamRXDMA(int argc, char* argv[]);
+    // Receive pool command handler
+    void cmdRadioRXPool(int argc, char* argv[]);
     
     // Continuous streaming command handlers
     void cmdRadioStreamStartTX(int argc, char* argv[]);
@@ -135,6 +145,7 @@ private:
     void cmdRadioStreamStop(int argc, char* argv[]);
     void cmdRadioStreamStats(int argc, char* argv[]);
     void cmdRadioStreamDiag(int argc, char* argv[]);
+    void cmdRadioStreamBuffers(int argc, char* argv[]);
 
 };
 
@@ -34,6 +34,7 @@
 /* Exported types ------------------------------------------------------------*/
 /* USER CODE BEGIN ET */
 #include "CC1200_HAL.h"
+#include "CC1200HALBus.h"
 #include <string>
 #include <deque>
 /**
@@ -80,6 +81,12 @@ public:
      */
     CC1200* getCC1200() { return cc1200; }
 
+    /**
+     * @brief  Get the bus the CC1200 is attached to
+     * @retval CC1200 bus instance
+     */
+    CC1200HALBus* getCC1200Bus() { return cc1200Bus; }
+
     /**
      * @brief  Refresh the watchdog
      */
@@ -144,7 +151,8 @@ private:
     GPIO_TypeDef* LedGPIO;
     uint16_t LedPin;
     
-    // CC1200 radio instance
+    // CC1200 radio instance and its bus
+    CC1200HALBus* cc1200Bus;
     CC1200* cc1200;
     
     UART_HandleTypeDef* debugUart;
@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) 2019-2023 USC Rocket Propulsion Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CC1200HALBus.h"
+#include "cmsis_os.h"
+
+#define SPI_FREQ 5000000 // hz, lower bound on the SPI clock, used for transfer timeouts
+
+// SPI clock limits (user guide table 1): 10MHz in general, but reads from extended
+// memory (extended registers and direct FIFO access) must not exceed 7.7MHz.  The
+// prescalers are powers of two, so on this board's 96MHz PCLK2 /8 gives 12MHz and /16
+// (6MHz) is the fastest under either limit.  Both clock classes run at 6MHz there; the
+// split only pays off on a kernel clock where some divider lands between 7.7 and 10MHz.
+#define SPI_MAX_FREQ 10000000 // hz
+#define SPI_EXT_READ_MAX_FREQ 7700000 // hz
+
+// Transfers up to this length use the polled SPI path by default.  It covers register
+// access, strobes and FIFO byte reads; packet payloads still go through the HAL.
+#define SPI_POLLED_MAX_LEN 16
+
+// helper function: start the DWT cycle counter, which backs getTimestamp()
+static void enableCycleCounter()
+{
+    if(!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk))
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+}
+
+CC1200HALBus::CC1200HALBus(SPI_HandleTypeDef* hspi_handle,
+                           GPIO_TypeDef* cs_port, uint16_t cs_pin,
+                           GPIO_TypeDef* rst_port, uint16_t rst_pin) :
+    hspi(hspi_handle),
+    csPort(cs_port),
+    csPin(cs_pin),
+    rstPort(rst_port),
+    rstPin(rst_pin),
+    polledMaxLen(SPI_POLLED_MAX_LEN)
+{
+    // Initialize CS pin as output and set it high (deselected)
+    HAL_GPIO_WritePin(csPort, csPin, GPIO_PIN_SET);
+
+    // Initialize RST pin as output and set it high
+    HAL_GPIO_WritePin(rstPort, rstPin, GPIO_PIN_SET);
+
+    enableCycleCounter();
+    configureClocks();
+}
+
+void CC1200HALBus::begin()
+{
+    // pick up any clock tree change since construction
+    configureClocks();
+}
+
+// SPI1 drives CSn from its hardware NSS output, which is only released when the
+// peripheral is disabled.  Gating SPE here makes each select()/deselect() pair one
+// chip select window, which the CC1200 needs to terminate burst accesses.
+//
+// The baud rate can only be changed while SPE is clear, so select() also loads the
+// prescaler for the coming transaction.  That is a single CR1 write.
+void CC1200HALBus::select(ClockClass clockClass)
+{
+    MODIFY_REG(hspi->Instance->CR1, SPI_CR1_BR, clockClass == ClockClass::EXTENDED_READ ? extReadPrescaler : fastPrescaler);
+    HAL_GPIO_WritePin(csPort, csPin, GPIO_PIN_RESET);
+    __HAL_SPI_ENABLE(hspi);
+}
+
+void CC1200HALBus::deselect()
+{
+    while(hspi->Instance->SR & SPI_SR_BSY)
+    {
+    }
+    __HAL_SPI_DISABLE(hspi);
+    HAL_GPIO_WritePin(csPort, csPin, GPIO_PIN_SET);
+}
+
+// helper function: the kernel clock of the given SPI peripheral
+static uint32_t spiKernelClock(SPI_TypeDef* instance)
+{
+    // SPI1, SPI4 and SPI5 are on APB2, the rest on APB1
+    bool apb2 = instance == SPI1;
+#ifdef SPI4
+    apb2 = apb2 || instance == SPI4;
+#endif
+#ifdef SPI5
+    apb2 = apb2 || instance == SPI5;
+#endif
+    return apb2 ? HAL_RCC_GetPCLK2Freq() : HAL_RCC_GetPCLK1Freq();
+}
+
+// helper function: CR1 baud rate bits for the fastest SPI clock that does not exceed maxHz
+static uint32_t spiPrescalerFor(uint32_t kernelClock, uint32_t maxHz)
+{
+    // BR = n divides the kernel clock by 2^(n+1)
+    uint32_t br = 0;
+    while(br < 7 && (kernelClock >> (br + 1)) > maxHz)
+    {
+        ++br;
+    }
+    return br << SPI_CR1_BR_Pos;
+}
+
+void CC1200HALBus::configureClocks()
+{
+    uint32_t kernelClock = spiKernelClock(hspi->Instance);
+    fastPrescaler = spiPrescalerFor(kernelClock, SPI_MAX_FREQ);
+    extReadPrescaler = spiPrescalerFor(kernelClock, SPI_EXT_READ_MAX_FREQ);
+}
+
+uint32_t CC1200HALBus::getClockFrequency(ClockClass clockClass) const
+{
+    uint32_t br = (clockClass == ClockClass::EXTENDED_READ ? extReadPrescaler : fastPrescaler) >> SPI_CR1_BR_Pos;
+    return spiKernelClock(hspi->Instance) >> (br + 1);
+}
+
+// Polled SPI timeout for a transfer of the given length, in ms.
+// Allows for the transfer at SPI_FREQ plus a tick of slack.
+static uint32_t spiTimeoutMs(size_t len)
+{
+    return 2 + static_cast<uint32_t>((len * 8 * 1000) / SPI_FREQ);
+}
+
+bool CC1200HALBus::polledTransfer(uint8_t const* txData, uint8_t* rxData, size_t len, uint32_t gapCycles)
+{
+    SPI_TypeDef* spi = hspi->Instance;
+
+    // a DMA transfer owns the peripheral
+    if(hspi->State != HAL_SPI_STATE_READY)
+    {
+        return false;
+    }
+
+    // drop a byte left over from a transmit-only HAL call, and any overrun with it
+    __HAL_SPI_CLEAR_OVRFLAG(hspi);
+
+    uint32_t const timeoutCycles = spiTimeoutMs(len) * (SystemCoreClock / 1000);
+    uint32_t const start = DWT->CYCCNT;
+
+    // Unpaced, the next byte is loaded into the transmit buffer while the previous one
+    // shifts out, so the bus runs back to back.  Keeping at most two bytes in flight means
+    // a byte is only lost to overrun if the loop is held off for a whole byte time.
+    size_t const maxInFlight = gapCycles > 0 ? 1 : 2;
+    size_t txCount = 0;
+    size_t rxCount = 0;
+
+    while(rxCount < len)
+    {
+        if(txCount < len && txCount - rxCount < maxInFlight && (spi->SR & SPI_SR_TXE))
+        {
+            if(gapCycles > 0 && txCount > 0)
+            {
+                uint32_t const gapStart = DWT->CYCCNT;
+                while(DWT->CYCCNT - gapStart < gapCycles)
+                {
+                }
+            }
+            *reinterpret_cast<__IO uint8_t*>(&spi->DR) = txData != nullptr ? txData[txCount] : 0;
+            ++txCount;
+        }
+
+        uint32_t const sr = spi->SR;
+        if(sr & SPI_SR_OVR)
+        {
+            __HAL_SPI_CLEAR_OVRFLAG(hspi);
+            return false;
+        }
+        if(sr & SPI_SR_RXNE)
+        {
+            uint8_t const value = *reinterpret_cast<__IO uint8_t*>(&spi->DR);
+            if(rxData != nullptr)
+            {
+                rxData[rxCount] = value;
+            }
+            ++rxCount;
+        }
+        else if(DWT->CYCCNT - start > timeoutCycles)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CC1200HALBus::transfer(uint8_t const* txData, uint8_t* rxData, size_t len)
+{
+    if(len == 0)
+    {
+        return true;
+    }
+
+    if(len <= polledMaxLen)
+    {
+        return polledTransfer(txData, rxData, len, 0);
+    }
+
+    if(txData != nullptr && rxData != nullptr)
+    {
+        return HAL_SPI_TransmitReceive(hspi, const_cast<uint8_t*>(txData), rxData, len, spiTimeoutMs(len)) == HAL_OK;
+    }
+    if(txData != nullptr)
+    {
+        return HAL_SPI_Transmit(hspi, const_cast<uint8_t*>(txData), len, spiTimeoutMs(len)) == HAL_OK;
+    }
+    if(rxData != nullptr)
+    {
+        return HAL_SPI_Receive(hspi, rxData, len, spiTimeoutMs(len)) == HAL_OK;
+    }
+
+    // discard: clock the bytes out through a small scratch buffer
+    uint8_t scratch[16];
+    while(len > 0)
+    {
+        size_t chunk = len < sizeof(scratch) ? len : sizeof(scratch);
+        if(HAL_SPI_Receive(hspi, scratch, chunk, spiTimeoutMs(chunk)) != HAL_OK)
+        {
+            return false;
+        }
+        len -= chunk;
+    }
+    return true;
+}
+
+bool CC1200HALBus::writePaced(uint8_t const* data, size_t len, uint32_t gapNs)
+{
+    if(len == 0)
+    {
+        return true;
+    }
+
+    // round up, and wait at least one cycle so the bytes are never pipelined
+    uint32_t gapCycles = (gapNs * (SystemCoreClock / 1000000) + 999) / 1000;
+    return polledTransfer(data, nullptr, len, gapCycles > 0 ? gapCycles : 1);
+}
+
+// Source of the dummy bytes for DMA transfers without transmit data
+static uint8_t const dmaDummyByte = 0;
+
+bool CC1200HALBus::startTransfer(uint8_t const* txData, uint8_t* rxData, size_t len)
+{
+    // The TX stream is disabled between transfers, so its memory increment can be set
+    // for each one.  Dummy bytes all come from the one constant byte.
+    DMA_Stream_TypeDef* txStream = hspi->hdmatx->Instance;
+    if(txData == nullptr)
+    {
+        CLEAR_BIT(txStream->CR, DMA_SxCR_MINC);
+        txData = &dmaDummyByte;
+    }
+    else
+    {
+        SET_BIT(txStream->CR, DMA_SxCR_MINC);
+    }
+
+    // Without a receive buffer only the TX stream runs.  The HAL clears the overrun the
+    // unread bytes leave behind, and reports completion through HAL_SPI_TxCpltCallback().
+    if(rxData == nullptr)
+    {
+        return HAL_SPI_Transmit_DMA(hspi, const_cast<uint8_t*>(txData), len) == HAL_OK;
+    }
+    return HAL_SPI_TransmitReceive_DMA(hspi, const_cast<uint8_t*>(txData), rxData, len) == HAL_OK;
+}
+
+bool CC1200HALBus::startTransferIT(uint8_t const* txData, uint8_t* rxData, size_t len)
+{
+    // Completion comes through the same HAL callbacks as DMA.  In master mode the HAL
+    // receives by sending the receive buffer back out as the dummy bytes.
+    if(rxData == nullptr)
+    {
+        return HAL_SPI_Transmit_IT(hspi, const_cast<uint8_t*>(txData), len) == HAL_OK;
+    }
+    if(txData == nullptr)
+    {
+        return HAL_SPI_Receive_IT(hspi, rxData, len) == HAL_OK;
+    }
+    return HAL_SPI_TransmitReceive_IT(hspi, const_cast<uint8_t*>(txData), rxData, len) == HAL_OK;
+}
+
+void CC1200HALBus::abortTransfer()
+{
+    // stops both DMA streams, or the transfer interrupts, without a callback and returns
+    // the handle to READY, so the polled path can use the peripheral again
+    HAL_SPI_Abort(hspi);
+}
+
+void CC1200HALBus::setReset(bool asserted)
+{
+    HAL_GPIO_WritePin(rstPort, rstPin, asserted ? GPIO_PIN_RESET : GPIO_PIN_SET);
+}
+
+void CC1200HALBus::delayMs(uint32_t ms)
+{
+    // yield to other tasks once the scheduler is up (1 tick = 1ms)
+    if(osKernelGetState() == osKernelRunning)
+    {
+        osDelay(ms);
+    }
+    else
+    {
+        HAL_Delay(ms);
+    }
+}
+
+uint32_t CC1200HALBus::getMillis()
+{
+    return HAL_GetTick();
+}
+
+uint32_t CC1200HALBus::getTimestamp()
+{
+    return DWT->CYCCNT;
+}
+
+uint32_t CC1200HALBus::getTimestampFrequency() const
+{
+    return SystemCoreClock;
+}
+
+bool CC1200HALBus::canBlock()
+{
+    if(osKernelGetState() != osKernelRunning || __get_IPSR() != 0)
+    {
+        return false;
+    }
+    if(wakeSemaphore == nullptr)
+    {
+        wakeSemaphore = osSemaphoreNew(1, 0, nullptr);
+    }
+    return wakeSemaphore != nullptr;
+}
+
+void CC1200HALBus::prepareWait()
+{
+    // drop a wake left over from a transfer nobody waited for
+    if(canBlock())
+    {
+        osSemaphoreAcquire(wakeSemaphore, 0);
+    }
+}
+
+bool CC1200HALBus::waitUntil(std::function<bool()> const& done, uint32_t timeoutUs)
+{
+    if(!canBlock())
+    {
+        return CC1200Bus::waitUntil(done, timeoutUs);
+    }
+
+    // Block until the completion interrupt wakes this task, instead of polling once a
+    // tick.  A wake meant for another waiter only costs a recheck.
+    uint32_t const start = DWT->CYCCNT;
+    uint32_t const cyclesPerUs = SystemCoreClock / 1000000;
+    while(!done())
+    {
+        uint32_t const elapsedUs = (DWT->CYCCNT - start) / cyclesPerUs;
+        if(elapsedUs > timeoutUs)
+        {
+            return false;
+        }
+        // round up, plus a tick because the current one is partly gone (1 tick = 1ms)
+        uint32_t const ticks = (timeoutUs - elapsedUs + 999) / 1000 + 1;
+        osSemaphoreAcquire(wakeSemaphore, ticks);
+    }
+    return true;
+}
+
+void CC1200HALBus::wakeWaiter()
+{
+    // osSemaphoreRelease() is safe from interrupts; a second release while one is
+    // pending changes nothing
+    if(wakeSemaphore != nullptr)
+    {
+        osSemaphoreRelease(wakeSemaphore);
+    }
+}
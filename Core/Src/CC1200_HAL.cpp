@@ -16,11 +16,13 @@
 
 #include "CC1200_HAL.h"
 #include "CC1200Bits.h"
-#include "cmsis_os.h"
+#include "CC1200Profile.h"
 
+#include <atomic>
 #include <cinttypes>
 #include <cmath>
 #include <array>
+#include <cstdio>
 #include <cstring>
 
 
@@ -44,71 +46,135 @@
 #define CC1201_PART_NUMBER ((uint8_t)0x21)
 #define CC1200_EXT_ADDR 0x2F // SPI initial byte address indicating extended register space
 
-#define SPI_FREQ 5000000 // hz
-// NOTE: the chip supports a higher frequency for most operations but reads to extended registers require a lower frequency
-
-// frequency of the chip's crystal oscillator
-#define CC1200_OSC_FREQ 40000000 // hz
-#define CC1200_OSC_FREQ_LOG2 25.253496f // log2 of above number
+// Minimum gap between data bytes of a configuration register burst write, in ns
+#define CONFIG_BURST_GAP_NS 100
 
 // length of the TX and RX FIFOs
 #define CC1200_FIFO_SIZE 128
 
-// maximum length of the packets we can send, including the length byte which we add.
-// Since the TX and RX FIFOs are 128 bytes, supporting packet lengths longer than 128 bytes
-// requires streaming bytes in during the transmission, which would make things complicated.
+// maximum length of the packets enqueuePacket() can send, including the length byte which
+// we add.  Longer packets are streamed into the FIFO while on air by startLongPacketTx().
 #define MAX_PACKET_LENGTH 128
 
+// longest payload a variable length packet can carry
+#define MAX_VARIABLE_PACKET_PAYLOAD 255
+
+// longest packet the packet byte counter covers in fixed length mode (PKT_LEN = 0)
+#define MAX_FIXED_PACKET_LENGTH 256
+
+// PKT_CFG0 LENGTH_CONFIG values
+#define LENGTH_CONFIG_FIXED 0b00
+#define LENGTH_CONFIG_VARIABLE 0b01
+#define LENGTH_CONFIG_INFINITE 0b10
+
+// CC1200 GPIOs used as interrupts for long packets, framed streams and the TX queue: TX
+// FIFO refill (CC_GPIO0), RX FIFO drain (CC_GPIO2) and end of packet (CC_GPIO3)
+#define TX_FIFO_GPIO 0
+#define RX_FIFO_GPIO 2
+#define PACKET_END_GPIO 3
+
+// FIFO_THR for long packets, framed streams and the TX queue until the symbol rate is
+// known.  TXFIFO_THR deasserts when the TX FIFO drains below 127 - FIFO_THR = 64 bytes,
+// and RXFIFO_THR asserts when the RX FIFO holds more than FIFO_THR = 63 bytes, so each
+// refill or drain has at least 126 - FIFO_THR = 63 bytes of air time to complete.
+#define FIFO_INTERRUPT_THR 63
+
+// Range updateFifoThreshold() picks FIFO_THR from.  The low end still moves 9 bytes per
+// interrupt; the high end leaves at least 16 bytes of air time.
+#define FIFO_THR_MIN 7
+#define FIFO_THR_MAX 110
+
+// The FIFO threshold leaves this many times the expected service time, plus
+// CC1200_FIFO_SERVICE_MARGIN_US, before the FIFO runs dry or full
+#define FIFO_HEADROOM_FACTOR 2
+
+// FIFO service time beyond the bytes themselves, assumed until one has been measured: the
+// FIFO level read and burst header transactions and the interrupt handler
+#define FIFO_SERVICE_OVERHEAD_US 20
+
+// Each timed FIFO service takes 1/FIFO_SERVICE_OVERHEAD_DECAY off the worst overhead seen
+// before it, so one service stretched by a preempting interrupt stops holding FIFO_THR down
+#define FIFO_SERVICE_OVERHEAD_DECAY 16
+
+// Free TX FIFO bytes continuous streaming leaves unfilled
+#define STREAMING_TX_MARGIN 10
+
+// Times each method is tried at each length by calibrateTransfers(); the best is kept,
+// so an interrupt during one attempt doesn't skew the result
+#define TRANSFER_CALIBRATION_ATTEMPTS 4
+
+// Longest time an SPI call waits for queued transactions to finish.  If they haven't by
+// then, a DMA completion was lost: the call fails and the queue is reset.
+#define SPI_QUEUE_WAIT_US 10000
+
+// RFEND_CFG1 RXOFF_MODE value that stays in RX after a packet
+#define RXOFF_MODE_RX 0b11
+
+// RFEND_CFG0 TXOFF_MODE values that keep the synthesizer running after a packet
+#define TXOFF_MODE_FSTXON 0b01
+#define TXOFF_MODE_TX 0b10
+
+// time allowed for the chip to reach IDLE when long packet or framed stream TX or RX is stopped
+#define FIFO_IDLE_TIMEOUT_US 1000
+
+// Framed stream frame: SYNC0 SYNC1 sequence length payload CRC-16 (high byte first).  The
+// CRC is CRC-16/CCITT-FALSE over the sequence, length and payload bytes.
+#define STREAM_FRAME_SYNC0 0xD3
+#define STREAM_FRAME_SYNC1 0x91
+#define STREAM_FRAME_HEADER_LEN 4
+#define STREAM_CRC_INIT 0xFFFF
+
+// framed stream RX restarts if it goes this many bytes without a good frame
+#define STREAM_RX_RESYNC_BYTES (4 * (CC1200_STREAM_FRAME_PAYLOAD + CC1200_STREAM_FRAME_OVERHEAD))
+
+static_assert((CC1200_STREAM_RING_LEN & (CC1200_STREAM_RING_LEN - 1)) == 0, "CC1200_STREAM_RING_LEN must be a power of two");
+static_assert(CC1200_STREAM_FRAME_PAYLOAD <= 255, "CC1200_STREAM_FRAME_PAYLOAD must fit the length byte");
+
+static_assert((CC1200_TX_QUEUE_LEN & (CC1200_TX_QUEUE_LEN - 1)) == 0, "CC1200_TX_QUEUE_LEN must be a power of two");
+static_assert((CC1200_LONG_RX_SLOTS & (CC1200_LONG_RX_SLOTS - 1)) == 0, "CC1200_LONG_RX_SLOTS must be a power of two");
+static_assert((CC1200_RX_POOL_SLOTS & (CC1200_RX_POOL_SLOTS - 1)) == 0 && CC1200_RX_POOL_SLOTS <= 256, "CC1200_RX_POOL_SLOTS must be a power of two up to 256");
+static_assert((CC1200_SPI_TRACE_LEN & (CC1200_SPI_TRACE_LEN - 1)) == 0, "CC1200_SPI_TRACE_LEN must be a power of two");
+static_assert((CC1200_SPI_QUEUE_LEN & (CC1200_SPI_QUEUE_LEN - 1)) == 0, "CC1200_SPI_QUEUE_LEN must be a power of two");
+static_assert((CC1200_STREAMING_DMA_BUFFERS & (CC1200_STREAMING_DMA_BUFFERS - 1)) == 0, "CC1200_STREAMING_DMA_BUFFERS must be a power of two");
+
 // Length of the status bytes that can be appended to packets
 #define PACKET_STATUS_LEN 2U
 
-// utility function: compile-time power calculator.
-// Works on all signed and unsigned integer types for T.
-template <typename T>
-constexpr T constexpr_pow(T num, unsigned int pow)
-{
-    return pow == 0 ? 1 : num * constexpr_pow(num, pow-1);
-}
+// Fields of the appended status bytes: RSSI1 in the first, CRC_OK and LQI in the second
+#define PACKET_STATUS_CRC_OK 0x80
+#define PACKET_STATUS_LQI_MASK 0x7F
 
-// power of two constants
-const float twoToThe16 = constexpr_pow(2.0f, 16);
-const float twoToThe20 = constexpr_pow(2.0f, 20);
-const float twoToThe21 = constexpr_pow(2.0f, 21);
-const float twoToThe22 = constexpr_pow(2.0f, 22);
-const float twoToThe38 = constexpr_pow(2.0f, 38);
-const float twoToThe39 = constexpr_pow(2.0f, 39);
+// Receive pool buffer layout: the length byte, then the payload and status bytes
+#define RX_POOL_LENGTH_OFFSET 0
+#define RX_POOL_PAYLOAD_OFFSET 1
 
-// binary value size constants
-const size_t maxValue3Bits = constexpr_pow(2, 3) - 1;
-const size_t maxValue4Bits = constexpr_pow(2, 4) - 1;
-const size_t maxValue8Bits = constexpr_pow(2, 8) - 1;
-const size_t maxValue20Bits = constexpr_pow(2, 20) - 1;
-const size_t maxValue24Bits = constexpr_pow(2, 24) - 1;
+static bool isVolatileExtRegister(uint8_t address);
 
 // Constructor
-CC1200::CC1200(SPI_HandleTypeDef* hspi_handle, 
-               GPIO_TypeDef* cs_port, uint16_t cs_pin,
-               GPIO_TypeDef* rst_port, uint16_t rst_pin,
+CC1200::CC1200(CC1200Bus& _bus,
                std::function<void(const std::string&)> _sendStringToDebugUart, 
                bool _isCC1201) :
-    hspi(hspi_handle),
-    csPort(cs_port),
-    csPin(cs_pin),
-    rstPort(rst_port),
-    rstPin(rst_pin),
+    bus(_bus),
     sendStringToDebugUart(_sendStringToDebugUart),
     isCC1201(_isCC1201)
 {
-    // Initialize CS pin as output and set it high (deselected)
-    HAL_GPIO_WritePin(csPort, csPin, GPIO_PIN_SET);
-    
-    // Initialize RST pin as output and set it high
-    HAL_GPIO_WritePin(rstPort, rstPin, GPIO_PIN_SET);
-    
+    bus.setTransferCompleteHandler([this](bool success)
+    {
+        if(success)
+        {
+            dmaTransferCompleteCallback();
+        }
+        else
+        {
+            dmaTransferErrorCallback();
+        }
+    });
+
+    fifoThreshold = FIFO_INTERRUPT_THR;
+
     // Initialize DMA state
     dmaTransferComplete = false;
     dmaTransferError = false;
-    dmaTransferInProgress = false;
     
     // Initialize streaming state
     continuousStreamingTx = false;
@@ -122,60 +188,200 @@ CC1200::CC1200(SPI_HandleTypeDef* hspi_handle,
 }
 
 // Helper functions for SPI communication
-void CC1200::select()
+
+uint32_t CC1200::getSPIFrequency(bool extendedRead) const
 {
-    HAL_GPIO_WritePin(csPort, csPin, GPIO_PIN_RESET);
+    return bus.getClockFrequency(extendedRead ? CC1200Bus::ClockClass::EXTENDED_READ : CC1200Bus::ClockClass::FAST);
 }
 
-void CC1200::deselect()
+void CC1200::spiBegin(uint8_t const* header, size_t headerLen)
 {
-    HAL_GPIO_WritePin(csPort, csPin, GPIO_PIN_SET);
+    // reads through the address extension or memory access commands need the slow clock.
+    // The bus may give both classes the same clock, as CC1200HALBus does at 96MHz.
+    uint8_t const command = header[0] & ~(CC1200_READ | CC1200_BURST);
+    bool const extendedRead = (header[0] & CC1200_READ) && (command == CC1200_EXT_ADDR || command == CC1200_MEM_ACCESS);
+    spiBegin(header, headerLen, extendedRead ? CC1200Bus::ClockClass::EXTENDED_READ : CC1200Bus::ClockClass::FAST);
 }
 
-uint8_t CC1200::spiTransfer(uint8_t data)
+void CC1200::spiBegin(uint8_t const* header, size_t headerLen, CC1200Bus::ClockClass clockClass)
 {
-    uint8_t rx_data;
-    HAL_SPI_TransmitReceive(hspi, &data, &rx_data, 1, HAL_MAX_DELAY);
-    
-    // Log SPI data if debug is enabled
-    if (debugEnabled) {
-        char buffer[50];
-        snprintf(buffer, sizeof(buffer), "SPI: TX=0x%02X RX=0x%02X\r\n", data, rx_data);
-        sendStringToDebugUart(std::string(buffer));
+    // Queued transactions hold the bus until the queue drains.  An interrupt handler that
+    // gets in before the queue's first transaction selects the chip goes first instead.
+    bool const queueStalled = spiQueueRunning && spiBusy && !waitSPIQueueIdle(SPI_QUEUE_WAIT_US);
+    if(queueStalled)
+    {
+        resetSPIQueue();
     }
-    
-    return rx_data;
+    spiBusy = true;
+
+    uint8_t status[4] = {};
+
+    spiTxnHeader = header[0];
+    spiTxnAddress = headerLen > 1 ? header[1] : 0;
+    spiTxnLen = 0;
+    spiTxnDMA = false;
+    if(spiTraceEnabled)
+    {
+        spiTxnStart = bus.getTimestamp();
+    }
+
+    // the chip select window the queue left open has just been torn down
+    if(queueStalled)
+    {
+        spiTxnOk = false;
+        return;
+    }
+
+    bus.select(clockClass);
+    spiTxnOk = bus.transfer(header, status, headerLen);
+    if(spiTxnOk)
+    {
+        loadStatusByte(status[0]);
+    }
+}
+
+void CC1200::spiWriteBytes(uint8_t const* data, size_t len)
+{
+    if(!spiTxnOk || len == 0)
+    {
+        return;
+    }
+
+    spiTxnLen += len;
+    spiDataBytes += len;
+    spiTxnOk = bus.transfer(data, nullptr, len);
+}
+
+void CC1200::spiReadBytes(uint8_t* data, size_t len)
+{
+    if(!spiTxnOk || len == 0)
+    {
+        return;
+    }
+
+    spiTxnLen += len;
+    spiDataBytes += len;
+    spiTxnOk = bus.transfer(nullptr, data, len);
+}
+
+bool CC1200::spiEnd()
+{
+    bus.deselect();
+
+    if(spiTraceEnabled)
+    {
+        recordSPITrace(spiTxnHeader, spiTxnAddress, spiTxnLen, (spiTxnOk ? 0 : SPI_TRACE_FAILED) | (spiTxnDMA ? SPI_TRACE_DMA : 0));
+    }
+
+    // a deferred refill may run transactions of its own
+    bool const ok = spiTxnOk;
+    releaseSPI();
+    return ok;
+}
+
+void CC1200::releaseSPI()
+{
+    spiBusy = false;
+    if(longTxRefillPending && longTxActive)
+    {
+        serviceLongTx();
+    }
+    if(longRxDrainPending && longRxActive)
+    {
+        serviceLongRx();
+    }
+    if(streamServicePending && (streamTxActive || streamRxActive))
+    {
+        serviceFramedStream();
+    }
+    if(txQueueRefillPending && txQueueActive)
+    {
+        serviceTxQueue();
+    }
+}
+
+// Stores the transaction that started at spiTxnStart.  Kept to plain stores so tracing
+// can stay on while streaming.
+void CC1200::recordSPITrace(uint8_t header, uint8_t address, size_t len, uint8_t flags)
+{
+    SPITraceEntry& entry = spiTrace[spiTraceCount & (CC1200_SPI_TRACE_LEN - 1)];
+    entry.timestamp = spiTxnStart;
+    entry.duration = bus.getTimestamp() - spiTxnStart;
+    entry.length = static_cast<uint16_t>(len);
+    entry.header = header;
+    entry.address = address;
+    entry.status = lastStatus;
+    entry.flags = flags;
+    ++spiTraceCount;
+}
+
+size_t CC1200::getSPITraceLen() const
+{
+    return spiTraceCount < CC1200_SPI_TRACE_LEN ? spiTraceCount : CC1200_SPI_TRACE_LEN;
+}
+
+bool CC1200::getSPITraceEntry(size_t index, SPITraceEntry& entry) const
+{
+    size_t const len = getSPITraceLen();
+    if(index >= len)
+    {
+        return false;
+    }
+
+    entry = spiTrace[(spiTraceCount - len + index) & (CC1200_SPI_TRACE_LEN - 1)];
+    return true;
+}
+
+bool CC1200::spiBurstWrite(uint8_t const* header, size_t headerLen, uint8_t const* data, size_t len)
+{
+    spiBegin(header, headerLen);
+    spiWriteBytes(data, len);
+    return spiEnd();
+}
+
+bool CC1200::spiBurstRead(uint8_t const* header, size_t headerLen, uint8_t* data, size_t len)
+{
+    spiBegin(header, headerLen);
+    spiReadBytes(data, len);
+    return spiEnd();
+}
+
+bool CC1200::spiBurstRead(uint8_t const* header, size_t headerLen, uint8_t* data, size_t len, TransferMethod method)
+{
+    spiBegin(header, headerLen);
+    spiReadBytes(data, len, method);
+    return spiEnd();
 }
 
 void CC1200::reset(){
-	HAL_GPIO_WritePin(rstPort, rstPin, GPIO_PIN_RESET);
-    HAL_Delay(1); // 1ms delay
-    HAL_GPIO_WritePin(rstPort, rstPin, GPIO_PIN_SET);
+    shadowValid = false;
+    bus.setReset(true);
+    bus.delayMs(1); // 1ms delay
+    bus.setReset(false);
 }
 
 bool CC1200::begin()
+{
+    return begin(CC1200_DEFAULT_IMAGE);
+}
+
+bool CC1200::begin(CC1200RegisterImage const& image)
 {
     chipReady = false;
+    shadowValid = false;
 
-    // Reset the chip
-    HAL_GPIO_WritePin(rstPort, rstPin, GPIO_PIN_RESET);
-    HAL_Delay(1); // 1ms delay
-    HAL_GPIO_WritePin(rstPort, rstPin, GPIO_PIN_SET);
+    // let the bus pick up any clock tree change since construction
+    bus.begin();
 
-    uint32_t resetTimeout = 10; // 10ms timeout
-    uint32_t startTime = HAL_GetTick();
+    // Reset the chip
+    bus.setReset(true);
+    bus.delayMs(1); // 1ms delay
+    bus.setReset(false);
 
-    while(!chipReady)
+    // datasheet specifies 240us reset time
+    if(!waitForChipReady(10000))
     {
-        // datasheet specifies 240us reset time
-        HAL_Delay(1); // 1ms delay
-        updateState();
-
-        if(HAL_GetTick() - startTime > resetTimeout)
-        {
-            sendStringToDebugUart("Timeout waiting for ready response from CC1200\n");
-            break;
-        }
+        sendStringToDebugUart("Timeout waiting for ready response from CC1200\n");
     }
 
     // read ID register
@@ -192,275 +398,2362 @@ bool CC1200::begin()
         return false;
     }
 
-    char infoMsg[128];
-    snprintf(infoMsg, sizeof(infoMsg), "Detected CC1200, Part Number 0x%02X, Hardware Version %02X\n", partNumber, partVersion);
-    sendStringToDebugUart(std::string(infoMsg));
+    char infoMsg[128];
+    snprintf(infoMsg, sizeof(infoMsg), "Detected CC1200, Part Number 0x%02X, Hardware Version %02X\n", partNumber, partVersion);
+    sendStringToDebugUart(std::string(infoMsg));
+
+    // Load the whole configuration.  The shadow is invalid after the reset, so this
+    // writes both register spaces in one burst each and seeds the shadow from the image.
+    if(!applyProfile(image))
+    {
+        sendStringToDebugUart("Failed to write CC1200 configuration registers\n");
+        return false;
+    }
+
+    // pick polled SPI, the SPI interrupt or DMA per transfer from what each costs on this bus
+    if(!calibrateTransfers())
+    {
+        sendStringToDebugUart("SPI transfer calibration failed, keeping the default transfer thresholds\n");
+    }
+
+    return true;
+}
+
+bool CC1200::applyProfile(CC1200RegisterImage const& image)
+{
+    if(!image.achieved.valid)
+    {
+        return false;
+    }
+
+    bool writeAll = !shadowValid;
+
+    ConfigTransaction txn(*this);
+    for(size_t address = 0; address < NUM_REGISTERS; ++address)
+    {
+        if(writeAll || regShadow[address] != image.registers[address])
+        {
+            writeRegister(static_cast<Register>(address), image.registers[address]);
+        }
+    }
+    for(size_t address = 0; address < NUM_EXT_CONFIG_REGISTERS; ++address)
+    {
+        // registers holding calibration results are only written on a full load
+        if(writeAll || (!isVolatileExtRegister(address) && extRegShadow[address] != image.extRegisters[address]))
+        {
+            writeRegister(static_cast<ExtRegister>(address), image.extRegisters[address]);
+        }
+    }
+    bool success = txn.commit();
+
+    if(writeAll)
+    {
+        // every register now holds its image value
+        shadowValid = success;
+    }
+
+    _packetMode = image.packetMode;
+    _appendStatus = image.appendStatus;
+    currentFrequency = image.achieved.carrierHz;
+    currentSymbolRate = image.achieved.symbolRateHz;
+    currentRXBandwidth = image.achieved.rxBandwidthHz;
+
+    if(debugEnabled)
+    {
+        char msg[160];
+        snprintf(msg, sizeof(msg), "Applied PHY profile: %.0f Hz carrier, %.1f Hz symbol rate, %.1f Hz deviation, %.1f Hz RX BW\n",
+                 image.achieved.carrierHz, image.achieved.symbolRateHz, image.achieved.deviationHz, image.achieved.rxBandwidthHz);
+        sendStringToDebugUart(std::string(msg));
+    }
+
+    return success;
+}
+
+void CC1200::updateState()
+{
+    // A NOP strobe clocks back the status byte, which spiBegin() loads
+    uint8_t const header = CC1200_NOP;
+    spiBurstWrite(&header, 1, nullptr, 0);
+}
+
+bool CC1200::waitForState(State target, uint32_t timeoutUs)
+{
+    uint32_t start = bus.getTimestamp();
+    uint32_t timeoutTicks = timeoutUs * (bus.getTimestampFrequency() / 1000000);
+
+    // each NOP strobe is a single byte transaction, a few microseconds at our SPI clock
+    do
+    {
+        updateState();
+        if(chipReady && state == target)
+        {
+            return true;
+        }
+    }
+    while(bus.getTimestamp() - start < timeoutTicks);
+
+    return false;
+}
+
+bool CC1200::waitForChipReady(uint32_t timeoutUs)
+{
+    uint32_t start = bus.getTimestamp();
+    uint32_t timeoutTicks = timeoutUs * (bus.getTimestampFrequency() / 1000000);
+
+    do
+    {
+        updateState();
+        if(chipReady)
+        {
+            return true;
+        }
+    }
+    while(bus.getTimestamp() - start < timeoutTicks);
+
+    return false;
+}
+
+void CC1200::loadStatusByte(uint8_t status)
+{
+    lastStatus = status;
+    
+    // Extract the chip state from the status byte
+    uint8_t stateValue = (status >> 4) & 0x7;
+    state = static_cast<State>(stateValue);
+    
+    // Check if the chip is ready
+    chipReady = (status & 0x80) == 0;
+
+    // the state field is only valid once the crystal is running
+    if(!chipReady)
+    {
+        return;
+    }
+    bool const fifoError = state == State::RX_FIFO_ERROR || state == State::TX_FIFO_ERROR;
+    if(fifoError && !fifoErrorPending)
+    {
+        fifoErrorPending = true;
+        fifoErrorTime = bus.getTimestamp();
+        if(state == State::RX_FIFO_ERROR)
+        {
+            ++fifoRecoveryStats.rxFifoErrors;
+        }
+        else
+        {
+            ++fifoRecoveryStats.txFifoErrors;
+        }
+    }
+    else if(!fifoError && fifoErrorPending)
+    {
+        fifoErrorPending = false;
+        uint32_t const latencyUs = static_cast<uint32_t>(static_cast<uint64_t>(bus.getTimestamp() - fifoErrorTime) *
+                                                         1000000 / bus.getTimestampFrequency());
+        ++fifoRecoveryStats.recoveries;
+        fifoRecoveryStats.lastLatencyUs = latencyUs;
+        if(latencyUs > fifoRecoveryStats.maxLatencyUs)
+        {
+            fifoRecoveryStats.maxLatencyUs = latencyUs;
+        }
+    }
+}
+
+bool CC1200::recoverFifoError()
+{
+    // the interrupt driven paths recover from FIFO errors themselves, and the SPI bus may
+    // be in use by another task
+    if(!fifoErrorPending || spiBusy ||
+       longTxActive || longRxActive || streamTxActive || streamRxActive || txQueueActive)
+    {
+        return false;
+    }
+
+    // SFRX and SFTX are the only ways out of the error states, and leave for IDLE
+    State const resumeState = fifoResumeState;
+    sendCommand(state == State::TX_FIFO_ERROR ? Command::FLUSH_TX : Command::FLUSH_RX);
+    sendCommand(Command::IDLE);
+    if(resumeState == State::RX)
+    {
+        sendCommand(Command::RX);
+    }
+    else if(resumeState == State::TX && continuousStreamingTx)
+    {
+        // the modulator sends preamble until the streaming task refills the FIFO
+        sendCommand(Command::TX);
+    }
+    return !fifoErrorPending;
+}
+
+size_t CC1200::getTXFIFOLen()
+{
+    return readRegister(ExtRegister::NUM_TXBYTES);
+}
+
+size_t CC1200::getRXFIFOLen()
+{
+    return readRegister(ExtRegister::NUM_RXBYTES);
+}
+
+bool CC1200::enqueuePacket(char const* data, size_t len)
+{
+    if(len > MAX_PACKET_LENGTH - 1)
+    {
+        // packet too big
+        return false;
+    }
+    size_t const totalLength = len + 1; // add one byte for length byte
+
+    size_t const txFreeBytes = CC1200_FIFO_SIZE - getTXFIFOLen();
+    if(totalLength > txFreeBytes)
+    {
+        // packet doesn't fit in TX FIFO
+        return false;
+    }
+
+    // burst write to TX FIFO.  In variable length mode the length byte rides along
+    // with the header, so the whole packet is one transaction.
+    uint8_t const header[2] = {CC1200_ENQUEUE_TX_FIFO | CC1200_BURST, static_cast<uint8_t>(len)};
+    size_t headerLen = _packetMode == PacketMode::VARIABLE_LENGTH ? 2 : 1;
+    TxSegment const payload = {reinterpret_cast<uint8_t const*>(data), len};
+    if(!writeTxFifoSegments(header, headerLen, &payload, 1))
+    {
+        return false;
+    }
+
+#if CC1200_DEBUG
+    if(debugEnabled)
+    {
+        std::string msg = "Wrote packet of data length " + std::to_string(len) + ":";
+        for(size_t byteIndex = 1; byteIndex < headerLen; ++byteIndex)
+        {
+            char byteMsg[4];
+            snprintf(byteMsg, sizeof(byteMsg), " %02X", header[byteIndex]);
+            msg += byteMsg;
+        }
+        for(size_t byteIndex = 0; byteIndex < len; ++byteIndex)
+        {
+            char byteMsg[4];
+            snprintf(byteMsg, sizeof(byteMsg), " %02X", static_cast<uint8_t>(data[byteIndex]));
+            msg += byteMsg;
+        }
+        msg += "\n";
+        sendStringToDebugUart(msg);
+    }
+#endif
+
+    return true;
+}
+
+bool CC1200::enqueuePacketSegments(TxSegment const* segments, size_t count)
+{
+    size_t len = 0;
+    for(size_t i = 0; i < count; ++i)
+    {
+        len += segments[i].len;
+    }
+
+    size_t const totalLength = len + 1; // add one byte for length byte
+    if(totalLength > MAX_PACKET_LENGTH)
+    {
+        // packet too big
+        return false;
+    }
+
+    size_t const txFreeBytes = CC1200_FIFO_SIZE - getTXFIFOLen();
+    if(totalLength > txFreeBytes)
+    {
+        // packet doesn't fit in TX FIFO
+        return false;
+    }
+
+    // In variable length mode the length byte rides along with the header
+    uint8_t const header[2] = {CC1200_ENQUEUE_TX_FIFO | CC1200_BURST, static_cast<uint8_t>(len)};
+    size_t headerLen = _packetMode == PacketMode::VARIABLE_LENGTH ? 2 : 1;
+    return writeTxFifoSegments(header, headerLen, segments, count);
+}
+
+bool CC1200::hasReceivedPacket()
+{
+    size_t payloadLen;
+    if(stagedPacketSize(rxStageStart, payloadLen) > 0)
+    {
+        return true;
+    }
+
+    pullRXFIFO();
+    return stagedPacketSize(rxStageStart, payloadLen) > 0;
+}
+
+size_t CC1200::receivePacket(char* buffer, size_t bufferLen)
+{
+    return copyStagedPacket(buffer, bufferLen);
+}
+
+bool CC1200::receivePacket(PacketDescriptor& packet)
+{
+    return receiveStagedPacket(packet);
+}
+
+size_t CC1200::drainReceivedPackets(PacketHandler const& handler)
+{
+    pullRXFIFO();
+
+    size_t count = 0;
+    PacketDescriptor packet;
+    while(nextStagedPacket(packet))
+    {
+        handler(packet);
+        ++count;
+    }
+    return count;
+}
+
+bool CC1200::receiveStagedPacket(PacketDescriptor& packet)
+{
+    if(nextStagedPacket(packet))
+    {
+        return true;
+    }
+
+    pullRXFIFO();
+    return nextStagedPacket(packet);
+}
+
+size_t CC1200::copyStagedPacket(char* buffer, size_t bufferLen)
+{
+    PacketDescriptor packet;
+    if(!receiveStagedPacket(packet))
+    {
+        return 0;
+    }
+
+    // Limit to buffer size
+    size_t bytesToCopy = packet.length < bufferLen ? packet.length : bufferLen;
+    memcpy(buffer, packet.data, bytesToCopy);
+    return bytesToCopy;
+}
+
+bool CC1200::pullRXFIFO()
+{
+    // packets that are already complete keep the time of the read that finished them
+    rxStageOlderEnd = completeStagedBytes();
+    rxStageOlderTime = rxStageTime;
+
+    // move what is left to the front
+    if(rxStageStart > 0)
+    {
+        memmove(rxStage, rxStage + rxStageStart, rxStageLen - rxStageStart);
+        rxStageLen -= rxStageStart;
+        rxStageOlderEnd -= rxStageStart;
+        rxStageStart = 0;
+    }
+
+    size_t bytesToRead = getRXFIFOLen();
+    if(state == State::RX_FIFO_ERROR)
+    {
+        // The packet that overflowed, and anything behind it, is lost.  SFRX leaves
+        // RX_FIFO_ERROR for IDLE and drops the partial packet from the stage.
+        ++rxFifoOverflows;
+        recoverFifoError();
+        return false;
+    }
+
+    if(bytesToRead > sizeof(rxStage) - rxStageLen)
+    {
+        bytesToRead = sizeof(rxStage) - rxStageLen;
+    }
+    if(bytesToRead == 0)
+    {
+        return false;
+    }
+
+    // everything in the FIFO in one burst, however many packets that is
+    if(!readRXFIFO(rxStage + rxStageLen, bytesToRead))
+    {
+        return false;
+    }
+
+    rxStageLen += bytesToRead;
+    rxStageTime = bus.getTimestamp();
+    return true;
+}
+
+size_t CC1200::stagedPacketSize(size_t offset, size_t& payloadLen)
+{
+    size_t headerLen = 0;
+    if(_packetMode == PacketMode::VARIABLE_LENGTH)
+    {
+        if(offset >= rxStageLen)
+        {
+            return 0;
+        }
+        payloadLen = rxStage[offset];
+        headerLen = 1;
+    }
+    else
+    {
+        // PKT_LEN of 0 means 256 in fixed length mode
+        payloadLen = readCachedRegister(Register::PKT_LEN);
+        if(payloadLen == 0)
+        {
+            payloadLen = 256;
+        }
+    }
+
+    size_t const packetSize = headerLen + payloadLen + (_appendStatus ? PACKET_STATUS_LEN : 0);
+    return packetSize <= rxStageLen - offset ? packetSize : 0;
+}
+
+size_t CC1200::completeStagedBytes()
+{
+    size_t end = rxStageStart;
+    size_t payloadLen;
+    while(size_t const packetSize = stagedPacketSize(end, payloadLen))
+    {
+        end += packetSize;
+    }
+    return end;
+}
+
+bool CC1200::nextStagedPacket(PacketDescriptor& packet)
+{
+    size_t payloadLen;
+    size_t const packetSize = stagedPacketSize(rxStageStart, payloadLen);
+    if(packetSize == 0)
+    {
+        return false;
+    }
+
+    packet.data = rxStage + rxStageStart + (_packetMode == PacketMode::VARIABLE_LENGTH ? 1 : 0);
+    packet.length = payloadLen;
+    decodePacketStatus(packet, _appendStatus ? packet.data + payloadLen : nullptr);
+    packet.timestamp = rxStageStart < rxStageOlderEnd ? rxStageOlderTime : rxStageTime;
+    packet.sequence = rxSequence++;
+
+    rxStageStart += packetSize;
+    return true;
+}
+
+void CC1200::decodePacketStatus(PacketDescriptor& packet, uint8_t const* status) const
+{
+    packet.hasStatus = status != nullptr;
+    if(status != nullptr)
+    {
+        packet.rssi = static_cast<int8_t>(status[0]);
+        packet.lqi = status[1] & PACKET_STATUS_LQI_MASK;
+        packet.crcOk = (status[1] & PACKET_STATUS_CRC_OK) != 0;
+    }
+    else
+    {
+        packet.rssi = RSSI_INVALID;
+        packet.lqi = 0;
+        packet.crcOk = true;
+    }
+}
+
+size_t CC1200::drainToRxPool()
+{
+    size_t available = getRXFIFOLen();
+    if(state == State::RX_FIFO_ERROR)
+    {
+        // the open packet, and anything behind it, is lost
+        ++rxFifoOverflows;
+        recoverFifoError();
+        return 0;
+    }
+
+    size_t count = 0;
+    while(available > 0)
+    {
+        if(rxPoolOpen < 0)
+        {
+            int slotIndex = 0;
+            while(slotIndex < CC1200_RX_POOL_SLOTS && rxPoolInUse[slotIndex])
+            {
+                ++slotIndex;
+            }
+            if(slotIndex == CC1200_RX_POOL_SLOTS)
+            {
+                // the rest waits in the FIFO for a buffer
+                break;
+            }
+
+            RxPoolPacket& slot = rxPool[slotIndex];
+            size_t payloadLen;
+            if(_packetMode == PacketMode::VARIABLE_LENGTH)
+            {
+                uint8_t const header = CC1200_DEQUEUE_RX_FIFO;
+                if(!spiBurstRead(&header, 1, &slot.buffer[RX_POOL_LENGTH_OFFSET], 1))
+                {
+                    break;
+                }
+                payloadLen = slot.buffer[RX_POOL_LENGTH_OFFSET];
+                --available;
+            }
+            else
+            {
+                // PKT_LEN of 0 means 256 in fixed length mode
+                payloadLen = readCachedRegister(Register::PKT_LEN);
+                if(payloadLen == 0)
+                {
+                    payloadLen = 256;
+                }
+            }
+
+            rxPoolInUse[slotIndex] = true;
+            rxPoolOpen = slotIndex;
+            slot.packet.data = &slot.buffer[RX_POOL_PAYLOAD_OFFSET];
+            slot.packet.length = payloadLen;
+            rxPoolExpected = payloadLen + (_appendStatus ? PACKET_STATUS_LEN : 0);
+            rxPoolReceived = 0;
+        }
+
+        RxPoolPacket& slot = rxPool[rxPoolOpen];
+        size_t chunk = rxPoolExpected - rxPoolReceived;
+        if(chunk > available)
+        {
+            chunk = available;
+        }
+        if(chunk > 0)
+        {
+            if(!readRXFIFO(&slot.buffer[RX_POOL_PAYLOAD_OFFSET + rxPoolReceived], chunk))
+            {
+                break;
+            }
+            rxPoolReceived += chunk;
+            available -= chunk;
+        }
+
+        if(rxPoolReceived == rxPoolExpected)
+        {
+            decodePacketStatus(slot.packet, _appendStatus ? slot.packet.data + slot.packet.length : nullptr);
+            slot.packet.timestamp = bus.getTimestamp();
+            slot.packet.sequence = rxSequence++;
+
+            // the buffer is filled before the consumer can see it
+            rxPoolReady[rxPoolReadyHead & (CC1200_RX_POOL_SLOTS - 1)] = static_cast<uint8_t>(rxPoolOpen);
+            std::atomic_signal_fence(std::memory_order_release);
+            rxPoolReadyHead = rxPoolReadyHead + 1;
+
+            rxPoolOpen = -1;
+            ++count;
+        }
+    }
+    return count;
+}
+
+void CC1200::dropRxPoolPacket()
+{
+    if(rxPoolOpen >= 0)
+    {
+        rxPoolInUse[rxPoolOpen] = false;
+        rxPoolOpen = -1;
+    }
+}
+
+CC1200::RxPoolPacket* CC1200::acquireRxPoolPacket()
+{
+    if(rxPoolReadyTail == rxPoolReadyHead)
+    {
+        return nullptr;
+    }
+
+    // the buffer was filled before the head moved past it
+    std::atomic_signal_fence(std::memory_order_acquire);
+    RxPoolPacket* packet = &rxPool[rxPoolReady[rxPoolReadyTail & (CC1200_RX_POOL_SLOTS - 1)]];
+    rxPoolReadyTail = rxPoolReadyTail + 1;
+    return packet;
+}
+
+void CC1200::releaseRxPoolPacket(RxPoolPacket* packet)
+{
+    if(packet >= rxPool && packet < rxPool + CC1200_RX_POOL_SLOTS)
+    {
+        // done with the buffer before the driver can fill it again
+        std::atomic_signal_fence(std::memory_order_release);
+        rxPoolInUse[packet - rxPool] = false;
+    }
+}
+
+bool CC1200::startLongPacketTx(uint8_t const* data, size_t len)
+{
+    if(longTxActive || longRxActive || streamTxActive || streamRxActive || txQueueActive || len == 0)
+    {
+        return false;
+    }
+    updateFifoThreshold();
+
+    // the refill arithmetic assumes the packet starts in an empty FIFO
+    if(getTXFIFOLen() != 0)
+    {
+        return false;
+    }
+
+    bool const variable = _packetMode == PacketMode::VARIABLE_LENGTH && len <= MAX_VARIABLE_PACKET_PAYLOAD;
+
+    longTxSavedPktCfg0 = readCachedRegister(Register::PKT_CFG0);
+    longTxSavedPktLen = readCachedRegister(Register::PKT_LEN);
+    longTxSavedFifoCfg = readCachedRegister(Register::FIFO_CFG);
+    longTxSavedIocfg0 = readCachedRegister(Register::IOCFG0);
+
+    // Packets the packet byte counter can cover go out in fixed or variable length mode.
+    // Longer ones start in infinite mode with PKT_LEN = len mod 256; the refill switches
+    // to fixed length once fewer than 256 bytes are left, so the counter ends the packet
+    // at the right byte.
+    uint8_t pktCfg0 = longTxSavedPktCfg0 & ~(0b11 << PKT_CFG0_LENGTH_CONFIG);
+    longTxSwitchToFixed = false;
+    if(variable)
+    {
+        pktCfg0 |= LENGTH_CONFIG_VARIABLE << PKT_CFG0_LENGTH_CONFIG;
+    }
+    else if(len > MAX_FIXED_PACKET_LENGTH)
+    {
+        pktCfg0 |= LENGTH_CONFIG_INFINITE << PKT_CFG0_LENGTH_CONFIG;
+        longTxSwitchToFixed = true;
+    }
+    else
+    {
+        pktCfg0 |= LENGTH_CONFIG_FIXED << PKT_CFG0_LENGTH_CONFIG;
+    }
+
+    {
+        ConfigTransaction txn(*this);
+        writeRegister(Register::PKT_CFG0, pktCfg0);
+        if(!variable)
+        {
+            // PKT_LEN = 0 means 256 bytes
+            writeRegister(Register::PKT_LEN, static_cast<uint8_t>(len & 0xFF));
+        }
+        uint8_t const fifoCfg = (longTxSavedFifoCfg & (1 << FIFO_CFG_CRC_AUTOFLUSH)) | (fifoThreshold << FIFO_CFG_FIFO_THR);
+        writeRegister(Register::FIFO_CFG, fifoCfg);
+
+        // inverted, so the interrupt fires on the rising edge when the FIFO drains below
+        // the threshold
+        configureGPIO(TX_FIFO_GPIO, GPIOMode::TXFIFO_THR, true);
+        if(!txn.commit())
+        {
+            finishLongTx(LongTxStatus::FAILED);
+            return false;
+        }
+    }
+
+    longTxData = data;
+    longTxLen = len;
+    longTxWritten = 0;
+    longTxUnderflow = false;
+    longTxError = false;
+    longTxRefillPending = false;
+
+    // first fill, with the length byte riding along with the header in variable length mode
+    size_t const space = CC1200_FIFO_SIZE - (variable ? 1 : 0);
+    size_t const first = len < space ? len : space;
+    uint8_t const header[2] = {CC1200_ENQUEUE_TX_FIFO | CC1200_BURST, static_cast<uint8_t>(len)};
+    if(!spiBurstWrite(header, variable ? 2 : 1, data, first))
+    {
+        finishLongTx(LongTxStatus::FAILED);
+        return false;
+    }
+    longTxWritten = first;
+
+    longTxStatus = LongTxStatus::ACTIVE;
+    longTxActive = true;
+    sendCommand(Command::TX);
+    return true;
+}
+
+CC1200::LongTxStatus CC1200::pollLongPacketTx()
+{
+    if(!longTxActive)
+    {
+        return longTxStatus;
+    }
+
+    size_t const fifoLen = getTXFIFOLen();
+    if(longTxError)
+    {
+        return finishLongTx(LongTxStatus::FAILED);
+    }
+    if(longTxUnderflow || state == State::TX_FIFO_ERROR)
+    {
+        return finishLongTx(LongTxStatus::UNDERFLOW);
+    }
+
+    if(longTxWritten < longTxLen)
+    {
+        // catch up if an interrupt edge was lost
+        if(fifoLen < CC1200_FIFO_SIZE - 1 - static_cast<size_t>(fifoThreshold))
+        {
+            serviceLongTx();
+        }
+    }
+    else if(fifoLen == 0 && state != State::TX)
+    {
+        return finishLongTx(LongTxStatus::DONE);
+    }
+
+    return LongTxStatus::ACTIVE;
+}
+
+CC1200::LongTxStatus CC1200::transmitLongPacket(uint8_t const* data, size_t len, uint32_t timeoutMs)
+{
+    if(!startLongPacketTx(data, len))
+    {
+        return LongTxStatus::FAILED;
+    }
+
+    uint32_t const start = bus.getMillis();
+    LongTxStatus status;
+    while((status = pollLongPacketTx()) == LongTxStatus::ACTIVE)
+    {
+        if(bus.getMillis() - start > timeoutMs)
+        {
+            return finishLongTx(LongTxStatus::FAILED);
+        }
+        bus.delayMs(1);
+    }
+    return status;
+}
+
+void CC1200::txFifoThresholdCallback()
+{
+    if(streamTxActive)
+    {
+        framedStreamFifoCallback();
+        return;
+    }
+
+    if(txQueueActive)
+    {
+        if(spiBusy)
+        {
+            txQueueRefillPending = true;
+            return;
+        }
+        serviceTxQueue();
+        return;
+    }
+
+    if(!longTxActive)
+    {
+        return;
+    }
+
+    // never interleave with a transaction the interrupt cut into; releaseSPI() runs it
+    if(spiBusy)
+    {
+        longTxRefillPending = true;
+        return;
+    }
+
+    serviceLongTx();
+}
+
+void CC1200::serviceLongTx()
+{
+    // Runs from the GPIO0 interrupt or whoever releases the bus.  If a refill is
+    // already running further down the stack, it loops round for this request.
+    if(longTxRefilling)
+    {
+        longTxRefillPending = true;
+        return;
+    }
+
+    longTxRefilling = true;
+    uint32_t const serviceStart = bus.getTimestamp();
+    uint32_t const serviceStartBytes = spiDataBytes;
+    do
+    {
+        longTxRefillPending = false;
+        refillLongTx();
+    }
+    while(longTxRefillPending && longTxActive);
+    recordFifoService(serviceStart, serviceStartBytes);
+    longTxRefilling = false;
+}
+
+void CC1200::refillLongTx()
+{
+    if(!longTxActive || longTxUnderflow || longTxError || longTxWritten >= longTxLen)
+    {
+        return;
+    }
+
+    size_t const fifoLen = getTXFIFOLen();
+    if(state == State::TX_FIFO_ERROR)
+    {
+        // too late, the packet has been cut short.  pollLongPacketTx() cleans up.
+        longTxUnderflow = true;
+        return;
+    }
+
+    size_t const remaining = longTxLen - longTxWritten;
+    if(longTxSwitchToFixed && remaining + fifoLen <= CC1200_FIFO_SIZE)
+    {
+        // Fewer than 256 bytes are left to send, so from here the packet byte counter
+        // next reaches PKT_LEN at the end of the packet.  The final refill always gets
+        // here, since it leaves at most a FIFO's worth to send.
+        if(!writeLengthConfig(longTxSavedPktCfg0, LENGTH_CONFIG_FIXED))
+        {
+            longTxError = true;
+            return;
+        }
+        longTxSwitchToFixed = false;
+    }
+
+    size_t chunk = CC1200_FIFO_SIZE - fifoLen;
+    if(chunk > remaining)
+    {
+        chunk = remaining;
+    }
+    if(chunk == 0)
+    {
+        return;
+    }
+
+    uint8_t const header = CC1200_ENQUEUE_TX_FIFO | CC1200_BURST;
+    if(!spiBurstWrite(&header, 1, longTxData + longTxWritten, chunk))
+    {
+        longTxError = true;
+        return;
+    }
+    longTxWritten += chunk;
+}
+
+CC1200::LongTxStatus CC1200::finishLongTx(LongTxStatus status)
+{
+    // stop the interrupt first, so nothing refills behind our back
+    longTxActive = false;
+
+    if(status != LongTxStatus::DONE)
+    {
+        // SFTX is only accepted in IDLE and TX_FIFO_ERROR
+        if(state != State::TX_FIFO_ERROR)
+        {
+            sendCommand(Command::IDLE);
+            waitForState(State::IDLE, FIFO_IDLE_TIMEOUT_US);
+        }
+        sendCommand(Command::FLUSH_TX);
+    }
+
+    if(status == LongTxStatus::UNDERFLOW)
+    {
+        ++longTxUnderflows;
+        if(debugEnabled)
+        {
+            char msg[96];
+            snprintf(msg, sizeof(msg), "Long packet TX underflow after %u of %u bytes\n",
+                     static_cast<unsigned int>(longTxWritten), static_cast<unsigned int>(longTxLen));
+            sendStringToDebugUart(std::string(msg));
+        }
+    }
+
+    ConfigTransaction txn(*this);
+    writeRegister(Register::PKT_CFG0, longTxSavedPktCfg0);
+    writeRegister(Register::PKT_LEN, longTxSavedPktLen);
+    writeRegister(Register::FIFO_CFG, longTxSavedFifoCfg);
+    writeRegister(Register::IOCFG0, longTxSavedIocfg0);
+    txn.commit();
+
+    longTxStatus = status;
+    return status;
+}
+
+bool CC1200::writeLengthConfig(uint8_t pktCfg0, uint8_t lengthConfig)
+{
+    // The shadow keeps the value from the last writeRegister(); the long packet code
+    // restores the original configuration through the shadow when it finishes.
+    uint8_t const header = static_cast<uint8_t>(Register::PKT_CFG0) | CC1200_WRITE;
+    uint8_t const value = (pktCfg0 & ~(0b11 << PKT_CFG0_LENGTH_CONFIG)) | (lengthConfig << PKT_CFG0_LENGTH_CONFIG);
+    return spiBurstWrite(&header, 1, &value, 1);
+}
+
+// helper function: copy into a byte ring of power of two length, starting at the free
+// running index
+static void ringWrite(uint8_t* ring, size_t ringLen, uint32_t index, uint8_t const* data, size_t len)
+{
+    size_t const offset = index & (ringLen - 1);
+    size_t const first = len < ringLen - offset ? len : ringLen - offset;
+    memcpy(ring + offset, data, first);
+    memcpy(ring, data + first, len - first);
+}
+
+// helper function: copy out of a byte ring of power of two length, starting at the free
+// running index
+static void ringRead(uint8_t const* ring, size_t ringLen, uint32_t index, uint8_t* data, size_t len)
+{
+    size_t const offset = index & (ringLen - 1);
+    size_t const first = len < ringLen - offset ? len : ringLen - offset;
+    memcpy(data, ring + offset, first);
+    memcpy(data + first, ring, len - first);
+}
+
+bool CC1200::startTxQueue()
+{
+    if(txQueueActive || longTxActive || longRxActive || streamTxActive || streamRxActive)
+    {
+        return false;
+    }
+    updateFifoThreshold();
+
+    txQueueSavedPktCfg0 = readCachedRegister(Register::PKT_CFG0);
+    txQueueSavedFifoCfg = readCachedRegister(Register::FIFO_CFG);
+    txQueueSavedIocfg0 = readCachedRegister(Register::IOCFG0);
+    txQueueSavedIocfg3 = readCachedRegister(Register::IOCFG3);
+    txQueueSavedRfendCfg0 = readCachedRegister(Register::RFEND_CFG0);
+
+    // start from an empty FIFO, so the refill knows where every packet starts
+    sendCommand(Command::IDLE);
+    waitForState(State::IDLE, FIFO_IDLE_TIMEOUT_US);
+    sendCommand(Command::FLUSH_TX);
+
+    {
+        ConfigTransaction txn(*this);
+        uint8_t const pktCfg0 = (txQueueSavedPktCfg0 & ~(0b11 << PKT_CFG0_LENGTH_CONFIG)) | (LENGTH_CONFIG_VARIABLE << PKT_CFG0_LENGTH_CONFIG);
+        writeRegister(Register::PKT_CFG0, pktCfg0);
+        uint8_t const fifoCfg = (txQueueSavedFifoCfg & (1 << FIFO_CFG_CRC_AUTOFLUSH)) | (fifoThreshold << FIFO_CFG_FIFO_THR);
+        writeRegister(Register::FIFO_CFG, fifoCfg);
+
+        // inverted TXFIFO_THR rises when the FIFO drains below the threshold, and inverted
+        // PKT_SYNC_RXTX at the end of each packet
+        configureGPIO(TX_FIFO_GPIO, GPIOMode::TXFIFO_THR, true);
+        configureGPIO(PACKET_END_GPIO, GPIOMode::PKT_SYNC_RXTX, true);
+
+        // end in FSTXON until there is more than one packet to send
+        uint8_t const rfendCfg0 = (txQueueSavedRfendCfg0 & ~(0b11 << RFEND_CFG0_TXOFF_MODE)) | (TXOFF_MODE_FSTXON << RFEND_CFG0_TXOFF_MODE);
+        writeRegister(Register::RFEND_CFG0, rfendCfg0);
+
+        if(!txn.commit())
+        {
+            restoreTxQueueConfig();
+            return false;
+        }
+    }
+
+    txQueueHead = 0;
+    txQueueTail = 0;
+    txQueueFrameEnd = 0;
+    txQueueLastFrameStart = 0;
+    txQueueStayInTx = false;
+    txQueueOnAir = false;
+    txQueueFifoEmpty = true;
+    txQueueEmptyTxPolls = 0;
+    txQueueRefillArmed = false;
+    txQueueRefillPending = false;
+    txQueueError = false;
+    txQueueActive = true;
+
+    // lock the synthesizer now, so the first packet goes out without calibrating
+    sendCommand(Command::FAST_TX_ON);
+    return true;
+}
+
+bool CC1200::stopTxQueue(uint32_t drainTimeoutMs)
+{
+    if(!txQueueActive)
+    {
+        return false;
+    }
+
+    if(drainTimeoutMs > 0)
+    {
+        uint32_t const start = bus.getMillis();
+        while(pollTxQueue())
+        {
+            if(bus.getMillis() - start > drainTimeoutMs)
+            {
+                break;
+            }
+            bus.delayMs(1);
+        }
+    }
+
+    bool const sent = txQueueHead == txQueueTail && !txQueueOnAir;
+
+    txQueueActive = false;
+    updateState();
+    if(state != State::TX_FIFO_ERROR)
+    {
+        sendCommand(Command::IDLE);
+        waitForState(State::IDLE, FIFO_IDLE_TIMEOUT_US);
+    }
+    sendCommand(Command::FLUSH_TX);
+    restoreTxQueueConfig();
+
+    // the interrupts are off, so the consumer side of the ring is ours
+    txQueueTail = txQueueHead;
+    txQueueOnAir = false;
+    return sent;
+}
+
+void CC1200::restoreTxQueueConfig()
+{
+    ConfigTransaction txn(*this);
+    writeRegister(Register::PKT_CFG0, txQueueSavedPktCfg0);
+    writeRegister(Register::FIFO_CFG, txQueueSavedFifoCfg);
+    writeRegister(Register::IOCFG0, txQueueSavedIocfg0);
+    writeRegister(Register::IOCFG3, txQueueSavedIocfg3);
+    writeRegister(Register::RFEND_CFG0, txQueueSavedRfendCfg0);
+    txn.commit();
+}
+
+bool CC1200::queuePacket(uint8_t const* data, size_t len)
+{
+    if(!txQueueActive || len > MAX_VARIABLE_PACKET_PAYLOAD || len + 1 > getTxQueueFree())
+    {
+        return false;
+    }
+
+    uint8_t const lengthByte = static_cast<uint8_t>(len);
+    ringWrite(txQueueRing, CC1200_TX_QUEUE_LEN, txQueueHead, &lengthByte, 1);
+    ringWrite(txQueueRing, CC1200_TX_QUEUE_LEN, txQueueHead + 1, data, len);
+    std::atomic_signal_fence(std::memory_order_release);
+    txQueueHead = txQueueHead + 1 + len;
+
+    // While the threshold interrupt is refilling a full FIFO, the packet goes out with
+    // the next refill.  Otherwise nothing else would write it, so do it now.
+    if(!txQueueRefillArmed)
+    {
+        if(spiBusy)
+        {
+            txQueueRefillPending = true;
+        }
+        else
+        {
+            serviceTxQueue();
+        }
+    }
+    return true;
+}
+
+size_t CC1200::getTxQueueFree() const
+{
+    return CC1200_TX_QUEUE_LEN - (txQueueHead - txQueueTail);
+}
+
+bool CC1200::pollTxQueue()
+{
+    if(!txQueueActive)
+    {
+        return false;
+    }
+
+    if(txQueueError)
+    {
+        // a FIFO write failed part way, so nothing in the FIFO can be trusted
+        txQueueError = false;
+        updateState();
+        if(state != State::TX_FIFO_ERROR)
+        {
+            sendCommand(Command::IDLE);
+            waitForState(State::IDLE, FIFO_IDLE_TIMEOUT_US);
+        }
+        flushTxQueueFifo();
+    }
+
+    // catch up if an interrupt edge was lost
+    serviceTxQueue();
+
+    // If the end of packet edge before the last packet was lost, that packet ended with
+    // TXOFF_MODE still TX, and the radio now sends preamble with nothing to follow.  An
+    // empty FIFO in TX on two polls in a row is that, not the end of a packet going out.
+    if(txQueueHead == txQueueTail && txQueueOnAir && txQueueFifoEmpty)
+    {
+        if(++txQueueEmptyTxPolls >= 2)
+        {
+            sendCommand(Command::IDLE);
+            waitForState(State::IDLE, FIFO_IDLE_TIMEOUT_US);
+            sendCommand(Command::FAST_TX_ON);
+            txQueueEmptyTxPolls = 0;
+            txQueueOnAir = false;
+        }
+    }
+    else
+    {
+        txQueueEmptyTxPolls = 0;
+    }
+
+    return txQueueHead != txQueueTail || txQueueOnAir;
+}
+
+void CC1200::serviceTxQueue()
+{
+    // same scheme as serviceLongTx()
+    if(txQueueRefilling)
+    {
+        txQueueRefillPending = true;
+        return;
+    }
+
+    txQueueRefilling = true;
+    uint32_t const serviceStart = bus.getTimestamp();
+    uint32_t const serviceStartBytes = spiDataBytes;
+    do
+    {
+        txQueueRefillPending = false;
+        refillTxQueue();
+    }
+    while(txQueueRefillPending && txQueueActive);
+    recordFifoService(serviceStart, serviceStartBytes);
+    txQueueRefilling = false;
+}
+
+void CC1200::refillTxQueue()
+{
+    if(!txQueueActive || txQueueError)
+    {
+        return;
+    }
+
+    size_t fifoLen = getTXFIFOLen();
+    if(state == State::TX_FIFO_ERROR)
+    {
+        // the packet on air was cut short; SFTX leaves TX_FIFO_ERROR for IDLE
+        ++txQueueUnderflows;
+        flushTxQueueFifo();
+        updateState();
+        fifoLen = 0;
+    }
+
+    uint32_t const head = txQueueHead;
+    std::atomic_signal_fence(std::memory_order_acquire);
+
+    size_t const space = CC1200_FIFO_SIZE - fifoLen;
+    size_t chunk = head - txQueueTail;
+    if(chunk >= space)
+    {
+        // the FIFO ends up full, so the threshold interrupt comes round for the rest
+        chunk = space;
+        txQueueRefillArmed = true;
+    }
+    else
+    {
+        txQueueRefillArmed = false;
+    }
+
+    if(chunk > 0)
+    {
+        // as many packets as fit, in one burst
+        size_t const offset = txQueueTail & (CC1200_TX_QUEUE_LEN - 1);
+        size_t const first = chunk < CC1200_TX_QUEUE_LEN - offset ? chunk : CC1200_TX_QUEUE_LEN - offset;
+        uint8_t const header = CC1200_ENQUEUE_TX_FIFO | CC1200_BURST;
+        spiBegin(&header, 1);
+        spiWriteBytes(txQueueRing + offset, first);
+        spiWriteBytes(txQueueRing, chunk - first);
+        if(!spiEnd())
+        {
+            txQueueRefillArmed = false;
+            txQueueError = true;
+            return;
+        }
+
+        // Note which packets are now wholly in the FIFO.  The length bytes have to be read
+        // before the tail moves, since that hands the space back to queuePacket().
+        uint32_t const newTail = txQueueTail + chunk;
+        uint32_t pos = txQueueTail;
+        while(pos != newTail)
+        {
+            if(pos == txQueueFrameEnd)
+            {
+                txQueueFrameStart = pos;
+                txQueueFrameEnd = pos + 1 + txQueueRing[pos & (CC1200_TX_QUEUE_LEN - 1)];
+            }
+            if(static_cast<int32_t>(newTail - txQueueFrameEnd) >= 0)
+            {
+                txQueueLastFrameStart = txQueueFrameStart;
+                pos = txQueueFrameEnd;
+            }
+            else
+            {
+                pos = newTail;
+            }
+        }
+
+        std::atomic_signal_fence(std::memory_order_release);
+        txQueueTail = newTail;
+        fifoLen += chunk;
+    }
+
+    // Stay in TX after the packet on air while another follows it, so they go out back to
+    // back.  Once only the last one is left, end in FSTXON rather than send preamble with
+    // nothing behind it.
+    bool const stayInTx = head != txQueueTail || fifoLen > txQueueTail - txQueueLastFrameStart;
+    if(stayInTx != txQueueStayInTx)
+    {
+        if(!writeTxOffMode(stayInTx))
+        {
+            txQueueError = true;
+            return;
+        }
+        txQueueStayInTx = stayInTx;
+    }
+
+    // start the next packet if the radio finished the last one before it arrived
+    if(fifoLen > 0 && (state == State::IDLE || state == State::FAST_ON))
+    {
+        sendCommand(Command::TX);
+    }
+    txQueueOnAir = fifoLen > 0 || state == State::TX;
+    txQueueFifoEmpty = fifoLen == 0;
+}
+
+void CC1200::flushTxQueueFifo()
+{
+    // Everything in the FIFO goes.  The rest of a packet cut short cannot be sent on
+    // its own, so the refill carries on from the packet after it.
+    sendCommand(Command::FLUSH_TX);
+    if(txQueueTail != txQueueFrameEnd)
+    {
+        std::atomic_signal_fence(std::memory_order_release);
+        txQueueTail = txQueueFrameEnd;
+    }
+    txQueueLastFrameStart = txQueueTail;
+}
+
+bool CC1200::writeTxOffMode(bool stayInTx)
+{
+    // direct write, as in writeLengthConfig(); stopTxQueue() restores the original
+    uint8_t const header = static_cast<uint8_t>(Register::RFEND_CFG0) | CC1200_WRITE;
+    uint8_t const value = (txQueueSavedRfendCfg0 & ~(0b11 << RFEND_CFG0_TXOFF_MODE)) |
+                          ((stayInTx ? TXOFF_MODE_TX : TXOFF_MODE_FSTXON) << RFEND_CFG0_TXOFF_MODE);
+    return spiBurstWrite(&header, 1, &value, 1);
+}
+
+bool CC1200::startLongPacketRx(size_t fixedLen)
+{
+    if(longRxActive || longTxActive || streamTxActive || streamRxActive || txQueueActive || fixedLen > CC1200_LONG_RX_MAX_LEN)
+    {
+        return false;
+    }
+    updateFifoThreshold();
+
+    longRxSavedPktCfg0 = readCachedRegister(Register::PKT_CFG0);
+    longRxSavedPktLen = readCachedRegister(Register::PKT_LEN);
+    longRxSavedFifoCfg = readCachedRegister(Register::FIFO_CFG);
+    longRxSavedIocfg2 = readCachedRegister(Register::IOCFG2);
+    longRxSavedIocfg3 = readCachedRegister(Register::IOCFG3);
+    longRxSavedRfendCfg1 = readCachedRegister(Register::RFEND_CFG1);
+    longRxStatusAppended = readCachedRegister(Register::PKT_CFG1) & (1 << PKT_CFG1_APPEND_STATUS);
+    longRxFixedLen = fixedLen;
+
+    // As for TX, fixed length packets the byte counter cannot cover start in infinite mode
+    uint8_t lengthConfig;
+    uint8_t pktLen;
+    if(fixedLen == 0)
+    {
+        // in variable length mode PKT_LEN is the longest packet accepted
+        lengthConfig = LENGTH_CONFIG_VARIABLE;
+        pktLen = MAX_VARIABLE_PACKET_PAYLOAD;
+    }
+    else
+    {
+        lengthConfig = fixedLen > MAX_FIXED_PACKET_LENGTH ? LENGTH_CONFIG_INFINITE : LENGTH_CONFIG_FIXED;
+        pktLen = static_cast<uint8_t>(fixedLen & 0xFF);
+    }
+
+    // start from an empty FIFO, so the drain sees packets from their first byte
+    sendCommand(Command::IDLE);
+    waitForState(State::IDLE, FIFO_IDLE_TIMEOUT_US);
+    sendCommand(Command::FLUSH_RX);
+
+    {
+        ConfigTransaction txn(*this);
+        uint8_t const pktCfg0 = (longRxSavedPktCfg0 & ~(0b11 << PKT_CFG0_LENGTH_CONFIG)) | (lengthConfig << PKT_CFG0_LENGTH_CONFIG);
+        writeRegister(Register::PKT_CFG0, pktCfg0);
+        writeRegister(Register::PKT_LEN, pktLen);
+
+        // no CRC_AUTOFLUSH: the drain has to see every byte of a packet it has started
+        writeRegister(Register::FIFO_CFG, fifoThreshold << FIFO_CFG_FIFO_THR);
+
+        // inverted PKT_SYNC_RXTX rises at the end of each packet
+        configureGPIO(RX_FIFO_GPIO, GPIOMode::RXFIFO_THR);
+        configureGPIO(PACKET_END_GPIO, GPIOMode::PKT_SYNC_RXTX, true);
+
+        uint8_t rfendCfg1 = longRxSavedRfendCfg1 & ~(0b11 << RFEND_CFG1_RXOFF_MODE);
+        rfendCfg1 |= RXOFF_MODE_RX << RFEND_CFG1_RXOFF_MODE;
+        writeRegister(Register::RFEND_CFG1, rfendCfg1);
+
+        if(!txn.commit())
+        {
+            restoreLongRxConfig();
+            return false;
+        }
+    }
+
+    longRxPacketOpen = false;
+    longRxSwitchToFixed = lengthConfig == LENGTH_CONFIG_INFINITE;
+    longRxDrainPending = false;
+    longRxActive = true;
+    sendCommand(Command::RX);
+    return true;
+}
+
+void CC1200::stopLongPacketRx()
+{
+    if(!longRxActive)
+    {
+        return;
+    }
+
+    // stop the interrupts first; a partly drained packet is lost
+    longRxActive = false;
+    longRxPacketOpen = false;
+
+    sendCommand(Command::IDLE);
+    waitForState(State::IDLE, FIFO_IDLE_TIMEOUT_US);
+    sendCommand(Command::FLUSH_RX);
+    restoreLongRxConfig();
+}
+
+void CC1200::restoreLongRxConfig()
+{
+    ConfigTransaction txn(*this);
+    writeRegister(Register::PKT_CFG0, longRxSavedPktCfg0);
+    writeRegister(Register::PKT_LEN, longRxSavedPktLen);
+    writeRegister(Register::FIFO_CFG, longRxSavedFifoCfg);
+    writeRegister(Register::IOCFG2, longRxSavedIocfg2);
+    writeRegister(Register::IOCFG3, longRxSavedIocfg3);
+    writeRegister(Register::RFEND_CFG1, longRxSavedRfendCfg1);
+    txn.commit();
+}
+
+CC1200::LongRxPacket const* CC1200::peekLongRxPacket() const
+{
+    if(longRxTail == longRxHead)
+    {
+        return nullptr;
+    }
+
+    // the slot was filled before the head moved past it
+    std::atomic_signal_fence(std::memory_order_acquire);
+    return &longRxRing[longRxTail & (CC1200_LONG_RX_SLOTS - 1)];
+}
+
+void CC1200::releaseLongRxPacket()
+{
+    if(longRxTail != longRxHead)
+    {
+        std::atomic_signal_fence(std::memory_order_release);
+        longRxTail = longRxTail + 1;
+    }
+}
+
+void CC1200::rxFifoThresholdCallback()
+{
+    if(streamRxActive)
+    {
+        framedStreamFifoCallback();
+        return;
+    }
+
+    if(!longRxActive)
+    {
+        return;
+    }
+
+    // never interleave with a transaction the interrupt cut into; releaseSPI() runs it
+    if(spiBusy)
+    {
+        longRxDrainPending = true;
+        return;
+    }
+
+    serviceLongRx();
+}
+
+void CC1200::packetEndCallback()
+{
+    if(txQueueActive)
+    {
+        // the next packet may need starting, or TXOFF_MODE changing for the one after it
+        if(spiBusy)
+        {
+            txQueueRefillPending = true;
+            return;
+        }
+        serviceTxQueue();
+        return;
+    }
+
+    // the tail of the packet is under the threshold, so drain whatever is there
+    rxFifoThresholdCallback();
+}
+
+void CC1200::serviceLongRx()
+{
+    // same scheme as serviceLongTx()
+    if(longRxDraining)
+    {
+        longRxDrainPending = true;
+        return;
+    }
+
+    longRxDraining = true;
+    uint32_t const serviceStart = bus.getTimestamp();
+    uint32_t const serviceStartBytes = spiDataBytes;
+    do
+    {
+        longRxDrainPending = false;
+        drainLongRx();
+    }
+    while(longRxDrainPending && longRxActive);
+    recordFifoService(serviceStart, serviceStartBytes);
+    longRxDraining = false;
+}
+
+void CC1200::drainLongRx()
+{
+    bool drained = false;
+    while(longRxActive)
+    {
+        size_t const fifoLen = getRXFIFOLen();
+        if(state == State::RX_FIFO_ERROR)
+        {
+            recoverLongRxOverflow();
+            return;
+        }
+
+        // Bytes that arrived during a drain may have kept RXFIFO_THR asserted, and then
+        // no new edge comes.  Go round until it has dropped.
+        if(fifoLen == 0 || (drained && fifoLen <= fifoThreshold))
+        {
+            return;
+        }
+
+        if(!drainLongRxBytes(fifoLen))
+        {
+            return;
+        }
+        drained = true;
+    }
+}
+
+bool CC1200::drainLongRxBytes(size_t fifoLen)
+{
+    uint8_t const header = CC1200_DEQUEUE_RX_FIFO | CC1200_BURST;
+
+    while(fifoLen > 0)
+    {
+        if(!longRxPacketOpen)
+        {
+            size_t payloadLen = longRxFixedLen;
+            if(payloadLen == 0)
+            {
+                uint8_t lengthByte = 0;
+                if(!spiBurstRead(&header, 1, &lengthByte, 1))
+                {
+                    return false;
+                }
+                --fifoLen;
+                payloadLen = lengthByte;
+            }
+
+            longRxPayloadLen = payloadLen;
+            longRxExpected = payloadLen + (longRxStatusAppended ? PACKET_STATUS_LEN : 0);
+            longRxReceived = 0;
+            longRxPacketOpen = true;
+            longRxDropping = longRxHead - longRxTail >= CC1200_LONG_RX_SLOTS;
+            if(longRxDropping)
+            {
+                ++longRxDropped;
+            }
+            if(longRxExpected == 0)
+            {
+                completeLongRxPacket();
+            }
+            continue;
+        }
+
+        // fewer than 256 payload bytes are still to arrive, so the byte counter next
+        // reaches PKT_LEN at the end of the packet (see refillLongTx()).  The counter
+        // doesn't count the appended status bytes, so neither does this.
+        if(longRxSwitchToFixed && longRxReceived + fifoLen + MAX_FIXED_PACKET_LENGTH > longRxPayloadLen)
+        {
+            if(!writeLengthConfig(longRxSavedPktCfg0, LENGTH_CONFIG_FIXED))
+            {
+                return false;
+            }
+            longRxSwitchToFixed = false;
+        }
+
+        size_t chunk = longRxExpected - longRxReceived;
+        if(chunk > fifoLen)
+        {
+            chunk = fifoLen;
+        }
+
+        // payload bytes go to data, the appended status bytes to status
+        size_t payloadChunk = 0;
+        if(longRxReceived < longRxPayloadLen)
+        {
+            payloadChunk = longRxPayloadLen - longRxReceived;
+            if(payloadChunk > chunk)
+            {
+                payloadChunk = chunk;
+            }
+        }
+
+        LongRxPacket& slot = longRxRing[longRxHead & (CC1200_LONG_RX_SLOTS - 1)];
+        spiBegin(&header, 1);
+        spiReadBytes(longRxDropping ? nullptr : slot.data + longRxReceived, payloadChunk);
+        if(chunk > payloadChunk)
+        {
+            size_t const statusOffset = longRxReceived + payloadChunk - longRxPayloadLen;
+            spiReadBytes(longRxDropping ? nullptr : slot.status + statusOffset, chunk - payloadChunk);
+        }
+        if(!spiEnd())
+        {
+            return false;
+        }
+
+        fifoLen -= chunk;
+        longRxReceived += chunk;
+        if(longRxReceived == longRxExpected)
+        {
+            completeLongRxPacket();
+        }
+    }
+
+    return true;
+}
+
+void CC1200::completeLongRxPacket()
+{
+    if(!longRxDropping)
+    {
+        LongRxPacket& slot = longRxRing[longRxHead & (CC1200_LONG_RX_SLOTS - 1)];
+        slot.length = static_cast<uint16_t>(longRxPayloadLen);
+        slot.hasStatus = longRxStatusAppended;
+        slot.crcOk = !longRxStatusAppended || (slot.status[1] & PACKET_STATUS_CRC_OK);
+
+        // publish the slot only once it is filled in
+        std::atomic_signal_fence(std::memory_order_release);
+        longRxHead = longRxHead + 1;
+
+        if(longRxPacketHandler)
+        {
+            longRxPacketHandler();
+        }
+    }
+
+    longRxPacketOpen = false;
+    rearmLongRxLengthMode();
+}
+
+void CC1200::rearmLongRxLengthMode()
+{
+    // The chip stays in RX after a packet with the length mode the last one ended in.  A
+    // long fixed length packet ended in fixed mode, so go back to infinite before the
+    // next one counts up to PKT_LEN.
+    if(longRxFixedLen > MAX_FIXED_PACKET_LENGTH && !longRxSwitchToFixed)
+    {
+        writeLengthConfig(longRxSavedPktCfg0, LENGTH_CONFIG_INFINITE);
+        longRxSwitchToFixed = true;
+    }
+}
+
+void CC1200::recoverLongRxOverflow()
+{
+    // the partly drained packet is lost; SFRX leaves RX_FIFO_ERROR for IDLE
+    ++longRxOverflows;
+    longRxPacketOpen = false;
+    sendCommand(Command::FLUSH_RX);
+    rearmLongRxLengthMode();
+    sendCommand(Command::RX);
+}
+
+// helper function: CRC-16/CCITT-FALSE, a nibble at a time
+static uint16_t streamCrcUpdate(uint16_t crc, uint8_t const* data, size_t len)
+{
+    static uint16_t const table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
+    for(size_t i = 0; i < len; ++i)
+    {
+        crc = static_cast<uint16_t>((crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)]);
+        crc = static_cast<uint16_t>((crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)]);
+    }
+    return crc;
+}
+
+bool CC1200::configureFramedStream(bool tx)
+{
+    if(longTxActive || longRxActive || streamTxActive || streamRxActive || txQueueActive)
+    {
+        return false;
+    }
+    updateFifoThreshold();
+
+    streamSavedPktCfg0 = readCachedRegister(Register::PKT_CFG0);
+    streamSavedFifoCfg = readCachedRegister(Register::FIFO_CFG);
+    streamSavedIocfg0 = readCachedRegister(Register::IOCFG0);
+    streamSavedIocfg2 = readCachedRegister(Register::IOCFG2);
+
+    sendCommand(Command::IDLE);
+    waitForState(State::IDLE, FIFO_IDLE_TIMEOUT_US);
+    sendCommand(tx ? Command::FLUSH_TX : Command::FLUSH_RX);
+
+    ConfigTransaction txn(*this);
+    uint8_t const pktCfg0 = (streamSavedPktCfg0 & ~(0b11 << PKT_CFG0_LENGTH_CONFIG)) | (LENGTH_CONFIG_INFINITE << PKT_CFG0_LENGTH_CONFIG);
+    writeRegister(Register::PKT_CFG0, pktCfg0);
+
+    // no CRC_AUTOFLUSH: the frames carry their own CRC
+    writeRegister(Register::FIFO_CFG, fifoThreshold << FIFO_CFG_FIFO_THR);
+    if(tx)
+    {
+        configureGPIO(TX_FIFO_GPIO, GPIOMode::TXFIFO_THR, true);
+    }
+    else
+    {
+        configureGPIO(RX_FIFO_GPIO, GPIOMode::RXFIFO_THR);
+    }
+    if(!txn.commit())
+    {
+        restoreFramedStreamConfig();
+        return false;
+    }
+
+    streamStats = {};
+    streamServicePending = false;
+    return true;
+}
+
+void CC1200::restoreFramedStreamConfig()
+{
+    ConfigTransaction txn(*this);
+    writeRegister(Register::PKT_CFG0, streamSavedPktCfg0);
+    writeRegister(Register::FIFO_CFG, streamSavedFifoCfg);
+    writeRegister(Register::IOCFG0, streamSavedIocfg0);
+    writeRegister(Register::IOCFG2, streamSavedIocfg2);
+    txn.commit();
+}
+
+bool CC1200::startFramedStreamTx()
+{
+    if(!configureFramedStream(true))
+    {
+        return false;
+    }
+
+    streamTxFrameLen = 0;
+    streamTxFramePos = 0;
+    streamTxSequence = 0;
+    streamTxDraining = false;
+    if(!primeFramedStreamTx())
+    {
+        restoreFramedStreamConfig();
+        return false;
+    }
+
+    streamTxActive = true;
+    sendCommand(Command::TX);
+    return true;
+}
+
+bool CC1200::stopFramedStreamTx(uint32_t drainTimeoutMs)
+{
+    if(!streamTxActive)
+    {
+        return false;
+    }
+
+    if(drainTimeoutMs > 0)
+    {
+        // With no idle frames to pad it out, the transmission ends in TX_FIFO_ERROR
+        // right after the last queued byte.  Service first, so the frame the FIFO ends
+        // partway through is finished before it runs dry.
+        streamTxDraining = true;
+        uint32_t const start = bus.getMillis();
+        while(streamTxHead != streamTxTail || streamTxFramePos != streamTxFrameLen || state != State::TX_FIFO_ERROR)
+        {
+            if(bus.getMillis() - start > drainTimeoutMs)
+            {
+                break;
+            }
+            pollFramedStream();
+            bus.delayMs(1);
+        }
+    }
+
+    bool const sent = streamTxHead == streamTxTail && streamTxFramePos == streamTxFrameLen;
+
+    streamTxActive = false;
+    streamTxDraining = false;
+    updateState();
+    if(state != State::TX_FIFO_ERROR)
+    {
+        sendCommand(Command::IDLE);
+        waitForState(State::IDLE, FIFO_IDLE_TIMEOUT_US);
+    }
+    sendCommand(Command::FLUSH_TX);
+    restoreFramedStreamConfig();
+
+    // the interrupt is off, so the consumer side of the ring is ours
+    streamTxTail = streamTxHead;
+    streamTxFrameLen = 0;
+    streamTxFramePos = 0;
+    return sent;
+}
+
+size_t CC1200::framedStreamWrite(uint8_t const* data, size_t len)
+{
+    size_t const space = getFramedStreamTxFree();
+    if(len > space)
+    {
+        len = space;
+    }
+
+    ringWrite(streamTxRing, CC1200_STREAM_RING_LEN, streamTxHead, data, len);
+    std::atomic_signal_fence(std::memory_order_release);
+    streamTxHead = streamTxHead + len;
+    return len;
+}
+
+bool CC1200::startFramedStreamRx()
+{
+    if(!configureFramedStream(false))
+    {
+        return false;
+    }
+
+    streamRxState = StreamRxState::SYNC0;
+    streamRxSequenceValid = false;
+    streamRxUnframedBytes = 0;
+    streamRxActive = true;
+    sendCommand(Command::RX);
+    return true;
+}
+
+void CC1200::stopFramedStreamRx()
+{
+    if(!streamRxActive)
+    {
+        return;
+    }
+
+    streamRxActive = false;
+    sendCommand(Command::IDLE);
+    waitForState(State::IDLE, FIFO_IDLE_TIMEOUT_US);
+    sendCommand(Command::FLUSH_RX);
+    restoreFramedStreamConfig();
+}
+
+size_t CC1200::framedStreamRead(uint8_t* buffer, size_t maxLen)
+{
+    size_t len = getFramedStreamRxAvailable();
+    if(len > maxLen)
+    {
+        len = maxLen;
+    }
+
+    std::atomic_signal_fence(std::memory_order_acquire);
+    ringRead(streamRxRing, CC1200_STREAM_RING_LEN, streamRxTail, buffer, len);
+    std::atomic_signal_fence(std::memory_order_release);
+    streamRxTail = streamRxTail + len;
+    return len;
+}
+
+void CC1200::pollFramedStream()
+{
+    if(streamTxActive || streamRxActive)
+    {
+        serviceFramedStream();
+    }
+}
+
+void CC1200::framedStreamFifoCallback()
+{
+    // never interleave with a transaction the interrupt cut into; releaseSPI() runs it
+    if(spiBusy)
+    {
+        streamServicePending = true;
+        return;
+    }
+
+    serviceFramedStream();
+}
+
+void CC1200::serviceFramedStream()
+{
+    // same scheme as serviceLongTx()
+    if(streamServicing)
+    {
+        streamServicePending = true;
+        return;
+    }
+
+    streamServicing = true;
+    uint32_t const serviceStart = bus.getTimestamp();
+    uint32_t const serviceStartBytes = spiDataBytes;
+    do
+    {
+        streamServicePending = false;
+        if(streamTxActive)
+        {
+            refillFramedStreamTx();
+        }
+        else if(streamRxActive)
+        {
+            drainFramedStreamRx();
+        }
+    }
+    while(streamServicePending && (streamTxActive || streamRxActive));
+    recordFifoService(serviceStart, serviceStartBytes);
+    streamServicing = false;
+}
+
+size_t CC1200::buildFramedStreamTx(uint8_t* out, size_t maxLen)
+{
+    size_t len = 0;
+    while(len < maxLen)
+    {
+        if(streamTxFramePos == streamTxFrameLen)
+        {
+            // next frame, taking whatever is queued up to a full payload
+            size_t payload = streamTxHead - streamTxTail;
+            if(payload == 0 && streamTxDraining)
+            {
+                break;
+            }
+            if(payload > CC1200_STREAM_FRAME_PAYLOAD)
+            {
+                payload = CC1200_STREAM_FRAME_PAYLOAD;
+            }
+
+            streamTxFrame[0] = STREAM_FRAME_SYNC0;
+            streamTxFrame[1] = STREAM_FRAME_SYNC1;
+            streamTxFrame[2] = streamTxSequence++;
+            streamTxFrame[3] = static_cast<uint8_t>(payload);
+            std::atomic_signal_fence(std::memory_order_acquire);
+            ringRead(streamTxRing, CC1200_STREAM_RING_LEN, streamTxTail, streamTxFrame + STREAM_FRAME_HEADER_LEN, payload);
+            std::atomic_signal_fence(std::memory_order_release);
+            streamTxTail = streamTxTail + payload;
+
+            uint16_t const crc = streamCrcUpdate(STREAM_CRC_INIT, streamTxFrame + 2, payload + 2);
+            streamTxFrame[STREAM_FRAME_HEADER_LEN + payload] = static_cast<uint8_t>(crc >> 8);
+            streamTxFrame[STREAM_FRAME_HEADER_LEN + payload + 1] = static_cast<uint8_t>(crc & 0xFF);
+            streamTxFrameLen = payload + CC1200_STREAM_FRAME_OVERHEAD;
+            streamTxFramePos = 0;
+
+            ++streamStats.txFrames;
+            if(payload == 0)
+            {
+                ++streamStats.txIdleFrames;
+            }
+        }
+
+        size_t chunk = streamTxFrameLen - streamTxFramePos;
+        if(chunk > maxLen - len)
+        {
+            chunk = maxLen - len;
+        }
+        memcpy(out + len, streamTxFrame + streamTxFramePos, chunk);
+        streamTxFramePos += chunk;
+        len += chunk;
+    }
+    return len;
+}
+
+bool CC1200::primeFramedStreamTx()
+{
+    uint8_t buffer[CC1200_FIFO_SIZE];
+    size_t const len = buildFramedStreamTx(buffer, sizeof(buffer));
+    uint8_t const header = CC1200_ENQUEUE_TX_FIFO | CC1200_BURST;
+    return spiBurstWrite(&header, 1, buffer, len);
+}
+
+void CC1200::refillFramedStreamTx()
+{
+    size_t const fifoLen = getTXFIFOLen();
+    if(state == State::TX_FIFO_ERROR)
+    {
+        if(streamTxDraining && streamTxHead == streamTxTail && streamTxFramePos == streamTxFrameLen)
+        {
+            // the end of a drain, see stopFramedStreamTx()
+            return;
+        }
+
+        // The FIFO ran dry and the packet has ended.  Start a new one, resending the frame
+        // that was cut short; a receiver that restarted RX syncs to it.
+        ++streamStats.txUnderflows;
+        sendCommand(Command::FLUSH_TX);
+        streamTxFramePos = 0;
+        if(primeFramedStreamTx())
+        {
+            sendCommand(Command::TX);
+        }
+        return;
+    }
+
+    uint8_t buffer[CC1200_FIFO_SIZE];
+    size_t const len = buildFramedStreamTx(buffer, CC1200_FIFO_SIZE - fifoLen);
+    if(len > 0)
+    {
+        uint8_t const header = CC1200_ENQUEUE_TX_FIFO | CC1200_BURST;
+        spiBurstWrite(&header, 1, buffer, len);
+    }
+}
+
+void CC1200::drainFramedStreamRx()
+{
+    uint8_t const header = CC1200_DEQUEUE_RX_FIFO | CC1200_BURST;
+
+    bool drained = false;
+    while(streamRxActive)
+    {
+        size_t const fifoLen = getRXFIFOLen();
+        if(state == State::RX_FIFO_ERROR)
+        {
+            ++streamStats.rxFifoOverflows;
+            restartFramedStreamRx();
+            return;
+        }
+
+        // as in drainLongRx(), go round until RXFIFO_THR has dropped
+        if(fifoLen == 0 || (drained && fifoLen <= fifoThreshold))
+        {
+            return;
+        }
+
+        uint8_t buffer[CC1200_FIFO_SIZE];
+        if(!spiBurstRead(&header, 1, buffer, fifoLen))
+        {
+            return;
+        }
+        drained = true;
+
+        if(!parseFramedStreamRx(buffer, fifoLen))
+        {
+            ++streamStats.rxResyncs;
+            restartFramedStreamRx();
+            return;
+        }
+    }
+}
+
+bool CC1200::parseFramedStreamRx(uint8_t const* data, size_t len)
+{
+    size_t i = 0;
+    while(i < len)
+    {
+        if(streamRxState == StreamRxState::PAYLOAD)
+        {
+            // the bulk of the stream: copy the run of payload bytes in one go, into the
+            // ring past the head, which only moves once the CRC checks out
+            size_t run = streamRxLength - streamRxPayloadPos;
+            if(run > len - i)
+            {
+                run = len - i;
+            }
+            streamRxCrc = streamCrcUpdate(streamRxCrc, data + i, run);
+            if(!streamRxDropping)
+            {
+                ringWrite(streamRxRing, CC1200_STREAM_RING_LEN, streamRxHead + streamRxPayloadPos, data + i, run);
+            }
+            streamRxPayloadPos += run;
+            streamRxUnframedBytes += run;
+            i += run;
+            if(streamRxPayloadPos == streamRxLength)
+            {
+                streamRxState = StreamRxState::CRC_HIGH;
+            }
+            continue;
+        }
+
+        uint8_t const value = data[i++];
+        ++streamRxUnframedBytes;
+        switch(streamRxState)
+        {
+            case StreamRxState::SYNC0:
+                if(value == STREAM_FRAME_SYNC0)
+                {
+                    streamRxState = StreamRxState::SYNC1;
+                }
+                break;
+
+            case StreamRxState::SYNC1:
+                if(value == STREAM_FRAME_SYNC1)
+                {
+                    streamRxState = StreamRxState::SEQUENCE;
+                }
+                else if(value != STREAM_FRAME_SYNC0)
+                {
+                    streamRxState = StreamRxState::SYNC0;
+                }
+                break;
+
+            case StreamRxState::SEQUENCE:
+                streamRxSequence = value;
+                streamRxCrc = streamCrcUpdate(STREAM_CRC_INIT, &value, 1);
+                streamRxState = StreamRxState::LENGTH;
+                break;
+
+            case StreamRxState::LENGTH:
+                if(value > CC1200_STREAM_FRAME_PAYLOAD)
+                {
+                    // not a frame after all; hunt for the next sync word
+                    ++streamStats.rxBadFrames;
+                    streamRxState = StreamRxState::SYNC0;
+                    break;
+                }
+                streamRxLength = value;
+                streamRxPayloadPos = 0;
+                streamRxCrc = streamCrcUpdate(streamRxCrc, &value, 1);
+                streamRxDropping = getFramedStreamRxAvailable() + value > CC1200_STREAM_RING_LEN;
+                streamRxState = value > 0 ? StreamRxState::PAYLOAD : StreamRxState::CRC_HIGH;
+                break;
+
+            case StreamRxState::CRC_HIGH:
+                streamRxFrameCrc = static_cast<uint16_t>(value << 8);
+                streamRxState = StreamRxState::CRC_LOW;
+                break;
+
+            case StreamRxState::CRC_LOW:
+                // A bad frame is skipped whole, so a real sync word inside it is missed
+                // and the frame after it is the next one found.
+                streamRxState = StreamRxState::SYNC0;
+                if((streamRxFrameCrc | value) != streamRxCrc)
+                {
+                    ++streamStats.rxBadFrames;
+                    break;
+                }
+
+                ++streamStats.rxFrames;
+                if(streamRxLength == 0)
+                {
+                    ++streamStats.rxIdleFrames;
+                }
+                if(streamRxSequenceValid)
+                {
+                    streamStats.rxLostFrames += static_cast<uint8_t>(streamRxSequence - streamRxNextSequence);
+                }
+                streamRxNextSequence = static_cast<uint8_t>(streamRxSequence + 1);
+                streamRxSequenceValid = true;
+                streamRxUnframedBytes = 0;
+
+                if(streamRxDropping)
+                {
+                    ++streamStats.rxRingOverflows;
+                }
+                else if(streamRxLength > 0)
+                {
+                    std::atomic_signal_fence(std::memory_order_release);
+                    streamRxHead = streamRxHead + streamRxLength;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return streamRxUnframedBytes < STREAM_RX_RESYNC_BYTES;
+}
+
+void CC1200::restartFramedStreamRx()
+{
+    // Back to sync search.  In infinite length mode the radio stays locked to whatever it
+    // synced to, so this is the only way to recover from a lost or never found stream.
+    // SFRX is only accepted in IDLE and RX_FIFO_ERROR.
+    if(state != State::RX_FIFO_ERROR)
+    {
+        sendCommand(Command::IDLE);
+        waitForState(State::IDLE, FIFO_IDLE_TIMEOUT_US);
+    }
+    sendCommand(Command::FLUSH_RX);
+
+    streamRxState = StreamRxState::SYNC0;
+    streamRxSequenceValid = false;
+    streamRxUnframedBytes = 0;
+    sendCommand(Command::RX);
+}
+
+// Register access functions
+uint8_t CC1200::readRegister(Register reg)
+{
+    uint8_t const header = static_cast<uint8_t>(reg) | CC1200_READ;
+    uint8_t value = 0;
+    spiBurstRead(&header, 1, &value, 1);
+    return value;
+}
+
+void CC1200::writeRegister(Register reg, uint8_t value)
+{
+    writeRegisters(reg, &value, 1);
+}
+
+void CC1200::writeRegisters(Register startReg, uint8_t const* values, size_t numRegisters)
+{
+    updateShadow(startReg, values, numRegisters);
+
+    if(configTxnDepth > 0 && static_cast<uint8_t>(startReg) + numRegisters <= NUM_REGISTERS)
+    {
+        // deferred until the transaction commits
+        regDirty |= ((1ULL << numRegisters) - 1) << static_cast<uint8_t>(startReg);
+        return;
+    }
 
-    // Set packet format settings for this driver
-    // enable CRC but disable status bytes
-    writeRegister(Register::PKT_CFG1, (0b01 << PKT_CFG1_CRC_CFG));
+    uint8_t const header = static_cast<uint8_t>(startReg) | CC1200_WRITE | CC1200_BURST;
+    spiConfigBurstWrite(&header, 1, values, numRegisters);
+}
 
-    return true;
+void CC1200::readRegisters(Register startReg, uint8_t* values, size_t numRegisters)
+{
+    uint8_t const header = static_cast<uint8_t>(startReg) | CC1200_READ | CC1200_BURST;
+    spiBurstRead(&header, 1, values, numRegisters);
 }
 
-void CC1200::updateState()
+uint8_t CC1200::readRegister(ExtRegister reg)
 {
-    // Read the status byte to update the internal state
-    select();
-    uint8_t status = spiTransfer(CC1200_NOP);
-    deselect();
-    
-    loadStatusByte(status);
+    uint8_t const header[2] = {CC1200_EXT_ADDR | CC1200_READ, static_cast<uint8_t>(reg)};
+    uint8_t value = 0;
+    spiBurstRead(header, 2, &value, 1);
+    return value;
 }
 
-void CC1200::loadStatusByte(uint8_t status)
+void CC1200::writeRegister(ExtRegister reg, uint8_t value)
 {
-    lastStatus = status;
-    
-    // Extract the chip state from the status byte
-    uint8_t stateValue = (status >> 4) & 0x7;
-    state = static_cast<State>(stateValue);
-    
-    // Check if the chip is ready
-    chipReady = (status & 0x80) == 0;
+    writeRegisters(reg, &value, 1);
 }
 
-size_t CC1200::getTXFIFOLen()
+void CC1200::writeRegisters(ExtRegister startReg, uint8_t const* values, size_t numRegisters)
 {
-    return readRegister(ExtRegister::NUM_TXBYTES);
+    updateShadow(startReg, values, numRegisters);
+
+    if(configTxnDepth > 0 && static_cast<uint8_t>(startReg) + numRegisters <= NUM_EXT_CONFIG_REGISTERS)
+    {
+        // deferred until the transaction commits
+        extRegDirty |= ((1ULL << numRegisters) - 1) << static_cast<uint8_t>(startReg);
+        return;
+    }
+
+    uint8_t const header[2] = {CC1200_EXT_ADDR | CC1200_WRITE | CC1200_BURST, static_cast<uint8_t>(startReg)};
+    spiConfigBurstWrite(header, 2, values, numRegisters);
 }
 
-size_t CC1200::getRXFIFOLen()
+void CC1200::readRegisters(ExtRegister startReg, uint8_t* values, size_t numRegisters)
 {
-    return readRegister(ExtRegister::NUM_RXBYTES);
+    uint8_t const header[2] = {CC1200_EXT_ADDR | CC1200_READ | CC1200_BURST, static_cast<uint8_t>(startReg)};
+    spiBurstRead(header, 2, values, numRegisters);
 }
 
-bool CC1200::enqueuePacket(char const* data, size_t len)
+void CC1200::sendCommand(Command command)
 {
-    uint8_t totalLength = len + 1; // add one byte for length byte
+    uint8_t const header = static_cast<uint8_t>(command);
+    spiBurstWrite(&header, 1, nullptr, 0);
 
-    if(totalLength > MAX_PACKET_LENGTH)
+    if(command == Command::RX || command == Command::TX)
     {
-        // packet too big
-        return false;
+        fifoResumeState = command == Command::RX ? State::RX : State::TX;
     }
-
-    uint8_t txFreeBytes = CC1200_FIFO_SIZE - getTXFIFOLen();
-    if(totalLength > txFreeBytes)
+    else if(command == Command::IDLE || command == Command::SLEEP || command == Command::SOFT_RESET)
     {
-        // packet doesn't fit in TX FIFO
-        return false;
+        fifoResumeState = State::IDLE;
     }
 
-    // burst write to TX FIFO
-    select();
-    loadStatusByte(spiTransfer(CC1200_ENQUEUE_TX_FIFO | CC1200_BURST));
-    if(_packetMode == PacketMode::VARIABLE_LENGTH)
+    if(command == Command::SOFT_RESET)
     {
-        spiTransfer(len);
+        // all registers go back to their reset values
+        shadowValid = false;
+        rxStageStart = rxStageLen = rxStageOlderEnd = 0;
+        dropRxPoolPacket();
     }
-    for(size_t byteIndex = 0; byteIndex < len; ++byteIndex)
+    else if(command == Command::FLUSH_RX)
     {
-        spiTransfer(data[byteIndex]);
+        // the rest of a partly received packet went with the FIFO
+        if(rxStageLen > rxStageStart)
+        {
+            rxStageLen = completeStagedBytes();
+        }
+        dropRxPoolPacket();
     }
-    deselect();
+}
 
-#if CC1200_DEBUG
-    char msg[64];
-    snprintf(msg, sizeof(msg), "Wrote packet of data length %zu:", len);
-    sendStringToDebugUart(std::string(msg));
-    if(_packetMode == PacketMode::VARIABLE_LENGTH)
+uint8_t CC1200::readRXFIFOByte(uint8_t address)
+{
+    uint8_t const header[2] = {CC1200_MEM_ACCESS | CC1200_READ, static_cast<uint8_t>(CC1200_RX_FIFO | address)};
+    uint8_t value = 0;
+    spiBurstRead(header, 2, &value, 1);
+    return value;
+}
+
+// Register shadow functions
+
+// helper function: true if the given extended configuration register can be changed by
+// the chip itself (RC oscillator and synthesizer calibration results, AFC frequency
+// offset), and so must always be read from hardware.
+static bool isVolatileExtRegister(uint8_t address)
+{
+    switch(address)
     {
-        char lenMsg[16];
-        snprintf(lenMsg, sizeof(lenMsg), " %02X", static_cast<uint8_t>(len));
-        sendStringToDebugUart(std::string(lenMsg));
+        case 0x07: // RCCAL_FINE
+        case 0x08: // RCCAL_COARSE
+        case 0x09: // RCCAL_OFFSET
+        case static_cast<uint8_t>(CC1200::ExtRegister::FREQOFF1):
+        case static_cast<uint8_t>(CC1200::ExtRegister::FREQOFF2):
+        case static_cast<uint8_t>(CC1200::ExtRegister::FS_CHP):
+        case static_cast<uint8_t>(CC1200::ExtRegister::FS_VCO4):
+        case static_cast<uint8_t>(CC1200::ExtRegister::FS_VCO2):
+            return true;
+        default:
+            return false;
     }
-    for(size_t byteIndex = 0; byteIndex < len; ++byteIndex)
+}
+
+uint8_t CC1200::readCachedRegister(Register reg)
+{
+    uint8_t address = static_cast<uint8_t>(reg);
+    if(address < NUM_REGISTERS && (shadowValid || (regDirty & (1ULL << address))))
     {
-        char byteMsg[16];
-        snprintf(byteMsg, sizeof(byteMsg), " %02X", static_cast<uint8_t>(data[byteIndex]));
-        sendStringToDebugUart(std::string(byteMsg));
+        return regShadow[address];
     }
-    sendStringToDebugUart("\n");
-#endif
-
-    return true;
+    return readRegister(reg);
 }
 
-bool CC1200::hasReceivedPacket()
+uint8_t CC1200::readCachedRegister(ExtRegister reg)
 {
-    size_t rxBytes = getRXFIFOLen();
-    if(rxBytes == 0)
+    uint8_t address = static_cast<uint8_t>(reg);
+    if(address < NUM_EXT_CONFIG_REGISTERS &&
+       ((shadowValid && !isVolatileExtRegister(address)) || (extRegDirty & (1ULL << address))))
     {
-        return false;
+        return extRegShadow[address];
     }
+    return readRegister(reg);
+}
 
-    if(_packetMode == PacketMode::FIXED_LENGTH)
+void CC1200::updateShadow(Register startReg, uint8_t const* values, size_t numRegisters)
+{
+    for(size_t address = static_cast<uint8_t>(startReg), i = 0; i < numRegisters && address < NUM_REGISTERS; ++address, ++i)
     {
-        return true;
+        regShadow[address] = values[i];
     }
-    else
-    {
-        // In variable length mode, we need at least 1 byte (the length byte)
-        if(rxBytes < 1)
-        {
-            return false;
-        }
+}
 
-        // Read the length byte
-        uint8_t packetLen = readRXFIFOByte(0);
-        
-        // Check if we have received the complete packet
-        // Add 1 for the length byte itself
-        return rxBytes >= packetLen + 1 + (_appendStatus ? PACKET_STATUS_LEN : 0);
+void CC1200::updateShadow(ExtRegister startReg, uint8_t const* values, size_t numRegisters)
+{
+    for(size_t address = static_cast<uint8_t>(startReg), i = 0; i < numRegisters && address < NUM_EXT_CONFIG_REGISTERS; ++address, ++i)
+    {
+        extRegShadow[address] = values[i];
     }
 }
 
-size_t CC1200::receivePacket(char* buffer, size_t bufferLen)
+bool CC1200::spiConfigBurstWrite(uint8_t const* header, size_t headerLen, uint8_t const* data, size_t len)
 {
-    size_t rxBytes = getRXFIFOLen();
-    if(rxBytes == 0)
+    // The polled path waits out the gap the chip needs between data bytes of a
+    // configuration register burst, whatever the polled length threshold.
+    spiBegin(header, headerLen);
+    if(spiTxnOk && len > 0)
     {
-        return 0;
+        spiTxnLen += len;
+        spiTxnOk = bus.writePaced(data, len, CONFIG_BURST_GAP_NS);
     }
+    return spiEnd();
+}
 
-    size_t packetLen;
-    size_t headerLen;
+// Config transaction functions
 
-    if(_packetMode == PacketMode::FIXED_LENGTH)
-    {
-        packetLen = rxBytes;
-        headerLen = 0;
-    }
-    else
+// Largest run of unmodified registers that flushConfig() will rewrite from the shadow to
+// join two bursts.  Re-sending a couple of bytes is cheaper than a new header and CS cycle.
+#define CONFIG_MAX_BRIDGE_GAP 2
+
+// helper function for flushConfig: call flush(start, count) for each burst needed to write
+// the registers in the dirty mask.  canBridge(address) says whether an unmodified register
+// may be rewritten with its shadow value.
+template<typename CanBridge, typename Flush>
+static bool forEachDirtyRun(uint64_t dirty, size_t numRegisters, CanBridge canBridge, Flush flush)
+{
+    bool success = true;
+    size_t address = 0;
+
+    while(address < numRegisters)
     {
-        // In variable length mode, first byte is the length
-        if(rxBytes < 1)
+        if(!(dirty & (1ULL << address)))
         {
-            return 0;
+            ++address;
+            continue;
         }
 
-        // Read the length byte
-        uint8_t lengthByte = readRXFIFOByte(0);
-        packetLen = lengthByte;
-        headerLen = 1;
-
-        // Check if we have received the complete packet
-        if(rxBytes < packetLen + headerLen + (_appendStatus ? PACKET_STATUS_LEN : 0))
+        size_t start = address;
+        size_t end = address + 1; // one past the last register of the run
+        while(end < numRegisters)
         {
-            return 0;
-        }
-    }
+            if(dirty & (1ULL << end))
+            {
+                ++end;
+                continue;
+            }
 
-    // Limit to buffer size
-    size_t bytesToRead = packetLen;
-    if(bytesToRead > bufferLen)
-    {
-        bytesToRead = bufferLen;
-    }
+            // look for another dirty register a short, bridgeable gap away
+            size_t next = end;
+            while(next < numRegisters && next - end < CONFIG_MAX_BRIDGE_GAP && !(dirty & (1ULL << next)) && canBridge(next))
+            {
+                ++next;
+            }
+            if(next < numRegisters && (dirty & (1ULL << next)))
+            {
+                end = next;
+            }
+            else
+            {
+                break;
+            }
+        }
 
-    // Read the packet data
-    select();
-    loadStatusByte(spiTransfer(CC1200_DEQUEUE_RX_FIFO | CC1200_BURST));
-    
-    // Skip the length byte in variable length mode
-    if(_packetMode == PacketMode::VARIABLE_LENGTH)
-    {
-        spiTransfer(0);
-    }
-    
-    // Read the actual data
-    for(size_t i = 0; i < bytesToRead; i++)
-    {
-        buffer[i] = spiTransfer(0);
-    }
-    
-    // Skip any remaining bytes (including status bytes if appended)
-    for(size_t i = bytesToRead; i < packetLen + (_appendStatus ? PACKET_STATUS_LEN : 0); i++)
-    {
-        spiTransfer(0);
+        success = flush(start, end - start) && success;
+        address = end;
     }
-    
-    deselect();
 
-    return bytesToRead;
+    return success;
 }
 
-// Register access functions
-uint8_t CC1200::readRegister(Register reg)
+bool CC1200::flushConfig()
 {
-    select();
-    spiTransfer(static_cast<uint8_t>(reg) | CC1200_READ);
-    uint8_t value = spiTransfer(0);
-    deselect();
-    return value;
-}
+    bool success = forEachDirtyRun(regDirty, NUM_REGISTERS,
+        [this](size_t) { return shadowValid; },
+        [this](size_t start, size_t count)
+        {
+            uint8_t const header = static_cast<uint8_t>(start) | CC1200_WRITE | CC1200_BURST;
+            return spiConfigBurstWrite(&header, 1, regShadow + start, count);
+        });
 
-void CC1200::writeRegister(Register reg, uint8_t value)
-{
-    select();
-    spiTransfer(static_cast<uint8_t>(reg) | CC1200_WRITE);
-    spiTransfer(value);
-    deselect();
-}
+    success = forEachDirtyRun(extRegDirty, NUM_EXT_CONFIG_REGISTERS,
+        [this](size_t address) { return shadowValid && !isVolatileExtRegister(address); },
+        [this](size_t start, size_t count)
+        {
+            uint8_t const header[2] = {CC1200_EXT_ADDR | CC1200_WRITE | CC1200_BURST, static_cast<uint8_t>(start)};
+            return spiConfigBurstWrite(header, 2, extRegShadow + start, count);
+        }) && success;
 
-void CC1200::writeRegisters(Register startReg, uint8_t const* values, size_t numRegisters)
-{
-    select();
-    spiTransfer(static_cast<uint8_t>(startReg) | CC1200_WRITE | CC1200_BURST);
-    for(size_t i = 0; i < numRegisters; i++)
-    {
-        spiTransfer(values[i]);
-    }
-    deselect();
+    regDirty = 0;
+    extRegDirty = 0;
+    return success;
 }
 
-uint8_t CC1200::readRegister(ExtRegister reg)
+CC1200::ConfigTransaction::ConfigTransaction(CC1200& radio) :
+    radio(radio)
 {
-    select();
-    spiTransfer(CC1200_EXT_ADDR | CC1200_READ);
-    spiTransfer(static_cast<uint8_t>(reg));
-    uint8_t value = spiTransfer(0);
-    deselect();
-    return value;
+    ++radio.configTxnDepth;
 }
 
-void CC1200::writeRegister(ExtRegister reg, uint8_t value)
+CC1200::ConfigTransaction::~ConfigTransaction()
 {
-    select();
-    spiTransfer(CC1200_EXT_ADDR | CC1200_WRITE);
-    spiTransfer(static_cast<uint8_t>(reg));
-    spiTransfer(value);
-    deselect();
+    commit();
 }
 
-void CC1200::writeRegisters(ExtRegister startReg, uint8_t const* values, size_t numRegisters)
+bool CC1200::ConfigTransaction::commit()
 {
-    select();
-    spiTransfer(CC1200_EXT_ADDR | CC1200_WRITE | CC1200_BURST);
-    spiTransfer(static_cast<uint8_t>(startReg));
-    for(size_t i = 0; i < numRegisters; i++)
+    if(!open)
     {
-        spiTransfer(values[i]);
+        return true;
     }
-    deselect();
-}
+    open = false;
 
-void CC1200::sendCommand(Command command)
-{
-    select();
-    loadStatusByte(spiTransfer(static_cast<uint8_t>(command)));
-    deselect();
-}
+    if(--radio.configTxnDepth > 0)
+    {
+        // an enclosing transaction will write everything
+        return true;
+    }
 
-uint8_t CC1200::readRXFIFOByte(uint8_t address)
-{
-    select();
-    spiTransfer(CC1200_MEM_ACCESS | CC1200_READ);
-    spiTransfer(CC1200_RX_FIFO | address);
-    uint8_t value = spiTransfer(0);
-    deselect();
-    return value;
+    return radio.flushConfig();
 }
 
 // ASK_MIN_POWER_OFF is already defined as a constexpr in the header file
@@ -504,14 +2797,13 @@ size_t CC1200::writeStream(const char* buffer, size_t count)
         bytesToWrite = txFreeBytes;
     }
 
-    // Write to TX FIFO
-    select();
-    loadStatusByte(spiTransfer(CC1200_ENQUEUE_TX_FIFO | CC1200_BURST));
-    for(size_t i = 0; i < bytesToWrite; i++)
+    // Write to TX FIFO, straight from the caller's buffer
+    uint8_t const header = CC1200_ENQUEUE_TX_FIFO | CC1200_BURST;
+    TxSegment const data = {reinterpret_cast<uint8_t const*>(buffer), bytesToWrite};
+    if(!writeTxFifoSegments(&header, 1, &data, 1))
     {
-        spiTransfer(buffer[i]);
+        return 0;
     }
-    deselect();
 
     return bytesToWrite;
 }
@@ -527,7 +2819,7 @@ bool CC1200::writeStreamBlocking(const char* buffer, size_t count)
         if(written == 0)
         {
             // If no bytes were written, wait a bit and try again
-            HAL_Delay(1);
+            bus.delayMs(1);
         }
         else
         {
@@ -560,13 +2852,10 @@ size_t CC1200::readStream(char* buffer, size_t maxLen)
     }
 
     // Read from RX FIFO
-    select();
-    loadStatusByte(spiTransfer(CC1200_DEQUEUE_RX_FIFO | CC1200_BURST));
-    for(size_t i = 0; i < bytesToRead; i++)
+    if(!readRXFIFO(reinterpret_cast<uint8_t*>(buffer), bytesToRead))
     {
-        buffer[i] = spiTransfer(0);
+        return 0;
     }
-    deselect();
 
     return bytesToRead;
 }
@@ -574,13 +2863,13 @@ size_t CC1200::readStream(char* buffer, size_t maxLen)
 bool CC1200::readStreamBlocking(char* buffer, size_t count, std::chrono::microseconds timeout)
 {
     size_t bytesRead = 0;
-    uint32_t startTime = HAL_GetTick();
+    uint32_t startTime = bus.getMillis();
     uint32_t timeoutMs = timeout.count() / 1000; // Convert microseconds to milliseconds
     
     while(bytesRead < count)
     {
         // Check for timeout
-        if(HAL_GetTick() - startTime > timeoutMs)
+        if(bus.getMillis() - startTime > timeoutMs)
         {
             return false;
         }
@@ -590,7 +2879,7 @@ bool CC1200::readStreamBlocking(char* buffer, size_t count, std::chrono::microse
         if(read == 0)
         {
             // If no bytes were read, wait a bit and try again
-            HAL_Delay(1);
+            bus.delayMs(1);
         }
         else
         {
@@ -622,26 +2911,36 @@ uint8_t getOffModeBits(CC1200::State state)
 
 void CC1200::setOnReceiveState(State goodPacket, State badPacket)
 {
-    uint8_t rfendCfg0 = readRegister(Register::RFEND_CFG0);
-    
-    // Clear the RXOFF_MODE bits (bits 2-3)
-    rfendCfg0 &= ~(0b11 << RFEND_CFG0_RXOFF_MODE);
-    
+    ConfigTransaction txn(*this);
+
+    uint8_t rfendCfg1 = readCachedRegister(Register::RFEND_CFG1);
+
+    // Clear the RXOFF_MODE bits (bits 4-5)
+    rfendCfg1 &= ~(0b11 << RFEND_CFG1_RXOFF_MODE);
+
     // Set the new RXOFF_MODE bits
-    rfendCfg0 |= (getOffModeBits(goodPacket) << RFEND_CFG0_RXOFF_MODE);
-    
-    // Clear the RX_FINITE bits (bits 0-1)
-    rfendCfg0 &= ~(0b11 << RFEND_CFG0_RX_TIME);
-    
-    // Set the new RX_FINITE bits (use same state for now)
-    rfendCfg0 |= (getOffModeBits(badPacket) << RFEND_CFG0_RX_TIME);
-    
+    rfendCfg1 |= (getOffModeBits(goodPacket) << RFEND_CFG1_RXOFF_MODE);
+
+    writeRegister(Register::RFEND_CFG1, rfendCfg1);
+
+    // A bad packet ends like a good one unless TERM_ON_BAD_PACKET_EN sends the radio
+    // straight back to RX
+    uint8_t rfendCfg0 = readCachedRegister(Register::RFEND_CFG0);
+    if(badPacket == State::RX)
+    {
+        rfendCfg0 |= (1 << RFEND_CFG0_TERM_ON_BAD_PACKET_EN);
+    }
+    else
+    {
+        rfendCfg0 &= ~(1 << RFEND_CFG0_TERM_ON_BAD_PACKET_EN);
+    }
+
     writeRegister(Register::RFEND_CFG0, rfendCfg0);
 }
 
 void CC1200::setOnTransmitState(State txState)
 {
-    uint8_t rfendCfg0 = readRegister(Register::RFEND_CFG0);
+    uint8_t rfendCfg0 = readCachedRegister(Register::RFEND_CFG0);
     
     // Clear the TXOFF_MODE bits (bits 4-5)
     rfendCfg0 &= ~(0b11 << RFEND_CFG0_TXOFF_MODE);
@@ -654,7 +2953,7 @@ void CC1200::setOnTransmitState(State txState)
 
 void CC1200::setFSCalMode(FSCalMode mode)
 {
-    uint8_t fsCfg = readRegister(Register::FS_CFG);
+    uint8_t fsCfg = readCachedRegister(Register::FS_CFG);
     
     // Clear the FS_AUTOCAL bits (bits 4-6)
     fsCfg &= ~(0b111 << FS_CFG_FS_AUTOCAL);
@@ -707,19 +3006,99 @@ void CC1200::configureFIFOMode()
     uint8_t fifoCfg = 0;
     
     // Set CRC_AUTOFLUSH to 0 (don't auto-flush on CRC error)
-    // Set FIFO_THR to 0 (threshold at 32 bytes)
+    // Set FIFO_THR for the current data rate
+    fifoCfg |= (updateFifoThreshold() << FIFO_CFG_FIFO_THR);
     
     writeRegister(Register::FIFO_CFG, fifoCfg);
 }
 
+// Bytes left in the FIFO, or free in it, when the threshold interrupt fires.  TXFIFO_THR
+// deasserts at 126 - FIFO_THR bytes and RXFIFO_THR asserts with 127 - FIFO_THR free, so
+// take the smaller.
+static size_t fifoHeadroomBytes(uint8_t threshold)
+{
+    return CC1200_FIFO_SIZE - 2 - threshold;
+}
+
+uint8_t CC1200::updateFifoThreshold()
+{
+    // FIFO_CFG only changes while no interrupt driven path is using it
+    if(longTxActive || longRxActive || streamTxActive || streamRxActive || txQueueActive)
+    {
+        return fifoThreshold;
+    }
+
+    ModFormat const modFormat = static_cast<ModFormat>((readCachedRegister(Register::MODCFG_DEV_E) >> MODCFG_DEV_E_MOD_FORMAT) & 0b111);
+    float const bitsPerSymbol = (modFormat == ModFormat::FSK4 || modFormat == ModFormat::GFSK4) ? 2.0f : 1.0f;
+    float const bitRate = currentSymbolRate * bitsPerSymbol;
+    if(bitRate <= 0)
+    {
+        fifoThreshold = FIFO_INTERRUPT_THR;
+        fifoHeadroomUs = 0;
+        return fifoThreshold;
+    }
+
+    float const airByteUs = 8e6f / bitRate;
+    float const spiByteUs = 8e6f / bus.getClockFrequency(CC1200Bus::ClockClass::FAST);
+    float const overheadUs = fifoServiceOverheadTicks > 0 ?
+                             fifoServiceOverheadTicks * 1e6f / bus.getTimestampFrequency() : FIFO_SERVICE_OVERHEAD_US;
+
+    // The highest threshold moves the most bytes per interrupt.  Take the highest one whose
+    // headroom still covers a service moving threshold + 2 bytes.
+    uint8_t threshold = FIFO_THR_MIN;
+    for(uint8_t candidate = FIFO_THR_MAX; candidate > FIFO_THR_MIN; --candidate)
+    {
+        float const serviceUs = overheadUs + (candidate + 2) * spiByteUs;
+        if(fifoHeadroomBytes(candidate) * airByteUs >= CC1200_FIFO_SERVICE_MARGIN_US + FIFO_HEADROOM_FACTOR * serviceUs)
+        {
+            threshold = candidate;
+            break;
+        }
+    }
+
+    // FIFO_SERVICE_OVERHEAD_US is only a guess, and leaves out building the data and
+    // whatever else the service does.  Go no higher than the fixed threshold until a
+    // service has been timed.
+    if(fifoServiceOverheadTicks == 0 && threshold > FIFO_INTERRUPT_THR)
+    {
+        threshold = FIFO_INTERRUPT_THR;
+    }
+
+    fifoThreshold = threshold;
+    fifoHeadroomUs = static_cast<uint32_t>(fifoHeadroomBytes(threshold) * airByteUs);
+    return fifoThreshold;
+}
+
+uint32_t CC1200::getFifoServiceOverheadUs() const
+{
+    return static_cast<uint32_t>(static_cast<uint64_t>(fifoServiceOverheadTicks) * 1000000 / bus.getTimestampFrequency());
+}
+
+void CC1200::recordFifoService(uint32_t startTime, uint32_t startBytes)
+{
+    // Keep the worst time beyond what the bytes take on the bus: transactions, FIFO level
+    // reads and whatever else ran in the service.  The worst case decays, so it follows
+    // recent services rather than the slowest one since boot.
+    uint32_t const elapsed = bus.getTimestamp() - startTime;
+    uint64_t const busTicks = static_cast<uint64_t>(spiDataBytes - startBytes) * 8 * bus.getTimestampFrequency() /
+                              bus.getClockFrequency(CC1200Bus::ClockClass::FAST);
+    fifoServiceOverheadTicks -= fifoServiceOverheadTicks / FIFO_SERVICE_OVERHEAD_DECAY;
+    if(elapsed > busTicks && elapsed - busTicks > fifoServiceOverheadTicks)
+    {
+        fifoServiceOverheadTicks = static_cast<uint32_t>(elapsed - busTicks);
+    }
+}
+
 void CC1200::setPacketMode(PacketMode mode, bool appendStatus)
 {
+    ConfigTransaction txn(*this);
+
     _packetMode = mode;
     _appendStatus = appendStatus;
     
-    uint8_t pktCfg0 = readRegister(Register::PKT_CFG0);
+    uint8_t pktCfg0 = readCachedRegister(Register::PKT_CFG0);
     
-    // Set LENGTH_CONFIG field (bits 0-1)
+    // Set LENGTH_CONFIG field (bits 5-6)
     if(mode == PacketMode::FIXED_LENGTH)
     {
         // Clear the LENGTH_CONFIG bits for fixed length
@@ -732,20 +3111,25 @@ void CC1200::setPacketMode(PacketMode mode, bool appendStatus)
         pktCfg0 |= (0b01 << PKT_CFG0_LENGTH_CONFIG);
     }
     
-    // Set PKT_FORMAT field (bits 4-5) to 0 for normal mode
-    pktCfg0 &= ~(0b11 << PKT_CFG0_PKT_FORMAT);
+    writeRegister(Register::PKT_CFG0, pktCfg0);
+
+    // Set PKT_FORMAT field (bits 0-1) to 0 for normal mode
+    uint8_t pktCfg2 = readCachedRegister(Register::PKT_CFG2);
+    pktCfg2 &= ~(0b11 << PKT_CFG2_PKT_FORMAT);
+    writeRegister(Register::PKT_CFG2, pktCfg2);
     
-    // Set APPEND_STATUS field (bit 2)
+    // Set APPEND_STATUS field (bit 0), which is in PKT_CFG1
+    uint8_t pktCfg1 = readCachedRegister(Register::PKT_CFG1);
     if(appendStatus)
     {
-        pktCfg0 |= (1 << PKT_CFG0_APPEND_STATUS);
+        pktCfg1 |= (1 << PKT_CFG1_APPEND_STATUS);
     }
     else
     {
-        pktCfg0 &= ~(1 << PKT_CFG0_APPEND_STATUS);
+        pktCfg1 &= ~(1 << PKT_CFG1_APPEND_STATUS);
     }
     
-    writeRegister(Register::PKT_CFG0, pktCfg0);
+    writeRegister(Register::PKT_CFG1, pktCfg1);
 }
 
 void CC1200::setPacketLength(uint16_t length, uint8_t bitLength)
@@ -753,7 +3137,7 @@ void CC1200::setPacketLength(uint16_t length, uint8_t bitLength)
     if(bitLength > 8)
     {
         // For packets longer than 255 bytes, we need to use the PKT_CFG1 register
-        uint8_t pktCfg1 = readRegister(Register::PKT_CFG1);
+        uint8_t pktCfg1 = readCachedRegister(Register::PKT_CFG1);
         
         // Set PQT_EN field (bit 5) to 0
         pktCfg1 &= ~(1 << PKT_CFG1_PQT_EN);
@@ -774,7 +3158,7 @@ void CC1200::setPacketLength(uint16_t length, uint8_t bitLength)
 
 void CC1200::setCRCEnabled(bool enabled)
 {
-    uint8_t pktCfg1 = readRegister(Register::PKT_CFG1);
+    uint8_t pktCfg1 = readCachedRegister(Register::PKT_CFG1);
     
     // Clear the CRC_CFG bits (bits 2-3)
     pktCfg1 &= ~(0b11 << PKT_CFG1_CRC_CFG);
@@ -790,7 +3174,7 @@ void CC1200::setCRCEnabled(bool enabled)
 
 void CC1200::setModulationFormat(ModFormat format)
 {
-    uint8_t modcfgDevE = readRegister(Register::MODCFG_DEV_E);
+    uint8_t modcfgDevE = readCachedRegister(Register::MODCFG_DEV_E);
     
     // Clear the MOD_FORMAT bits (bits 4-6)
     modcfgDevE &= ~(0b111 << MODCFG_DEV_E_MOD_FORMAT);
@@ -803,44 +3187,30 @@ void CC1200::setModulationFormat(ModFormat format)
 
 void CC1200::setFSKDeviation(float deviation)
 {
-    // Calculate the register values for the given deviation
-    // See CC1200 user guide section 9.12
-    
-    float normalizedDeviation = deviation / CC1200_OSC_FREQ;
-    
-    // Find the best exponent (0-7)
-    uint8_t devE = 0;
-    float devM = normalizedDeviation * 524288.0f; // 2^19
-    
-    while(devM > 255.0f && devE < 7)
+    CC1200DeviationSetting setting = calcCC1200Deviation(static_cast<uint32_t>(deviation + 0.5f));
+    if(!setting.valid)
     {
-        devM /= 2.0f;
-        devE++;
-    }
-    
-    // Round to nearest integer
-    uint8_t devMInt = static_cast<uint8_t>(devM + 0.5f);
-    
-    // Make sure we don't exceed the maximum value
-    if(devMInt > 255)
-    {
-        devMInt = 255;
+        return;
     }
-    
+
+    ConfigTransaction txn(*this);
+
     // Update the DEVIATION_M register
-    writeRegister(Register::DEVIATION_M, devMInt);
-    
+    writeRegister(Register::DEVIATION_M, setting.mantissa);
+
     // Update the MODCFG_DEV_E register (preserve the MOD_FORMAT bits)
-    uint8_t modcfgDevE = readRegister(Register::MODCFG_DEV_E);
+    uint8_t modcfgDevE = readCachedRegister(Register::MODCFG_DEV_E);
     modcfgDevE &= ~(0b111 << MODCFG_DEV_E_DEV_E); // Clear DEV_E bits (bits 0-2)
-    modcfgDevE |= (devE << MODCFG_DEV_E_DEV_E); // Set new DEV_E bits
+    modcfgDevE |= (setting.exponent << MODCFG_DEV_E_DEV_E); // Set new DEV_E bits
     writeRegister(Register::MODCFG_DEV_E, modcfgDevE);
-    
-    // Calculate and store the actual deviation
-    float actualDeviation = static_cast<float>(devMInt) * std::pow(2.0f, devE) * CC1200_OSC_FREQ / 524288.0f;
-    char devMsg[128];
-    snprintf(devMsg, sizeof(devMsg), "Set FSK deviation to %.2f Hz (requested %.2f Hz)\n", actualDeviation, deviation);
-    sendStringToDebugUart(std::string(devMsg));
+    txn.commit();
+
+    if(debugEnabled)
+    {
+        char devMsg[128];
+        snprintf(devMsg, sizeof(devMsg), "Set FSK deviation to %.2f Hz (requested %.2f Hz)\n", setting.actualHz, deviation);
+        sendStringToDebugUart(std::string(devMsg));
+    }
 }
 /*
  * Copyright (c) 2019-2023 USC Rocket Propulsion Lab
@@ -863,45 +3233,27 @@ void CC1200::setFSKDeviation(float deviation)
 
 void CC1200::setSymbolRate(float symbolRateHz)
 {
-    // Calculate the register values for the given symbol rate
-    // See CC1200 user guide section 9.11
-    
-    float normalizedSymbolRate = symbolRateHz / CC1200_OSC_FREQ;
-    
-    // Find the best exponent (0-20)
-    uint8_t srE = 0;
-    float srM = normalizedSymbolRate * twoToThe20;
-    
-    while(srM < 128.0f && srE < 20)
+    CC1200SymbolRateSetting setting = calcCC1200SymbolRate(static_cast<uint32_t>(symbolRateHz + 0.5f));
+    if(!setting.valid)
     {
-        srM *= 2.0f;
-        srE++;
+        return;
     }
-    
-    // Round to nearest integer
-    uint32_t srMInt = static_cast<uint32_t>(srM + 0.5f);
-    
-    // Make sure we don't exceed the maximum value
-    if(srMInt > 255)
+
+    currentSymbolRate = setting.actualHz;
+
+    // Update the SYMBOL_RATE registers in one burst
+    uint8_t const symbolRateRegs[3] = {
+        static_cast<uint8_t>((setting.exponent << SYMBOL_RATE2_SRATE_E) | ((setting.mantissa >> 16) & 0xF)),
+        static_cast<uint8_t>((setting.mantissa >> 8) & 0xFF),
+        static_cast<uint8_t>(setting.mantissa & 0xFF)};
+    writeRegisters(Register::SYMBOL_RATE2, symbolRateRegs, 3);
+
+    if(debugEnabled)
     {
-        srMInt = 255;
+        char srMsg[128];
+        snprintf(srMsg, sizeof(srMsg), "Set symbol rate to %.2f Hz (requested %.2f Hz)\n", setting.actualHz, symbolRateHz);
+        sendStringToDebugUart(std::string(srMsg));
     }
-    
-    // Calculate the actual symbol rate
-    float actualSymbolRate = static_cast<float>(srMInt) * CC1200_OSC_FREQ / (twoToThe20 * std::pow(2.0f, srE));
-    currentSymbolRate = actualSymbolRate;
-    
-    // Update the SYMBOL_RATE registers
-    writeRegister(Register::SYMBOL_RATE0, srMInt & 0xFF);
-    
-    uint8_t symbolRate1 = readRegister(Register::SYMBOL_RATE1);
-    symbolRate1 &= ~(0b1111 << SYMBOL_RATE1_SRATE_E); // Clear SRATE_E bits (bits 0-3)
-    symbolRate1 |= (srE << SYMBOL_RATE1_SRATE_E); // Set new SRATE_E bits
-    writeRegister(Register::SYMBOL_RATE1, symbolRate1);
-    
-    char srMsg[128];
-    snprintf(srMsg, sizeof(srMsg), "Set symbol rate to %.2f Hz (requested %.2f Hz)\n", actualSymbolRate, symbolRateHz);
-    sendStringToDebugUart(std::string(srMsg));
 }
 
 // helper function for power setting
@@ -945,180 +3297,78 @@ void CC1200::setASKPowers(float maxPower, float minPower)
     uint8_t maxPaValue = dBPowerToRegValue(maxPower);
     uint8_t minPaValue = dBPowerToRegValue(minPower);
     
+    ConfigTransaction txn(*this);
+
     // Update the PA_CFG1 register for maximum power
     writeRegister(Register::PA_CFG1, maxPaValue);
     
     // Update the ASK_CFG register for minimum power
     // The ASK_CFG register contains a 6-bit power level field
     writeRegister(Register::ASK_CFG, minPaValue);
+    txn.commit();
     
     char askMsg[128];
     snprintf(askMsg, sizeof(askMsg), "Set ASK powers to %.2f dBm (max) and %.2f dBm (min)\n", maxPower, minPower);
     sendStringToDebugUart(std::string(askMsg));
 }
-
-void CC1200::setRadioFrequency(Band band, float frequencyHz)
-{
-    // Calculate the register values for the given frequency
-    // See CC1200 user guide section 9.10
-    
-    uint32_t fregValue;
-    
-    switch(band)
-    {
-        case Band::BAND_820_960MHz:
-            // For 820-960 MHz band, use the formula: FREQ = f * 2^16 / f_XOSC
-            fregValue = static_cast<uint32_t>((frequencyHz * twoToThe16 / CC1200_OSC_FREQ) + 0.5f);
-            break;
-            
-        case Band::BAND_410_480MHz:
-            // For 410-480 MHz band, use the formula: FREQ = f * 2^17 / f_XOSC
-            fregValue = static_cast<uint32_t>((frequencyHz * twoToThe16 * 2.0f / CC1200_OSC_FREQ) + 0.5f);
-            break;
-            
-        case Band::BAND_136_160MHz:
-            // For 136-160 MHz band, use the formula: FREQ = f * 2^21 / f_XOSC
-            fregValue = static_cast<uint32_t>((frequencyHz * twoToThe21 / CC1200_OSC_FREQ) + 0.5f);
-            break;
-            
-        case Band::BAND_410_480MHz_HIGH_IF:
-            // For 410-480 MHz band with high IF, use the formula: FREQ = f * 2^17 / f_XOSC
-            fregValue = static_cast<uint32_t>((frequencyHz * twoToThe16 * 2.0f / CC1200_OSC_FREQ) + 0.5f);
-            break;
-            
-        default:
-            // Invalid band
-            return;
-    }
-    
-    // Make sure we don't exceed the maximum value
-    if(fregValue > maxValue24Bits)
-    {
-        fregValue = maxValue24Bits;
-    }
-    
-    // Update the FREQ registers
-    writeRegister(ExtRegister::FREQ0, fregValue & 0xFF);
-    writeRegister(ExtRegister::FREQ1, (fregValue >> 8) & 0xFF);
-    writeRegister(ExtRegister::FREQ2, (fregValue >> 16) & 0xFF);
-    
-    // Configure the band-specific settings
-    uint8_t fs_cfg = readRegister(Register::FS_CFG);
-    fs_cfg &= ~(0b11 << FS_CFG_FSD_BANDSELECT); // Clear FSD_BANDSELECT bits (bits 0-1)
-    
-    switch(band)
+
+void CC1200::setRadioFrequency(Band band, float frequencyHz)
+{
+    CC1200FrequencySetting setting = calcCC1200Frequency(band, static_cast<uint32_t>(frequencyHz + 0.5f));
+    if(!setting.valid)
     {
-        case Band::BAND_820_960MHz:
-            fs_cfg |= (0b00 << FS_CFG_FSD_BANDSELECT); // Set FSD_BANDSELECT to 0 for 820-960 MHz
-            break;
-            
-        case Band::BAND_410_480MHz:
-            fs_cfg |= (0b01 << FS_CFG_FSD_BANDSELECT); // Set FSD_BANDSELECT to 1 for 410-480 MHz
-            break;
-            
-        case Band::BAND_136_160MHz:
-            fs_cfg |= (0b10 << FS_CFG_FSD_BANDSELECT); // Set FSD_BANDSELECT to 2 for 136-160 MHz
-            break;
-            
-        case Band::BAND_410_480MHz_HIGH_IF:
-            fs_cfg |= (0b11 << FS_CFG_FSD_BANDSELECT); // Set FSD_BANDSELECT to 3 for 410-480 MHz high IF
-            break;
-            
-        default:
-            break;
+        // Frequency not in the given band
+        return;
     }
-    
+
+    ConfigTransaction txn(*this);
+
+    // Update the FREQ registers
+    uint8_t const freqRegs[3] = {
+        static_cast<uint8_t>((setting.freq >> 16) & 0xFF),
+        static_cast<uint8_t>((setting.freq >> 8) & 0xFF),
+        static_cast<uint8_t>(setting.freq & 0xFF)};
+    writeRegisters(ExtRegister::FREQ2, freqRegs, 3);
+
+    // Configure the LO divider for the band
+    uint8_t fs_cfg = readCachedRegister(Register::FS_CFG);
+    fs_cfg &= ~(0b1111 << FS_CFG_FSD_BANDSELECT); // Clear FSD_BANDSELECT bits (bits 0-3)
+    fs_cfg |= (setting.bandSelect << FS_CFG_FSD_BANDSELECT);
     writeRegister(Register::FS_CFG, fs_cfg);
-    
+    txn.commit();
+
     // Store the current frequency
-    currentFrequency = frequencyHz;
-    
-    // Calculate the actual frequency
-    float actualFrequency;
-    switch(band)
+    currentFrequency = setting.actualHz;
+
+    if(debugEnabled)
     {
-        case Band::BAND_820_960MHz:
-            actualFrequency = static_cast<float>(fregValue) * CC1200_OSC_FREQ / twoToThe16;
-            break;
-            
-        case Band::BAND_410_480MHz:
-            actualFrequency = static_cast<float>(fregValue) * CC1200_OSC_FREQ / (twoToThe16 * 2.0f);
-            break;
-            
-        case Band::BAND_136_160MHz:
-            actualFrequency = static_cast<float>(fregValue) * CC1200_OSC_FREQ / twoToThe21;
-            break;
-            
-        case Band::BAND_410_480MHz_HIGH_IF:
-            actualFrequency = static_cast<float>(fregValue) * CC1200_OSC_FREQ / (twoToThe16 * 2.0f);
-            break;
-            
-        default:
-            actualFrequency = 0.0f;
-            break;
+        char freqMsg[128];
+        snprintf(freqMsg, sizeof(freqMsg), "Set radio frequency to %.2f Hz (requested %.2f Hz)\n", setting.actualHz, frequencyHz);
+        sendStringToDebugUart(std::string(freqMsg));
     }
-    
-    char freqMsg[128];
-    snprintf(freqMsg, sizeof(freqMsg), "Set radio frequency to %.2f Hz (requested %.2f Hz)\n", actualFrequency, frequencyHz);
-    sendStringToDebugUart(std::string(freqMsg));
-}
-
-// helper function for setRXFilterBandwidth:
-// calculate actual receive bandwidth from the given decimations.
-float calcReceiveBandwidth(uint8_t adcDecimation, uint8_t cicDecimation)
-{
-    return CC1200_OSC_FREQ / (8.0f * adcDecimation * cicDecimation);
 }
 
 void CC1200::setRXFilterBandwidth(float bandwidthHz, bool preferHigherCICDec)
 {
-    // Calculate the register values for the given bandwidth
-    // See CC1200 user guide section 9.13
-    
-    // The bandwidth is determined by the formula: BW = f_XOSC / (8 * ADC_DEC * CIC_DEC)
-    // where ADC_DEC is 16, 24, 32, or 40, and CIC_DEC is 1, 2, 4, 8, 16, 32, or 64
-    
-    // Find the best combination of ADC_DEC and CIC_DEC
-    uint8_t bestAdcDec = 0;
-    uint8_t bestCicDec = 0;
-    float bestBandwidth = 0.0f;
-    float bestError = std::numeric_limits<float>::max();
-    
-    // ADC decimation options
-    const uint8_t adcDecOptions[] = {16, 24, 32, 40};
-    const uint8_t adcDecRegValues[] = {0, 1, 2, 3};
-    
-    // CIC decimation options
-    const uint8_t cicDecOptions[] = {1, 2, 4, 8, 16, 32, 64};
-    const uint8_t cicDecRegValues[] = {0, 1, 2, 3, 4, 5, 6};
-    
-    for(int i = 0; i < 4; i++)
+    CC1200RXBandwidthSetting setting = calcCC1200RXBandwidth(static_cast<uint32_t>(bandwidthHz + 0.5f), preferHigherCICDec);
+    if(!setting.valid)
     {
-        for(int j = 0; j < 7; j++)
-        {
-            float bw = calcReceiveBandwidth(adcDecOptions[i], cicDecOptions[j]);
-            float error = std::abs(bw - bandwidthHz);
-            
-            if(error < bestError || (error == bestError && preferHigherCICDec && cicDecOptions[j] > bestCicDec))
-            {
-                bestError = error;
-                bestBandwidth = bw;
-                bestAdcDec = adcDecRegValues[i];
-                bestCicDec = cicDecRegValues[j];
-            }
-        }
+        return;
     }
-    
+
     // Update the CHAN_BW register
-    uint8_t chanBw = (bestAdcDec << CHAN_BW_ADC_CIC_DECFACT) | bestCicDec;
+    uint8_t chanBw = (setting.adcCicDecfact << CHAN_BW_ADC_CIC_DECFACT) | (setting.bbCicDecfact << CHAN_BW_BB_CIC_DECFACT);
     writeRegister(Register::CHAN_BW, chanBw);
-    
+
     // Store the current RX bandwidth
-    currentRXBandwidth = bestBandwidth;
-    
-    char bwMsg[128];
-    snprintf(bwMsg, sizeof(bwMsg), "Set RX filter bandwidth to %.2f Hz (requested %.2f Hz)\n", bestBandwidth, bandwidthHz);
-    sendStringToDebugUart(std::string(bwMsg));
+    currentRXBandwidth = setting.actualHz;
+
+    if(debugEnabled)
+    {
+        char bwMsg[128];
+        snprintf(bwMsg, sizeof(bwMsg), "Set RX filter bandwidth to %.2f Hz (requested %.2f Hz)\n", setting.actualHz, bandwidthHz);
+        sendStringToDebugUart(std::string(bwMsg));
+    }
 }
 
 void CC1200::configureDCFilter(bool enableAutoFilter, uint8_t settlingCfg, uint8_t cutoffCfg)
@@ -1138,6 +3388,8 @@ void CC1200::configureDCFilter(bool enableAutoFilter, uint8_t settlingCfg, uint8
 
 void CC1200::configureSyncWord(uint32_t syncWord, SyncMode mode, uint8_t syncThreshold)
 {
+    ConfigTransaction txn(*this);
+
     // Update the SYNC registers with the sync word
     writeRegister(Register::SYNC3, (syncWord >> 24) & 0xFF);
     writeRegister(Register::SYNC2, (syncWord >> 16) & 0xFF);
@@ -1145,7 +3397,7 @@ void CC1200::configureSyncWord(uint32_t syncWord, SyncMode mode, uint8_t syncThr
     writeRegister(Register::SYNC0, syncWord & 0xFF);
     
     // Configure the sync mode
-    uint8_t syncCfg0 = readRegister(Register::SYNC_CFG0);
+    uint8_t syncCfg0 = readCachedRegister(Register::SYNC_CFG0);
     syncCfg0 &= ~(0b111 << SYNC_CFG0_SYNC_MODE); // Clear SYNC_MODE bits (bits 0-2)
     syncCfg0 |= (static_cast<uint8_t>(mode) << SYNC_CFG0_SYNC_MODE); // Set new SYNC_MODE bits
     writeRegister(Register::SYNC_CFG0, syncCfg0);
@@ -1153,7 +3405,7 @@ void CC1200::configureSyncWord(uint32_t syncWord, SyncMode mode, uint8_t syncThr
     // Set the sync threshold if applicable
     if(syncThreshold > 0)
     {
-        uint8_t syncCfg1 = readRegister(Register::SYNC_CFG1);
+        uint8_t syncCfg1 = readCachedRegister(Register::SYNC_CFG1);
         syncCfg1 &= ~(0b111 << SYNC_CFG1_SYNC_THR); // Clear SYNC_THR bits (bits 0-2)
         syncCfg1 |= ((syncThreshold & 0x7) << SYNC_CFG1_SYNC_THR); // Set new SYNC_THR bits
         writeRegister(Register::SYNC_CFG1, syncCfg1);
@@ -1171,7 +3423,7 @@ bool CC1200::isFSLocked()
 void CC1200::configurePreamble(uint8_t preambleLengthCfg, uint8_t preambleFormatCfg)
 {
     // Configure the preamble length and format
-    uint8_t preambleCfg0 = readRegister(Register::PREAMBLE_CFG0);
+    uint8_t preambleCfg0 = readCachedRegister(Register::PREAMBLE_CFG0);
     preambleCfg0 &= ~(0b111 << PREAMBLE_CFG0_NUM_PREAMBLE); // Clear NUM_PREAMBLE bits (bits 0-2)
     preambleCfg0 |= ((preambleLengthCfg & 0x7) << PREAMBLE_CFG0_NUM_PREAMBLE); // Set new NUM_PREAMBLE bits
     
@@ -1231,7 +3483,7 @@ void CC1200::setAGCReferenceLevel(uint8_t level)
 void CC1200::setAGCSyncBehavior(SyncBehavior behavior)
 {
     // Configure the AGC sync behavior
-    uint8_t agcCfg1 = readRegister(Register::AGC_CFG1);
+    uint8_t agcCfg1 = readCachedRegister(Register::AGC_CFG1);
     agcCfg1 &= ~(0b11 << AGC_CFG1_SYNC_BEHAVIOR); // Clear SYNC_BEHAVIOR bits (bits 0-1)
     agcCfg1 |= (static_cast<uint8_t>(behavior) << AGC_CFG1_SYNC_BEHAVIOR); // Set new SYNC_BEHAVIOR bits
     writeRegister(Register::AGC_CFG1, agcCfg1);
@@ -1240,7 +3492,7 @@ void CC1200::setAGCSyncBehavior(SyncBehavior behavior)
 void CC1200::setAGCGainTable(GainTable table, uint8_t minGainIndex, uint8_t maxGainIndex)
 {
     // Configure the AGC gain table
-    uint8_t agcCfg0 = readRegister(Register::AGC_CFG0);
+    uint8_t agcCfg0 = readCachedRegister(Register::AGC_CFG0);
     
     // Set the AGC_GAIN_TABLE bit (bit 6)
     if(table == GainTable::HIGH_LINEARITY)
@@ -1266,7 +3518,7 @@ void CC1200::setAGCGainTable(GainTable table, uint8_t minGainIndex, uint8_t maxG
 void CC1200::setAGCHysteresis(uint8_t hysteresisCfg)
 {
     // Configure the AGC hysteresis
-    uint8_t agcCfg1 = readRegister(Register::AGC_CFG1);
+    uint8_t agcCfg1 = readCachedRegister(Register::AGC_CFG1);
     agcCfg1 &= ~(0b11 << AGC_CFG1_AGC_HYST_LEVEL); // Clear AGC_HYST_LEVEL bits (bits 6-7)
     agcCfg1 |= ((hysteresisCfg & 0x3) << AGC_CFG1_AGC_HYST_LEVEL); // Set new AGC_HYST_LEVEL bits
     writeRegister(Register::AGC_CFG1, agcCfg1);
@@ -1275,7 +3527,7 @@ void CC1200::setAGCHysteresis(uint8_t hysteresisCfg)
 void CC1200::setAGCSlewRate(uint8_t slewrateCfg)
 {
     // Configure the AGC slew rate
-    uint8_t agcCfg2 = readRegister(Register::AGC_CFG2);
+    uint8_t agcCfg2 = readCachedRegister(Register::AGC_CFG2);
     agcCfg2 &= ~(0b11 << AGC_CFG2_AGC_SLEWRATE_LIMIT); // Clear AGC_SLEWRATE_LIMIT bits (bits 3-4)
     agcCfg2 |= ((slewrateCfg & 0x3) << AGC_CFG2_AGC_SLEWRATE_LIMIT); // Set new AGC_SLEWRATE_LIMIT bits
     writeRegister(Register::AGC_CFG2, agcCfg2);
@@ -1284,7 +3536,7 @@ void CC1200::setAGCSlewRate(uint8_t slewrateCfg)
 void CC1200::setAGCSettleWait(uint8_t settleWaitCfg)
 {
     // Configure the AGC settle wait time
-    uint8_t agcCfg2 = readRegister(Register::AGC_CFG2);
+    uint8_t agcCfg2 = readCachedRegister(Register::AGC_CFG2);
     agcCfg2 &= ~(0b111 << AGC_CFG2_AGC_SETTLE_WAIT); // Clear AGC_SETTLE_WAIT bits (bits 0-2)
     agcCfg2 |= ((settleWaitCfg & 0x7) << AGC_CFG2_AGC_SETTLE_WAIT); // Set new AGC_SETTLE_WAIT bits
     writeRegister(Register::AGC_CFG2, agcCfg2);
@@ -1292,16 +3544,21 @@ void CC1200::setAGCSettleWait(uint8_t settleWaitCfg)
 
 float CC1200::getRSSIRegister()
 {
-    // Read the RSSI registers
-    uint8_t rssi0 = readRegister(ExtRegister::RSSI0);
-    uint8_t rssi1 = readRegister(ExtRegister::RSSI1);
-    
-    // Combine the two bytes
-    int16_t rssiValue = (static_cast<int16_t>(rssi1) << 8) | rssi0;
+    // RSSI1 and RSSI0 are adjacent, so one burst reads both from the same measurement
+    uint8_t rssi[2];
+    readRegisters(ExtRegister::RSSI1, rssi, sizeof(rssi));
+
+    if(!(rssi[1] & (1 << RSSI0_RSSI_VALID)))
+    {
+        return RSSI_INVALID;
+    }
+
+    // RSSI is a 12 bit two's complement value in 1/16 dB steps: the signed integer dBm
+    // part in RSSI1 and the fraction in RSSI0 bits 3-6
+    int16_t rssiValue = static_cast<int16_t>(static_cast<int8_t>(rssi[0]) * 16 + ((rssi[1] >> RSSI0_RSSI_3_0) & 0xF));
     
     // Convert to dBm
-    // The RSSI value is in 0.5 dBm steps
-    float rssiDbm = rssiValue / 2.0f;
+    float rssiDbm = rssiValue / 16.0f;
     
     return rssiDbm;
 }
@@ -1309,7 +3566,7 @@ float CC1200::getRSSIRegister()
 void CC1200::setRSSIOffset(int8_t adjust)
 {
     // Set the RSSI offset
-    uint8_t agcCfg3 = readRegister(Register::AGC_CFG3);
+    uint8_t agcCfg3 = readCachedRegister(Register::AGC_CFG3);
     agcCfg3 &= ~(0xFF << AGC_CFG3_RSSI_ADJUST); // Clear RSSI_ADJUST bits (bits 0-7)
     agcCfg3 |= (adjust & 0xFF); // Set new RSSI_ADJUST bits
     writeRegister(Register::AGC_CFG3, agcCfg3);
@@ -1323,8 +3580,10 @@ uint8_t CC1200::getLQIRegister()
 
 void CC1200::setIFCfg(IFCfg value, bool enableIQIC)
 {
+    ConfigTransaction txn(*this);
+
     // Configure the IF settings
-    uint8_t ifMixCfg = readRegister(ExtRegister::IF_MIX_CFG);
+    uint8_t ifMixCfg = readCachedRegister(ExtRegister::IF_MIX_CFG);
     ifMixCfg &= ~(0b11 << 0); // Clear IF_MODE bits (bits 0-1)
     ifMixCfg |= static_cast<uint8_t>(value); // Set new IF_MODE bits
     writeRegister(ExtRegister::IF_MIX_CFG, ifMixCfg);
@@ -1332,13 +3591,13 @@ void CC1200::setIFCfg(IFCfg value, bool enableIQIC)
     // Configure IQIC if requested
     if(enableIQIC)
     {
-        uint8_t iqic = readRegister(Register::IQIC);
+        uint8_t iqic = readCachedRegister(Register::IQIC);
         iqic |= (1 << IQIC_IQIC_EN); // Set IQIC_EN bit
         writeRegister(Register::IQIC, iqic);
     }
     else
     {
-        uint8_t iqic = readRegister(Register::IQIC);
+        uint8_t iqic = readCachedRegister(Register::IQIC);
         iqic &= ~(1 << IQIC_IQIC_EN); // Clear IQIC_EN bit
         writeRegister(Register::IQIC, iqic);
     }
@@ -1348,265 +3607,299 @@ void CC1200::setIFCfg(IFCfg value, bool enableIQIC)
 // DMA Implementation Functions
 // ============================================================================
 
-bool CC1200::spiTransferDMA(uint8_t* txData, uint8_t* rxData, size_t len)
+// A DMA transfer is either one part of a transaction opened by spiBegin(), which the
+// task waits for, or a queued descriptor.  Don't send debug output from here.
+void CC1200::dmaTransferCompleteCallback()
 {
-    if (len == 0 || len > 256) {
-        return false;
-    }
-    
-    // Reset DMA flags
-    dmaTransferComplete = false;
-    dmaTransferError = false;
-    
-    // Start DMA transfer
-    select();
-    HAL_StatusTypeDef result = HAL_SPI_TransmitReceive_DMA(hspi, txData, rxData, len);
-    
-    if (result != HAL_OK) {
-        deselect();
-        return false;
-    }
-    
-    // Wait for completion with timeout (10ms per byte) using FreeRTOS delays
-    uint32_t timeout = HAL_GetTick() + (len * 10);
-    while (!dmaTransferComplete && !dmaTransferError && HAL_GetTick() < timeout) {
-        // Use FreeRTOS delay to yield to other tasks
-        osDelay(1); // 1ms delay to allow other tasks to run
-    }
-    
-    // CS will be deselected by callback, but handle timeout case
-    if (!dmaTransferComplete && !dmaTransferError) {
-        deselect(); // Only deselect if callback didn't fire (timeout case)
-    }
-    
-    if (dmaTransferError) {
-        if (debugEnabled) {
-            sendStringToDebugUart("DMA: Transfer error!\n");
-        }
-        return false;
+    if (dmaChained) {
+        dmaTransferComplete = true; // the transaction goes on; spiBytesBackground() is waiting for this
+        bus.wakeWaiter();
+        return;
     }
-    
-    if (!dmaTransferComplete) {
-        if (debugEnabled) {
-            sendStringToDebugUart("DMA: Transfer timeout!\n");
-        }
-        return false;
+    if (spiQueueRunning) {
+        finishSPIDescriptor(true);
+        runSPIQueue();
     }
-    
-    return true;
-}
-
-void CC1200::dmaTransferCompleteCallback()
-{
-    dmaTransferComplete = true;
-    dmaTransferInProgress = false;
-    deselect(); // Deselect CS when transfer completes
-    // Don't send debug output from ISR context - can cause crashes
 }
 
 void CC1200::dmaTransferErrorCallback()
 {
-    dmaTransferError = true;
-    dmaTransferInProgress = false;
-    deselect(); // Deselect CS on error
-    // Don't send debug output from ISR context - can cause crashes
+    if (dmaChained) {
+        dmaTransferError = true;
+        bus.wakeWaiter();
+        return;
+    }
+    if (spiQueueRunning) {
+        finishSPIDescriptor(false);
+        runSPIQueue();
+    }
 }
 
-bool CC1200::spiTransferDMANonBlocking(uint8_t* txData, uint8_t* rxData, size_t len)
+bool CC1200::submitSPI(SPIDescriptor const& descriptor)
 {
-    if (len == 0 || len > 256) {
+    if (descriptor.headerLen < 1 || descriptor.headerLen > 2 || descriptor.len == 0) {
         return false;
     }
-    
-    // Check if a transfer is already in progress
-    if (dmaTransferInProgress) {
-        return false; // Can't start new transfer while one is active
-    }
-    
-    // Reset DMA flags
-    dmaTransferComplete = false;
-    dmaTransferError = false;
-    dmaTransferInProgress = true;
-    
-    // Start DMA transfer
-    select();
-    HAL_StatusTypeDef result = HAL_SPI_TransmitReceive_DMA(hspi, txData, rxData, len);
-    
-    if (result != HAL_OK) {
-        dmaTransferInProgress = false;
-        deselect();
-        if (debugEnabled) {
-            sendStringToDebugUart("DMA: Failed to start transfer\n");
-        }
+
+    std::atomic_signal_fence(std::memory_order_acquire);
+    if (spiQueueHead - spiQueueTail >= CC1200_SPI_QUEUE_LEN) {
         return false;
     }
-    
-    // Transfer started successfully, callback will handle completion
+    spiQueue[spiQueueHead & (CC1200_SPI_QUEUE_LEN - 1)] = descriptor;
+    std::atomic_signal_fence(std::memory_order_release);
+    ++spiQueueHead;
+
+    // start the queue unless the completion interrupt is already running it
+    if (!spiQueueRunning.exchange(true)) {
+        runSPIQueue();
+    }
     return true;
 }
 
-bool CC1200::isDMATransferComplete()
+bool CC1200::waitSPIQueueIdle(uint32_t timeoutUs)
 {
-    return !dmaTransferInProgress;
+    // runSPIQueue() wakes the task when the queue empties
+    bus.prepareWait();
+    return bus.waitUntil([this]() { return !spiQueueRunning; }, timeoutUs);
 }
 
-bool CC1200::enqueuePacketDMA(char const* data, size_t len)
+void CC1200::runSPIQueue()
 {
-    uint8_t totalLength = len + 1; // add one byte for length byte
+    for (;;) {
+        std::atomic_signal_fence(std::memory_order_acquire);
+        if (spiQueueTail == spiQueueHead) {
+            spiQueueRunning = false;
+            // a descriptor submitted between the check and the store would be stranded
+            std::atomic_signal_fence(std::memory_order_acquire);
+            if (spiQueueTail == spiQueueHead) {
+                releaseSPI();
+                bus.wakeWaiter();
+                return;
+            }
+            if (spiQueueRunning.exchange(true)) {
+                return; // submitSPI() got there first and runs the queue
+            }
+            continue;
+        }
 
-    if(totalLength > MAX_PACKET_LENGTH || len > 254) {
-        return false;
+        if (startSPIDescriptor(spiQueue[spiQueueTail & (CC1200_SPI_QUEUE_LEN - 1)])) {
+            return; // the completion interrupt goes on from here
+        }
     }
+}
 
-    // Wait for chip to be ready
-    uint32_t timeout = HAL_GetTick() + 100;
-    while(!chipReady && HAL_GetTick() < timeout) {
-        updateState();
+bool CC1200::startSPIDescriptor(SPIDescriptor& descriptor)
+{
+    spiBusy = true;
+    if (spiTraceEnabled) {
+        spiTxnStart = bus.getTimestamp();
     }
 
-    if(!chipReady) {
-        return false;
+    // reads through the address extension or memory access commands need the slow clock
+    uint8_t const command = descriptor.header[0] & ~(CC1200_READ | CC1200_BURST);
+    bool const extendedRead = (descriptor.header[0] & CC1200_READ) && (command == CC1200_EXT_ADDR || command == CC1200_MEM_ACCESS);
+    bus.select(extendedRead ? CC1200Bus::ClockClass::EXTENDED_READ : CC1200Bus::ClockClass::FAST);
+
+    // the header goes out polled, so its status byte is captured for this descriptor
+    uint8_t status[2] = {};
+    bool ok = bus.transfer(descriptor.header, status, descriptor.headerLen);
+    descriptor.status = status[0];
+    if (ok) {
+        ok = bus.startTransfer(descriptor.txData, descriptor.rxData, descriptor.len);
     }
-
-    // Prepare DMA buffer
-    dmaTxBuffer[0] = CC1200_ENQUEUE_TX_FIFO | CC1200_BURST;
-    dmaTxBuffer[1] = len; // Variable length mode
-    memcpy(&dmaTxBuffer[2], data, len);
-    
-    // Perform DMA transfer
-    bool success = spiTransferDMA(dmaTxBuffer, dmaRxBuffer, totalLength + 1);
-    
-    if (success && debugEnabled) {
-        char msg[64];
-        snprintf(msg, sizeof(msg), "DMA: Enqueued %u bytes\n", (unsigned int)len);
-        sendStringToDebugUart(std::string(msg));
+    if (!ok) {
+        // nothing is in flight, so finish it here; runSPIQueue() moves on
+        finishSPIDescriptor(false);
     }
-    
-    return success;
+    return ok;
 }
 
-size_t CC1200::receivePacketDMA(char* buffer, size_t bufferLen)
+// Runs in the DMA completion interrupt, or from runSPIQueue() for a descriptor that failed
+// to start.  With a bus that completes transfers inline, the completion callback runs the
+// rest of the queue from inside startSPIDescriptor(), nesting once per descriptor.
+void CC1200::finishSPIDescriptor(bool ok)
 {
-    // Check if packet is available
-    if (!hasReceivedPacket()) {
-        return 0;
-    }
-
-    // Get the number of bytes in the RX FIFO
-    size_t fifoLen = getRXFIFOLen();
-    if (fifoLen == 0) {
-        return 0;
+    SPIDescriptor const& descriptor = spiQueue[spiQueueTail & (CC1200_SPI_QUEUE_LEN - 1)];
+    bus.deselect();
+    if (ok) {
+        loadStatusByte(descriptor.status);
     }
-
-    // Read packet length
-    dmaTxBuffer[0] = CC1200_DEQUEUE_RX_FIFO | CC1200_BURST;
-    dmaTxBuffer[1] = 0; // Dummy byte to read length
-    
-    if (!spiTransferDMA(dmaTxBuffer, dmaRxBuffer, 2)) {
-        return 0;
+    if (spiTraceEnabled) {
+        recordSPITrace(descriptor.header[0], descriptor.headerLen > 1 ? descriptor.header[1] : 0, descriptor.len,
+                       SPI_TRACE_DMA | (ok ? 0 : SPI_TRACE_FAILED));
     }
-    
-    uint8_t packetLen = dmaRxBuffer[1];
-    
-    if (packetLen == 0 || packetLen > bufferLen) {
-        return 0;
+    if (descriptor.onComplete != nullptr) {
+        descriptor.onComplete(descriptor, ok, descriptor.context);
     }
+    std::atomic_signal_fence(std::memory_order_release);
+    ++spiQueueTail;
+}
 
-    // Read packet data
-    dmaTxBuffer[0] = CC1200_DEQUEUE_RX_FIFO | CC1200_BURST;
-    memset(&dmaTxBuffer[1], 0, packetLen); // Dummy bytes
-    
-    if (!spiTransferDMA(dmaTxBuffer, dmaRxBuffer, packetLen + 1)) {
-        return 0;
+// Called from task context when the queue has stopped making progress: the completion
+// of the transfer in flight never came.  Once it is aborted the completion interrupt can't
+// run the queue any more, so the descriptors left are finished here as failed.
+void CC1200::resetSPIQueue()
+{
+    bus.abortTransfer();
+    std::atomic_signal_fence(std::memory_order_acquire);
+    while (spiQueueTail != spiQueueHead) {
+        finishSPIDescriptor(false);
     }
-    
-    // Copy received data to buffer
-    memcpy(buffer, &dmaRxBuffer[1], packetLen);
-    
-    if (debugEnabled) {
-        char msg[64];
-        snprintf(msg, sizeof(msg), "DMA: Received %u bytes\n", (unsigned int)packetLen);
-        sendStringToDebugUart(std::string(msg));
+    spiQueueRunning = false;
+}
+
+void CC1200::spiWriteBytes(uint8_t const* data, size_t len, TransferMethod method)
+{
+    // transmit only; the bytes clocked back are not stored
+    if (method == TransferMethod::POLLED) {
+        spiWriteBytes(data, len);
+    } else {
+        spiBytesBackground(data, nullptr, len, method);
     }
-    
-    return packetLen;
 }
 
-size_t CC1200::writeStreamDMA(const char* buffer, size_t count)
+void CC1200::spiReadBytes(uint8_t* data, size_t len, TransferMethod method)
 {
-    if (count == 0) {
-        return 0;
+    // receive only; DMA clocks out a constant dummy byte, the interrupt whatever the
+    // buffer held, and the chip ignores both during a burst read
+    if (method == TransferMethod::POLLED) {
+        spiReadBytes(data, len);
+    } else {
+        spiBytesBackground(nullptr, data, len, method);
     }
+}
 
-    // Get available space in TX FIFO
-    size_t txFifoLen = getTXFIFOLen();
-    size_t availableSpace = CC1200_FIFO_SIZE - txFifoLen;
-    
-    // Limit write to available space
-    size_t bytesToWrite = (count > availableSpace) ? availableSpace : count;
-    if (bytesToWrite > 254) { // Leave room for command byte
-        bytesToWrite = 254;
+// The interrupt driven transfer completes through the same callbacks as DMA, so both wait
+// on the DMA completion flags
+void CC1200::spiBytesBackground(uint8_t const* txData, uint8_t* rxData, size_t len, TransferMethod method)
+{
+    if (!spiTxnOk || len == 0) {
+        return;
     }
 
-    if (bytesToWrite == 0) {
-        return 0;
+    bool const dma = method == TransferMethod::DMA;
+    spiTxnLen += len;
+    spiDataBytes += len;
+    spiTxnDMA = spiTxnDMA || dma;
+    dmaTransferComplete = false;
+    dmaTransferError = false;
+    dmaChained = true;
+    bus.prepareWait();
+    if (!(dma ? bus.startTransfer(txData, rxData, len) : bus.startTransferIT(txData, rxData, len))) {
+        dmaChained = false;
+        spiTxnOk = false;
+        return;
     }
 
-    // Prepare DMA buffer
-    dmaTxBuffer[0] = CC1200_ENQUEUE_TX_FIFO | CC1200_BURST;
-    memcpy(&dmaTxBuffer[1], buffer, bytesToWrite);
-    
-    // Perform DMA transfer
-    bool success = spiTransferDMA(dmaTxBuffer, dmaRxBuffer, bytesToWrite + 1);
-    
-    if (success && debugEnabled) {
-        char msg[64];
-        snprintf(msg, sizeof(msg), "DMA: Wrote %u bytes to stream\n", (unsigned int)bytesToWrite);
-        sendStringToDebugUart(std::string(msg));
+    // The completion interrupt wakes the task, so a short transfer doesn't cost a whole
+    // tick.  Allow twice the time on the bus plus a millisecond, which also covers the
+    // interrupt driven transfer's time between bytes.
+    uint64_t const timeoutUs = 1000 + 16ULL * len * 1000000 / bus.getClockFrequency(CC1200Bus::ClockClass::FAST);
+    if (!bus.waitUntil([this]() { return dmaTransferComplete || dmaTransferError; }, static_cast<uint32_t>(timeoutUs))) {
+        // the completion was lost; stop the transfer so the peripheral is usable again
+        bus.abortTransfer();
     }
-    
-    return success ? bytesToWrite : 0;
+
+    spiTxnOk = dmaTransferComplete;
+    dmaChained = false;
 }
 
-size_t CC1200::readStreamDMA(char* buffer, size_t maxLen)
+CC1200::TransferMethod CC1200::fifoTransferMethod(size_t len) const
 {
-    if (maxLen == 0) {
-        return 0;
+    if (len >= dmaMinLen) {
+        return TransferMethod::DMA;
     }
+    if (len >= itMinLen) {
+        return TransferMethod::INTERRUPT;
+    }
+    return TransferMethod::POLLED;
+}
 
-    // Get number of bytes in RX FIFO
-    size_t rxFifoLen = getRXFIFOLen();
-    if (rxFifoLen == 0) {
-        return 0;
+bool CC1200::writeTxFifoSegments(uint8_t const* header, size_t headerLen, TxSegment const* segments, size_t count)
+{
+    spiBegin(header, headerLen);
+    for (size_t i = 0; i < count; ++i) {
+        spiWriteBytes(segments[i].data, segments[i].len, fifoTransferMethod(segments[i].len));
     }
+    return spiEnd();
+}
 
-    // Limit read to available data and buffer size
-    size_t bytesToRead = (rxFifoLen > maxLen) ? maxLen : rxFifoLen;
-    if (bytesToRead > 254) { // Leave room for command byte
-        bytesToRead = 254;
+bool CC1200::readRXFIFO(uint8_t* data, size_t len)
+{
+    uint8_t const header = CC1200_DEQUEUE_RX_FIFO | CC1200_BURST;
+    return spiBurstRead(&header, 1, data, len, fifoTransferMethod(len));
+}
+
+uint32_t CC1200::timeFifoMemoryRead(uint8_t* buffer, size_t len, TransferMethod method)
+{
+    // Direct access to the TX FIFO memory reads the same bytes however often, and moves
+    // no FIFO pointers.  It runs on the FAST clock the FIFO bursts use rather than the
+    // extended read clock, so the times hold for them; the bytes are only timed, so
+    // reading above the chip's extended read limit doesn't matter.
+    uint8_t const header[2] = {CC1200_MEM_ACCESS | CC1200_READ | CC1200_BURST, CC1200_TX_FIFO};
+    uint32_t best = UINT32_MAX;
+    for (size_t attempt = 0; attempt < TRANSFER_CALIBRATION_ATTEMPTS; ++attempt) {
+        uint32_t const start = bus.getTimestamp();
+        spiBegin(header, 2, CC1200Bus::ClockClass::FAST);
+        spiReadBytes(buffer, len, method);
+        bool const ok = spiEnd();
+        uint32_t const elapsed = bus.getTimestamp() - start;
+        if (!ok) {
+            return 0;
+        }
+        best = std::min(best, elapsed);
     }
+    return best;
+}
 
-    // Prepare DMA buffer
-    dmaTxBuffer[0] = CC1200_DEQUEUE_RX_FIFO | CC1200_BURST;
-    memset(&dmaTxBuffer[1], 0, bytesToRead); // Dummy bytes
-    
-    // Perform DMA transfer
-    bool success = spiTransferDMA(dmaTxBuffer, dmaRxBuffer, bytesToRead + 1);
-    
-    if (success) {
-        // Copy received data to buffer
-        memcpy(buffer, &dmaRxBuffer[1], bytesToRead);
-        
-        if (debugEnabled) {
-            char msg[64];
-            snprintf(msg, sizeof(msg), "DMA: Read %u bytes from stream\n", (unsigned int)bytesToRead);
-            sendStringToDebugUart(std::string(msg));
+bool CC1200::calibrateTransfers()
+{
+    static uint16_t const lengths[NUM_TRANSFER_CALIBRATION_POINTS] = {8, 16, 32, 64, 128};
+    uint8_t buffer[128] __attribute__((aligned(4)));
+
+    // keep trace recording out of the measurement
+    bool const traceWasEnabled = spiTraceEnabled;
+    spiTraceEnabled = false;
+
+    TransferCalibration result = {};
+    result.valid = true;
+    result.itMinLen = SIZE_MAX;
+    result.dmaMinLen = SIZE_MAX;
+    uint64_t const ticksPerSecond = bus.getTimestampFrequency();
+    for (size_t i = 0; i < NUM_TRANSFER_CALIBRATION_POINTS; ++i) {
+        uint32_t const polledTicks = timeFifoMemoryRead(buffer, lengths[i], TransferMethod::POLLED);
+        uint32_t const itTicks = timeFifoMemoryRead(buffer, lengths[i], TransferMethod::INTERRUPT);
+        uint32_t const dmaTicks = timeFifoMemoryRead(buffer, lengths[i], TransferMethod::DMA);
+        if (polledTicks == 0 || itTicks == 0 || dmaTicks == 0) {
+            result.valid = false;
+            break;
+        }
+        result.length[i] = lengths[i];
+        result.polledNs[i] = static_cast<uint32_t>(polledTicks * 1000000000ULL / ticksPerSecond);
+        result.itNs[i] = static_cast<uint32_t>(itTicks * 1000000000ULL / ticksPerSecond);
+        result.dmaNs[i] = static_cast<uint32_t>(dmaTicks * 1000000000ULL / ticksPerSecond);
+
+        // each crossover is where a method becomes faster and stays faster: the interrupt
+        // against polling, and DMA against both
+        if (itTicks >= polledTicks) {
+            result.itMinLen = SIZE_MAX;
+        } else if (result.itMinLen == SIZE_MAX) {
+            result.itMinLen = lengths[i];
+        }
+        if (dmaTicks >= std::min(polledTicks, itTicks)) {
+            result.dmaMinLen = SIZE_MAX;
+        } else if (result.dmaMinLen == SIZE_MAX) {
+            result.dmaMinLen = lengths[i];
         }
-        
-        return bytesToRead;
     }
-    
-    return 0;
+
+    spiTraceEnabled = traceWasEnabled;
+    transferCalibration = result;
+    if (result.valid) {
+        itMinLen = result.itMinLen;
+        dmaMinLen = result.dmaMinLen;
+    }
+    return result.valid;
 }
 
 // ============================================================================
@@ -1632,6 +3925,11 @@ bool CC1200::startContinuousStreamingTx(const char* pattern, size_t patternLen)
     // Reset statistics
     streamingTxCount = 0;
     streamingTxErrors = 0;
+    streamingTxHead = streamingTxDone = 0;
+    streamingTxRingHead = streamingTxRingTail = 0;
+    streamingTxFifoLevel = CC1200_FIFO_SIZE; // nothing is staged until it has been read
+    streamingTxBytes = 0;
+    streamingTxStartMs = bus.getMillis();
     
     // Start continuous streaming
     continuousStreamingTx = true;
@@ -1665,6 +3963,11 @@ bool CC1200::startContinuousStreamingRx(bool verbose)
     // Reset statistics
     streamingRxCount = 0;
     streamingRxErrors = 0;
+    streamingRxHead = streamingRxDone = streamingRxTail = 0;
+    streamingRxFifoLevel = 0;
+    streamingRxBytes = 0;
+    streamingRxDroppedBytes = 0;
+    streamingRxStartMs = bus.getMillis();
     
     // Set verbose mode
     verboseRxOutput = verbose;
@@ -1684,25 +3987,37 @@ bool CC1200::startContinuousStreamingRx(bool verbose)
 
 void CC1200::stopContinuousStreamingTx()
 {
+    if (continuousStreamingTx) {
+        streamingTxStopMs = bus.getMillis();
+    }
     continuousStreamingTx = false;
+
+    // queued writes read the staging buffers until they finish
+    waitSPIQueueIdle(SPI_QUEUE_WAIT_US);
     
     if (debugEnabled) {
         char msg[128];
         snprintf(msg, sizeof(msg), "Stopped continuous TX streaming (sent: %lu, errors: %lu)\n", 
-                streamingTxCount, streamingTxErrors);
+                (unsigned long)streamingTxCount, (unsigned long)streamingTxErrors);
         sendStringToDebugUart(std::string(msg));
     }
 }
 
 void CC1200::stopContinuousStreamingRx()
 {
+    if (continuousStreamingRx) {
+        streamingRxStopMs = bus.getMillis();
+    }
     continuousStreamingRx = false;
     verboseRxOutput = false;
+
+    // let queued reads land before the buffers are reused
+    waitSPIQueueIdle(SPI_QUEUE_WAIT_US);
     
     if (debugEnabled) {
         char msg[128];
         snprintf(msg, sizeof(msg), "Stopped continuous RX streaming (received: %lu, errors: %lu)\n", 
-                streamingRxCount, streamingRxErrors);
+                (unsigned long)streamingRxCount, (unsigned long)streamingRxErrors);
         sendStringToDebugUart(std::string(msg));
     }
 }
@@ -1718,6 +4033,12 @@ void CC1200::getContinuousStreamingStats(uint32_t& txCount, uint32_t& rxCount,
 
 void CC1200::processContinuousStreaming()
 {
+    // framed streams and the TX queue are interrupt driven; this picks up what the
+    // interrupts left
+    pollFramedStream();
+    pollTxQueue();
+    recoverFifoError();
+
     // Simplified debug output to prevent crashes
     static uint32_t debugCounter = 0;
     debugCounter++;
@@ -1727,79 +4048,236 @@ void CC1200::processContinuousStreaming()
         }
     }
     
-    // Process continuous TX streaming
-    if (continuousStreamingTx && streamingTxPatternLen > 0) {
-        // Only proceed if no DMA transfer is in progress
-        if (isDMATransferComplete()) {
-            // Check if we can write more data
-            size_t txFifoLen = getTXFIFOLen();
-            size_t availableSpace = CC1200_FIFO_SIZE - txFifoLen;
-            
-            // Only write if we have significant space available
-            if (availableSpace >= streamingTxPatternLen + 10) {
-                // Prepare DMA buffer for non-blocking transfer
-                dmaTxBuffer[0] = CC1200_ENQUEUE_TX_FIFO | CC1200_BURST;
-                memcpy(&dmaTxBuffer[1], streamingTxPattern, streamingTxPatternLen);
-                
-                // Start non-blocking DMA transfer
-                bool success = spiTransferDMANonBlocking(dmaTxBuffer, dmaRxBuffer, streamingTxPatternLen + 1);
-                
-                if (success) {
-                    streamingTxCount++;
-                    
-                    // Simplified debug output 
-                    if (debugEnabled && (streamingTxCount % 100) == 0) {
-                        sendStringToDebugUart("TX 100 packets\n");
-                    }
-                } else {
-                    streamingTxErrors++;
-                }
-            }
+    bool const tx = continuousStreamingTx && streamingTxPatternLen > 0;
+    bool const rx = continuousStreamingRx;
+
+    // Both levels are read before anything is queued, and only while the queue is idle,
+    // so this never waits for the transfers the last call queued.  While those are still
+    // on the wire, the next buffers are staged against the bounds instead.
+    if (isSPIQueueIdle()) {
+        if (tx) {
+            streamingTxFifoLevel = getTXFIFOLen();
+        }
+        if (rx) {
+            streamingRxFifoLevel = getRXFIFOLen();
         }
-        // If DMA transfer is in progress, just skip this iteration
     }
-    
-    // Process continuous RX streaming  
-    if (continuousStreamingRx) {
-        // Only proceed if no DMA transfer is in progress
-        if (isDMATransferComplete()) {
-            // Check if we have data available
-            size_t rxFifoLen = getRXFIFOLen();
-            
-            if (rxFifoLen > 0) {
-                // Limit read to available data
-                size_t bytesToRead = (rxFifoLen > 64) ? 64 : rxFifoLen; // Read max 64 bytes at a time
-                
-                // Prepare DMA buffer for non-blocking transfer
-                dmaTxBuffer[0] = CC1200_DEQUEUE_RX_FIFO | CC1200_BURST;
-                memset(&dmaTxBuffer[1], 0, bytesToRead); // Dummy bytes
-                
-                // Start non-blocking DMA transfer
-                bool success = spiTransferDMANonBlocking(dmaTxBuffer, dmaRxBuffer, bytesToRead + 1);
-                
-                if (success) {
-                    streamingRxCount++;
-                    
-                    // Note: We can't process received data immediately since transfer is non-blocking
-                    // The data will be available after DMA completion, but for continuous streaming
-                    // we prioritize not blocking the task over immediate data processing
-                    
-                    // Periodic debug output (every 50 packets)
-                    if (debugEnabled && (streamingRxCount % 50) == 0) {
-                        char msg[128];
-                        snprintf(msg, sizeof(msg), "Continuous RX: %lu transfers started (DMA non-blocking)\n", streamingRxCount);
-                        sendStringToDebugUart(std::string(msg));
-                    }
-                } else {
-                    streamingRxErrors++;
-                    if (debugEnabled && (streamingRxErrors % 10) == 0) {
-                        char msg[128];
-                        snprintf(msg, sizeof(msg), "Continuous RX: Error starting DMA transfer (errors: %lu)\n", streamingRxErrors);
-                        sendStringToDebugUart(std::string(msg));
-                    }
-                }
+
+    if (tx) {
+        stageStreamingTx();
+    }
+    if (rx) {
+        drainStreamingRx();
+    }
+}
+
+// Fills free TX staging buffers, from the ring or with the pattern, and queues them.  The
+// queue sends each one while the next is being filled.
+void CC1200::stageStreamingTx()
+{
+    size_t availableSpace = CC1200_FIFO_SIZE - std::min<size_t>(streamingTxFifoLevel, CC1200_FIFO_SIZE);
+
+    std::atomic_signal_fence(std::memory_order_acquire);
+    while (streamingTxHead - streamingTxDone < streamingDMABuffers && availableSpace > STREAMING_TX_MARGIN) {
+        StreamingBuffer& buffer = streamingTxBuffers[streamingTxHead & (CC1200_STREAMING_DMA_BUFFERS - 1)];
+
+        // queued data first, as much as fits
+        size_t len = std::min<size_t>(streamingTxRingHead - streamingTxRingTail,
+                                      std::min(sizeof(buffer.data), availableSpace - STREAMING_TX_MARGIN));
+        ringRead(streamingTxRing, CC1200_STREAM_RING_LEN, streamingTxRingTail, buffer.data, len);
+        if (len == 0) {
+            if (availableSpace < streamingTxPatternLen + STREAMING_TX_MARGIN) {
+                break;
             }
+            memcpy(buffer.data, streamingTxPattern, streamingTxPatternLen);
+            len = streamingTxPatternLen;
+        }
+        buffer.len = len;
+
+        SPIDescriptor write = {};
+        write.header[0] = CC1200_ENQUEUE_TX_FIFO | CC1200_BURST;
+        write.headerLen = 1;
+        write.txData = buffer.data;
+        write.len = len;
+        write.onComplete = onStreamingTxBufferDone;
+        write.context = this;
+
+        // counted before it is submitted, in case it completes inside submitSPI()
+        ++streamingTxHead;
+        if (!submitSPI(write)) {
+            --streamingTxHead;
+            break;
+        }
+        std::atomic_signal_fence(std::memory_order_release);
+        streamingTxRingTail += std::min<size_t>(len, streamingTxRingHead - streamingTxRingTail);
+        availableSpace -= len;
+        streamingTxFifoLevel += len;
+        streamingTxCount++;
+
+        // Simplified debug output 
+        if (debugEnabled && (streamingTxCount % 100) == 0) {
+            sendStringToDebugUart("TX 100 packets\n");
+        }
+    }
+}
+
+// Queues a read of the RX FIFO into the next free RX buffer, or into the discard buffer if
+// the application holds all of them
+void CC1200::drainStreamingRx()
+{
+    size_t const rxFifoLen = std::min<size_t>(streamingRxFifoLevel, CC1200_FIFO_SIZE);
+    if (rxFifoLen == 0) {
+        return;
+    }
+
+    SPIDescriptor read = {};
+    read.header[0] = CC1200_DEQUEUE_RX_FIFO | CC1200_BURST;
+    read.headerLen = 1;
+    read.len = rxFifoLen;
+    read.context = this;
+
+    bool success;
+    if (streamingRxHead - streamingRxTail < streamingDMABuffers) {
+        StreamingBuffer& buffer = streamingRxBuffers[streamingRxHead & (CC1200_STREAMING_DMA_BUFFERS - 1)];
+        buffer.len = rxFifoLen;
+        read.rxData = buffer.data;
+        read.onComplete = onStreamingRxBufferDone;
+
+        // counted before it is submitted, in case it completes inside submitSPI()
+        ++streamingRxHead;
+        success = submitSPI(read);
+        if (!success) {
+            --streamingRxHead;
+        }
+    } else {
+        // keep the FIFO from overflowing while the application catches up
+        read.onComplete = onStreamingTransferDone;
+        success = submitSPI(read);
+        if (success) {
+            streamingRxDroppedBytes += rxFifoLen;
+        }
+    }
+
+    if (success) {
+        streamingRxFifoLevel -= rxFifoLen;
+        streamingRxCount++;
+        
+        // Periodic debug output (every 50 packets)
+        if (debugEnabled && (streamingRxCount % 50) == 0) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Continuous RX: %lu transfers queued\n", (unsigned long)streamingRxCount);
+            sendStringToDebugUart(std::string(msg));
+        }
+    } else {
+        streamingRxErrors++;
+        if (debugEnabled && (streamingRxErrors % 10) == 0) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Continuous RX: Error queueing transfer (errors: %lu)\n", (unsigned long)streamingRxErrors);
+            sendStringToDebugUart(std::string(msg));
+        }
+    }
+}
+
+// Runs in the DMA completion interrupt for the continuous streaming transfers
+void CC1200::onStreamingTransferDone(SPIDescriptor const& descriptor, bool ok, void* context)
+{
+    if (ok) {
+        return;
+    }
+    CC1200* const radio = static_cast<CC1200*>(context);
+    if (descriptor.header[0] & CC1200_READ) {
+        radio->streamingRxErrors++;
+    } else {
+        radio->streamingTxErrors++;
+    }
+}
+
+// Runs in the DMA completion interrupt when a TX staging buffer has been sent
+void CC1200::onStreamingTxBufferDone(SPIDescriptor const& descriptor, bool ok, void* context)
+{
+    CC1200* const radio = static_cast<CC1200*>(context);
+    if (ok) {
+        radio->streamingTxBytes += descriptor.len;
+    } else {
+        radio->streamingTxErrors++;
+    }
+    std::atomic_signal_fence(std::memory_order_release);
+    radio->streamingTxDone = radio->streamingTxDone + 1;
+}
+
+// Runs in the DMA completion interrupt when an RX buffer has been filled
+void CC1200::onStreamingRxBufferDone(SPIDescriptor const& descriptor, bool ok, void* context)
+{
+    CC1200* const radio = static_cast<CC1200*>(context);
+    if (ok) {
+        radio->streamingRxBytes += descriptor.len;
+    } else {
+        // an empty buffer is skipped by acquireStreamingRxBuffer()
+        radio->streamingRxBuffers[radio->streamingRxDone & (CC1200_STREAMING_DMA_BUFFERS - 1)].len = 0;
+        radio->streamingRxErrors++;
+    }
+    std::atomic_signal_fence(std::memory_order_release);
+    radio->streamingRxDone = radio->streamingRxDone + 1;
+}
+
+size_t CC1200::writeStreamingTx(char const* data, size_t len)
+{
+    std::atomic_signal_fence(std::memory_order_acquire);
+    size_t const space = CC1200_STREAM_RING_LEN - (streamingTxRingHead - streamingTxRingTail);
+    if (len > space) {
+        len = space;
+    }
+    ringWrite(streamingTxRing, CC1200_STREAM_RING_LEN, streamingTxRingHead, reinterpret_cast<uint8_t const*>(data), len);
+    std::atomic_signal_fence(std::memory_order_release);
+    streamingTxRingHead = streamingTxRingHead + len;
+    return len;
+}
+
+uint8_t const* CC1200::acquireStreamingRxBuffer(size_t& len)
+{
+    std::atomic_signal_fence(std::memory_order_acquire);
+    while (streamingRxTail != streamingRxDone) {
+        StreamingBuffer const& buffer = streamingRxBuffers[streamingRxTail & (CC1200_STREAMING_DMA_BUFFERS - 1)];
+        if (buffer.len > 0) {
+            len = buffer.len;
+            return buffer.data;
         }
-        // If DMA transfer is in progress, just skip this iteration
+        ++streamingRxTail; // its transfer failed
     }
+    return nullptr;
+}
+
+void CC1200::releaseStreamingRxBuffer()
+{
+    if (streamingRxTail != streamingRxDone) {
+        ++streamingRxTail;
+    }
+}
+
+bool CC1200::setStreamingDMABuffers(size_t count)
+{
+    if (continuousStreamingTx || continuousStreamingRx || count == 0 || count > CC1200_STREAMING_DMA_BUFFERS) {
+        return false;
+    }
+    streamingDMABuffers = count;
+    return true;
+}
+
+// helper function: bytes per second over a span of ms
+static uint32_t bytesPerSecond(uint32_t bytes, uint32_t ms)
+{
+    return ms > 0 ? static_cast<uint32_t>(static_cast<uint64_t>(bytes) * 1000 / ms) : 0;
+}
+
+CC1200::StreamingThroughput CC1200::getStreamingThroughput()
+{
+    uint32_t const now = bus.getMillis();
+    StreamingThroughput throughput;
+    throughput.txBytes = streamingTxBytes;
+    throughput.rxBytes = streamingRxBytes;
+    throughput.rxDroppedBytes = streamingRxDroppedBytes;
+    throughput.txBytesPerSecond = bytesPerSecond(streamingTxBytes, (continuousStreamingTx ? now : streamingTxStopMs) - streamingTxStartMs);
+    throughput.rxBytesPerSecond = bytesPerSecond(streamingRxBytes + streamingRxDroppedBytes,
+                                                 (continuousStreamingRx ? now : streamingRxStopMs) - streamingRxStartMs);
+    return throughput;
 }
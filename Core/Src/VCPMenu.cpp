@@ -152,28 +152,36 @@ void VCPMenu::executeCommand(const char* cmd, int argc, char* argv[]) {
         cmdRadioRSSI(argc, argv);
     } else if (strcmp(argv[0], "radio_rx") == 0) {
         cmdRadioRX(argc, argv);
+    } else if (strcmp(argv[0], "radio_rx_long") == 0) {
+        cmdRadioRXLong(argc, argv);
     } else if (strcmp(argv[0], "radio_status") == 0) {
         cmdRadioStatus(argc, argv);
     } else if (strcmp(argv[0], "radio_stream_rx") == 0) {
         cmdRadioStreamRX(argc, argv);
     } else if (strcmp(argv[0], "radio_stream_tx") == 0) {
         cmdRadioStreamTX(argc, argv);
+    } else if (strcmp(argv[0], "radio_fstream_tx") == 0) {
+        cmdRadioFramedStreamTX(argc, argv);
+    } else if (strcmp(argv[0], "radio_fstream_rx") == 0) {
+        cmdRadioFramedStreamRX(argc, argv);
     } else if (strcmp(argv[0], "radio_tx") == 0) {
         cmdRadioTX(argc, argv);
+    } else if (strcmp(argv[0], "radio_tx_long") == 0) {
+        cmdRadioTXLong(argc, argv);
+    } else if (strcmp(argv[0], "radio_tx_burst") == 0) {
+        cmdRadioTXBurst(argc, argv);
     } else if (strcmp(argv[0], "radio_version") == 0) {
         cmdRadioVersion(argc, argv);
     } else if (strcmp(argv[0], "radio_debug_on") == 0) {
         cmdRadioDebugOn(argc, argv);
     } else if (strcmp(argv[0], "radio_debug_off") == 0) {
         cmdRadioDebugOff(argc, argv);
-    } else if (strcmp(argv[0], "radio_tx_dma") == 0) {
-        cmdRadioTXDMA(argc, argv);
-    } else if (strcmp(argv[0], "radio_rx_dma") == 0) {
-        cmdRadioRXDMA(argc, argv);
-    } else if (strcmp(argv[0], "radio_stream_tx_dma") == 0) {
-        cmdRadioStreamTXDMA(argc, argv);
-    } else if (strcmp(argv[0], "radio_stream_rx_dma") == 0) {
-        cmdRadioStreamRXDMA(argc, argv);
+    } else if (strcmp(argv[0], "radio_spi_bench") == 0) {
+        cmdRadioSPIBench(argc, argv);
+    } else if (strcmp(argv[0], "radio_spi_trace") == 0) {
+        cmdRadioSPITrace(argc, argv);
+    } else if (strcmp(argv[0], "radio_rx_pool") == 0) {
+        cmdRadioRXPool(argc, argv);
     } else if (strcmp(argv[0], "radio_stream_start_tx") == 0) {
         cmdRadioStreamStartTX(argc, argv);
     } else if (strcmp(argv[0], "radio_stream_start_rx") == 0) {
@@ -186,6 +194,8 @@ void VCPMenu::executeCommand(const char* cmd, int argc, char* argv[]) {
         cmdRadioStreamStats(argc, argv);
     } else if (strcmp(argv[0], "radio_stream_diag") == 0) {
         cmdRadioStreamDiag(argc, argv);
+    } else if (strcmp(argv[0], "radio_stream_buffers") == 0) {
+        cmdRadioStreamBuffers(argc, argv);
     } else if (strcmp(argv[0], "restart") == 0) {
         cmdRestart(argc, argv);
     } else if (strcmp(argv[0], "sysinfo") == 0) {
@@ -231,20 +241,21 @@ void VCPMenu::displayHelp() {
     printf("  radio_lqi            - Get Link Quality Indicator\r\n");
     printf("  radio_rssi           - Get current RSSI value\r\n");
     printf("  radio_rx <timeout_ms> - Start receiving with timeout\r\n");
+    printf("  radio_rx_long <timeout_ms> [fixed_len] - Receive a packet longer than the RX FIFO\r\n");
+    printf("  radio_rx_pool <timeout_ms> - Receive a packet into the receive pool\r\n");
     printf("  radio_status         - Get CC1200 radio status\r\n");
     printf("  radio_stream_rx <bytes> <timeout_ms> - Start receiving stream\r\n");
     printf("  radio_stream_tx <hex_data> - Start transmitting stream\r\n");
+    printf("  radio_fstream_tx <bytes> - Send a counting pattern over the framed stream\r\n");
+    printf("  radio_fstream_rx <timeout_ms> - Receive and check a framed stream counting pattern\r\n");
     printf("  radio_tx <hex_data>  - Transmit data as hex\r\n");
+    printf("  radio_tx_long <bytes> - Transmit a test packet longer than the TX FIFO\r\n");
+    printf("  radio_tx_burst <count> <bytes> - Transmit test packets back to back from the TX queue\r\n");
     printf("  radio_version        - Get CC1200 part version\r\n");
-    printf("  radio_debug_on       - Enable SPI debug output to UART\r\n");
-    printf("  radio_debug_off      - Disable SPI debug output\r\n");
-    printf("\r\n");
-    
-    printf("DMA-enabled radio commands:\r\n");
-    printf("  radio_tx_dma <hex_data> - Transmit data using DMA\r\n");
-    printf("  radio_rx_dma <timeout_ms> - Receive data using DMA\r\n");
-    printf("  radio_stream_tx_dma <hex_data> - Stream transmit using DMA\r\n");
-    printf("  radio_stream_rx_dma <bytes> <timeout_ms> - Stream receive using DMA\r\n");
+    printf("  radio_debug_on       - Enable radio debug output to UART\r\n");
+    printf("  radio_debug_off      - Disable radio debug output\r\n");
+    printf("  radio_spi_bench [reads] - Time register reads, polled vs HAL SPI\r\n");
+    printf("  radio_spi_trace [on|off|clear|dump] - Record SPI transactions / dump the trace\r\n");
     printf("\r\n");
     
     printf("Continuous streaming commands:\r\n");
@@ -253,6 +264,7 @@ void VCPMenu::displayHelp() {
     printf("  radio_stream_start_rx_verbose - Start RX streaming with data output\r\n");
     printf("  radio_stream_stop - Stop all continuous streaming\r\n");
     printf("  radio_stream_stats - Show streaming statistics\r\n");
+    printf("  radio_stream_buffers <1-%u> - Set streaming DMA buffers per direction\r\n", (unsigned int)CC1200_STREAMING_DMA_BUFFERS);
     printf("\r\n");
     
     printf("System commands:\r\n");
@@ -432,6 +444,9 @@ void VCPMenu::cmdReceive(int argc, char* argv[]) {
     
     // Start continuous receive mode
     cc1200->sendCommand(CC1200::Command::RX);
+    if (!cc1200->waitForState(CC1200::State::RX, 1000)) {
+        printf("Warning: radio did not enter RX\r\n");
+    }
     
     // Turn on RX LED for visual feedback
     this->globals->setRxLED(1);
@@ -439,19 +454,24 @@ void VCPMenu::cmdReceive(int argc, char* argv[]) {
     // Receive buffer
     char rxBuffer[VCP_RX_BUFFER_SIZE];
     
-    // Receive loop
+    // Receive loop.  Every packet that arrived since the last pass comes out of one
+    // FIFO read, so back to back packets are all shown.
     bool receiving = true;
     while (receiving) {
-        // Check for received data
-        size_t rxLen = cc1200->receivePacket(rxBuffer, sizeof(rxBuffer) - 1);
-        
-        if (rxLen > 0) {
+        cc1200->drainReceivedPackets([this, &rxBuffer](CC1200::PacketDescriptor const& packet) {
             // Null-terminate received data
+            size_t rxLen = packet.length < sizeof(rxBuffer) - 1 ? packet.length : sizeof(rxBuffer) - 1;
+            memcpy(rxBuffer, packet.data, rxLen);
             rxBuffer[rxLen] = '\0';
             
-            // Display received data
-            printf("Received: %s\r\n", rxBuffer);
-        }
+            // Display received data, with the link metrics of this packet
+            if (packet.hasStatus) {
+                printf("Received: %s (RSSI %d dBm, LQI %u%s)\r\n", rxBuffer, packet.rssi, packet.lqi,
+                       packet.crcOk ? "" : ", bad CRC");
+            } else {
+                printf("Received: %s\r\n", rxBuffer);
+            }
+        });
         
         // Check if user pressed a key to stop
         if (this->rxBufferTail != this->rxBufferHead) {
@@ -459,7 +479,7 @@ void VCPMenu::cmdReceive(int argc, char* argv[]) {
         }
         
         // Give other tasks a chance to run
-        HAL_Delay(10);
+        HAL_Delay(VCP_RX_POLL_MS);
     }
     
     // Stop continuous receive mode
@@ -598,7 +618,7 @@ void VCPMenu::cmdRadioDebugOn(int argc, char* argv[]) {
         printf("UART handle is null!\r\n");
     }
     
-    // Force a simple SPI transaction to generate debug output
+    // Force a simple SPI transaction to check the link
     uint8_t partNumber = cc1200->readRegister(CC1200::ExtRegister::PARTNUMBER);
     printf("Triggered SPI read of part number: 0x%02X\r\n", partNumber);
 }
@@ -679,33 +699,31 @@ void VCPMenu::cmdRadioRX(int argc, char* argv[]) {
     // Turn on RX LED for visual feedback
     this->globals->setRxLED(1);
     
-    // Receive buffer
-    char rxBuffer[VCP_RX_BUFFER_SIZE];
+    // Received packet
+    CC1200::PacketDescriptor packet;
     uint32_t startTime = HAL_GetTick();
     bool received = false;
     
     // Receive loop
     while (HAL_GetTick() - startTime < timeout) {
         // Check for received data
-        size_t rxLen = cc1200->receivePacket(rxBuffer, sizeof(rxBuffer) - 1);
-        
-        if (rxLen > 0) {
-            // Null-terminate received data
-            rxBuffer[rxLen] = '\0';
-            
+        if (cc1200->receivePacket(packet)) {
             // Display received data as hex
-            printf("Received %u bytes: ", (unsigned int)rxLen);
-            for (size_t i = 0; i < rxLen; i++) {
-                printf("%02X ", (uint8_t)rxBuffer[i]);
+            printf("Received %u bytes: ", (unsigned int)packet.length);
+            for (size_t i = 0; i < packet.length; i++) {
+                printf("%02X ", packet.data[i]);
             }
             printf("\r\n");
+            if (packet.hasStatus) {
+                printf("RSSI: %d dBm, LQI: %u, CRC: %s\r\n", packet.rssi, packet.lqi, packet.crcOk ? "OK" : "bad");
+            }
             
             received = true;
             break;
         }
         
         // Give other tasks a chance to run
-        HAL_Delay(10);
+        HAL_Delay(VCP_RX_POLL_MS);
     }
     
     // Stop receiving
@@ -719,6 +737,75 @@ void VCPMenu::cmdRadioRX(int argc, char* argv[]) {
     }
 }
 
+/**
+ * @brief Command handler: radio_rx_long - Receive one packet, draining the RX FIFO from
+ * the GPIO2 threshold and GPIO3 end of packet interrupts
+ */
+void VCPMenu::cmdRadioRXLong(int argc, char* argv[]) {
+    CC1200* cc1200 = this->globals->getCC1200();
+    if (cc1200 == nullptr) {
+        printf("Error: CC1200 not initialized\r\n");
+        return;
+    }
+
+    if (argc < 2) {
+        printf("Usage: radio_rx_long <timeout_ms> [fixed_len]\r\n");
+        return;
+    }
+
+    uint32_t timeout = strtoul(argv[1], NULL, 10);
+    size_t fixedLen = argc > 2 ? strtoul(argv[2], NULL, 10) : 0;
+    if (timeout == 0) {
+        printf("Invalid timeout value\r\n");
+        return;
+    }
+    if (fixedLen > CC1200_LONG_RX_MAX_LEN) {
+        printf("Error: fixed length must be at most %u bytes\r\n", (unsigned int)CC1200_LONG_RX_MAX_LEN);
+        return;
+    }
+
+    if (!cc1200->startLongPacketRx(fixedLen)) {
+        printf("Error: could not start long packet receive\r\n");
+        return;
+    }
+
+    printf("Receiving %s packet for %lu ms...\r\n", fixedLen > 0 ? "fixed length" : "variable length", timeout);
+    this->globals->setRxLED(1);
+
+    uint32_t startTime = HAL_GetTick();
+    const CC1200::LongRxPacket* packet = nullptr;
+    while (packet == nullptr && HAL_GetTick() - startTime < timeout) {
+        packet = cc1200->peekLongRxPacket();
+        if (packet == nullptr) {
+            HAL_Delay(10);
+        }
+    }
+
+    if (packet != nullptr) {
+        printf("Received %u bytes", (unsigned int)packet->length);
+        if (packet->hasStatus) {
+            printf(", CRC %s", packet->crcOk ? "OK" : "error");
+        }
+        printf(":");
+        size_t dumpLen = packet->length < VCP_RX_LONG_DUMP_LEN ? packet->length : VCP_RX_LONG_DUMP_LEN;
+        for (size_t i = 0; i < dumpLen; i++) {
+            printf(" %02X", packet->data[i]);
+        }
+        printf(packet->length > dumpLen ? " ...\r\n" : "\r\n");
+        cc1200->releaseLongRxPacket();
+    }
+
+    cc1200->stopLongPacketRx();
+    this->globals->setRxLED(0);
+
+    if (packet == nullptr) {
+        printf("No data received within timeout period\r\n");
+    }
+    if (cc1200->getLongRxOverflows() > 0) {
+        printf("RX FIFO overflows so far: %lu\r\n", cc1200->getLongRxOverflows());
+    }
+}
+
 /**
  * @brief Command handler: radio_status - Get CC1200 radio status
  */
@@ -737,11 +824,9 @@ void VCPMenu::cmdRadioStatus(int argc, char* argv[]) {
     // Update the radio state to get current status
     cc1200->updateState();
     
-    // Display the current state
+    // Display the current state, decoded from the status byte of that NOP strobe
     const char* stateStr = "Unknown";
-    // Read the MARCSTATE register to get the current state
-    uint8_t stateVal = cc1200->readRegister(CC1200::ExtRegister::MARCSTATE);
-    CC1200::State currentState = static_cast<CC1200::State>(stateVal & 0x1F); // Mask to get the state bits
+    CC1200::State currentState = cc1200->getState();
     
     switch (currentState) {
         case CC1200::State::IDLE:
@@ -769,11 +854,22 @@ void VCPMenu::cmdRadioStatus(int argc, char* argv[]) {
             stateStr = "TX_FIFO_ERROR";
             break;
     }
-    printf("  State: %s\r\n", stateStr);
+    printf("  State: %s%s (status 0x%02X)\r\n", stateStr, cc1200->isChipReady() ? "" : ", chip not ready",
+           cc1200->getLastStatus());
     
     // Display FIFO status
     printf("  TX FIFO: %u bytes\r\n", (unsigned int)cc1200->getTXFIFOLen());
     printf("  RX FIFO: %u bytes\r\n", (unsigned int)cc1200->getRXFIFOLen());
+
+    // FIFO threshold the interrupt driven paths use at the current data rate
+    printf("  FIFO threshold: %u (%lu us headroom, %lu us service overhead)\r\n",
+           (unsigned int)cc1200->updateFifoThreshold(), cc1200->getFifoHeadroomUs(),
+           cc1200->getFifoServiceOverheadUs());
+
+    CC1200::FifoRecoveryStats const recovery = cc1200->getFifoRecoveryStats();
+    printf("  FIFO errors: %lu RX, %lu TX, %lu recovered (last %lu us, max %lu us)\r\n",
+           recovery.rxFifoErrors, recovery.txFifoErrors, recovery.recoveries,
+           recovery.lastLatencyUs, recovery.maxLatencyUs);
     printf("\r\n");
 }
 
@@ -933,6 +1029,124 @@ void VCPMenu::cmdRadioStreamTX(int argc, char* argv[]) {
     printf("Stream transmission complete: %u of %u bytes sent\r\n", (unsigned int)bytesWritten, (unsigned int)txLen);
 }
 
+/**
+ * @brief Command handler: radio_fstream_tx - Send a counting pattern of the given
+ * length over the framed stream, then wait for it to go out
+ */
+void VCPMenu::cmdRadioFramedStreamTX(int argc, char* argv[]) {
+    CC1200* cc1200 = this->globals->getCC1200();
+    if (cc1200 == nullptr) {
+        printf("Error: CC1200 not initialized\r\n");
+        return;
+    }
+
+    if (argc < 2) {
+        printf("Usage: radio_fstream_tx <bytes>\r\n");
+        return;
+    }
+
+    uint32_t total = strtoul(argv[1], NULL, 10);
+    if (total == 0) {
+        printf("Invalid byte count\r\n");
+        return;
+    }
+
+    if (!cc1200->startFramedStreamTx()) {
+        printf("Error: could not start framed stream TX\r\n");
+        return;
+    }
+
+    printf("Sending %lu bytes over the framed stream...\r\n", total);
+    this->globals->setTxLED(1);
+
+    uint8_t chunk[64];
+    uint32_t sent = 0;
+    while (sent < total) {
+        size_t len = total - sent < sizeof(chunk) ? total - sent : sizeof(chunk);
+        len = len < cc1200->getFramedStreamTxFree() ? len : cc1200->getFramedStreamTxFree();
+        if (len == 0) {
+            // the ring drains at the air rate
+            HAL_Delay(1);
+            continue;
+        }
+        for (size_t i = 0; i < len; i++) {
+            chunk[i] = (uint8_t)(sent + i);
+        }
+        sent += cc1200->framedStreamWrite(chunk, len);
+    }
+
+    bool drained = cc1200->stopFramedStreamTx(VCP_FSTREAM_DRAIN_TIMEOUT_MS);
+    this->globals->setTxLED(0);
+
+    CC1200::FramedStreamStats stats = cc1200->getFramedStreamStats();
+    printf("%s: %lu frames (%lu idle), %lu TX FIFO underflows\r\n",
+           drained ? "Done" : "Error: timed out draining the stream",
+           stats.txFrames, stats.txIdleFrames, stats.txUnderflows);
+}
+
+/**
+ * @brief Command handler: radio_fstream_rx - Receive a framed stream for the given time
+ * and check it against the radio_fstream_tx counting pattern
+ */
+void VCPMenu::cmdRadioFramedStreamRX(int argc, char* argv[]) {
+    CC1200* cc1200 = this->globals->getCC1200();
+    if (cc1200 == nullptr) {
+        printf("Error: CC1200 not initialized\r\n");
+        return;
+    }
+
+    if (argc < 2) {
+        printf("Usage: radio_fstream_rx <timeout_ms>\r\n");
+        return;
+    }
+
+    uint32_t timeout = strtoul(argv[1], NULL, 10);
+    if (timeout == 0) {
+        printf("Invalid timeout value\r\n");
+        return;
+    }
+
+    if (!cc1200->startFramedStreamRx()) {
+        printf("Error: could not start framed stream RX\r\n");
+        return;
+    }
+
+    printf("Receiving framed stream for %lu ms...\r\n", timeout);
+    this->globals->setRxLED(1);
+
+    // Lost frames show up as breaks in the count.  Frames start at arbitrary
+    // offsets, so the pattern is followed from the first byte received.
+    uint8_t buffer[64];
+    uint32_t received = 0;
+    uint32_t breaks = 0;
+    uint8_t expected = 0;
+    uint32_t startTime = HAL_GetTick();
+    while (HAL_GetTick() - startTime < timeout) {
+        size_t len = cc1200->framedStreamRead(buffer, sizeof(buffer));
+        if (len == 0) {
+            HAL_Delay(1);
+            continue;
+        }
+        for (size_t i = 0; i < len; i++) {
+            if (received > 0 && buffer[i] != expected) {
+                breaks++;
+            }
+            expected = buffer[i] + 1;
+            received++;
+        }
+    }
+
+    cc1200->stopFramedStreamRx();
+    this->globals->setRxLED(0);
+
+    CC1200::FramedStreamStats stats = cc1200->getFramedStreamStats();
+    printf("Received %lu bytes, %lu breaks in the pattern\r\n", received, breaks);
+    printf("  Frames: %lu good (%lu idle), %lu bad, %lu lost\r\n",
+           stats.rxFrames, stats.rxIdleFrames, stats.rxBadFrames, stats.rxLostFrames);
+    printf("  RX ring overflows: %lu, RX FIFO overflows: %lu, resyncs: %lu\r\n",
+           stats.rxRingOverflows, stats.rxFifoOverflows, stats.rxResyncs);
+}
+
 /**
  * @brief Command handler: radio_tx - Transmit data (Usage: radio_tx <hex_data>)
  */
@@ -1003,246 +1217,362 @@ void VCPMenu::cmdRadioTX(int argc, char* argv[]) {
 }
 
 /**
- * @brief Command handler: radio_version - Get CC1200 part version
+ * @brief Command handler: radio_tx_long - Transmit a counting pattern of the given
+ * length, refilling the TX FIFO from the GPIO0 threshold interrupt
  */
-void VCPMenu::cmdRadioVersion(int argc, char* argv[]) {
+void VCPMenu::cmdRadioTXLong(int argc, char* argv[]) {
     CC1200* cc1200 = this->globals->getCC1200();
     if (cc1200 == nullptr) {
         printf("Error: CC1200 not initialized\r\n");
         return;
     }
-    
-    
-    // Read part number and version
-    uint8_t partNumber = cc1200->readRegister(CC1200::ExtRegister::PARTNUMBER);
-    uint8_t partVersion = cc1200->readRegister(CC1200::ExtRegister::PARTVERSION);
-    
-    printf("CC1200 Part Number: 0x%02X\r\n", partNumber);
-    printf("CC1200 Part Version: 0x%02X\r\n", partVersion);
-}
 
-/**
- * @brief Command handler: restart - Restart the STM32
- */
-void VCPMenu::cmdRestart(int argc, char* argv[]) {
-    printf("Restarting system...\r\n");
-    
-    // Small delay to allow message to be sent
-    HAL_Delay(100);
-    
-    // Reset the system
-    NVIC_SystemReset();
+    if (argc < 2) {
+        printf("Usage: radio_tx_long <bytes>\r\n");
+        return;
+    }
+
+    // the driver reads the payload while it is on air, so it must outlive this call
+    static uint8_t txBuffer[VCP_TX_LONG_MAX_LEN];
+    size_t txLen = strtoul(argv[1], NULL, 10);
+    if (txLen == 0 || txLen > sizeof(txBuffer)) {
+        printf("Error: length must be 1 to %u bytes\r\n", (unsigned int)sizeof(txBuffer));
+        return;
+    }
+    for (size_t i = 0; i < txLen; i++) {
+        txBuffer[i] = (uint8_t)i;
+    }
+
+    printf("Transmitting %u bytes...\r\n", (unsigned int)txLen);
+    this->globals->setTxLED(1);
+    CC1200::LongTxStatus status = cc1200->transmitLongPacket(txBuffer, txLen, VCP_TX_LONG_TIMEOUT_MS);
+    this->globals->setTxLED(0);
+
+    switch (status) {
+        case CC1200::LongTxStatus::DONE:
+            printf("Transmission successful\r\n");
+            break;
+        case CC1200::LongTxStatus::UNDERFLOW:
+            printf("Error: TX FIFO underflow, packet cut short (%lu underflows so far)\r\n",
+                   cc1200->getLongTxUnderflows());
+            break;
+        default:
+            printf("Error: Transmission failed\r\n");
+            break;
+    }
 }
 
 /**
- * @brief Command handler: sysinfo - Display system information
+ * @brief Command handler: radio_tx_burst - Queue <count> packets of <bytes> bytes, each
+ * starting with its sequence number, and send them back to back
  */
-void VCPMenu::cmdSysInfo(int argc, char* argv[]) {
-    printf("\r\nSystem Information:\r\n");
-    printf("  MCU: STM32F4xx\r\n");
-    printf("  Radio: CC1200\r\n");
-    printf("  HAL Version: %u.%u.%u\r\n", HAL_GetHalVersion() >> 24, 
-           (HAL_GetHalVersion() >> 16) & 0xFF, 
-           (HAL_GetHalVersion() >> 8) & 0xFF);
-    printf("  System Clock: %lu MHz\r\n", HAL_RCC_GetSysClockFreq() / 1000000);
-    printf("  HCLK: %lu MHz\r\n", HAL_RCC_GetHCLKFreq() / 1000000);
-    printf("  Uptime: %lu ms\r\n", HAL_GetTick());
-    printf("\r\n");
-}
-
-// ============================================================================
-// DMA Command Handler Functions
-// ============================================================================
-
-void VCPMenu::cmdRadioTXDMA(int argc, char* argv[]) {
+void VCPMenu::cmdRadioTXBurst(int argc, char* argv[]) {
     CC1200* cc1200 = this->globals->getCC1200();
     if (cc1200 == nullptr) {
         printf("Error: CC1200 not initialized\r\n");
         return;
     }
 
-    if (argc < 2) {
-        printf("Usage: radio_tx_dma <hex_data>\r\n");
-        printf("Example: radio_tx_dma 48656C6C6F\r\n");
+    if (argc < 3) {
+        printf("Usage: radio_tx_burst <count> <bytes>\r\n");
         return;
     }
 
-    // Parse hex data
-    std::string hexStr = argv[1];
-    if (hexStr.length() % 2 != 0) {
-        printf("Error: Hex data must have even number of characters\r\n");
+    uint32_t count = strtoul(argv[1], NULL, 10);
+    size_t len = strtoul(argv[2], NULL, 10);
+    if (count == 0 || len == 0 || len > 255) {
+        printf("Error: need a count and a length of 1 to 255 bytes\r\n");
         return;
     }
 
-    size_t dataLen = hexStr.length() / 2;
-    if (dataLen > 127) {
-        printf("Error: Data too long (max 127 bytes)\r\n");
+    if (!cc1200->startTxQueue()) {
+        printf("Error: could not start the TX queue\r\n");
         return;
     }
 
-    char data[128];
-    for (size_t i = 0; i < dataLen; i++) {
-        std::string byteStr = hexStr.substr(i * 2, 2);
-        data[i] = static_cast<char>(strtol(byteStr.c_str(), nullptr, 16));
-    }
-
-    // Turn on TX LED
+    printf("Sending %lu packets of %u bytes...\r\n", count, (unsigned int)len);
     this->globals->setTxLED(1);
+    uint32_t startTime = HAL_GetTick();
 
-    // Transmit using DMA
-    bool success = cc1200->enqueuePacketDMA(data, dataLen);
+    uint8_t packet[255];
+    uint32_t queued = 0;
+    while (queued < count) {
+        for (size_t i = 0; i < len; i++) {
+            packet[i] = (uint8_t)(queued + i);
+        }
+        if (!cc1200->queuePacket(packet, len)) {
+            // the queue drains at the air rate
+            HAL_Delay(1);
+            cc1200->pollTxQueue();
+            continue;
+        }
+        queued++;
+    }
 
-    // Turn off TX LED
+    bool drained = cc1200->stopTxQueue(VCP_TX_BURST_DRAIN_TIMEOUT_MS);
+    uint32_t elapsed = HAL_GetTick() - startTime;
     this->globals->setTxLED(0);
 
-    if (success) {
-        printf("DMA transmission queued: %u bytes\r\n", (unsigned int)dataLen);
-    } else {
-        printf("Error: DMA transmission failed\r\n");
-    }
+    printf("%s: %lu packets in %lu ms, %lu TX FIFO underflows\r\n",
+           drained ? "Done" : "Error: timed out draining the queue",
+           queued, elapsed, cc1200->getTxQueueUnderflows());
 }
 
-void VCPMenu::cmdRadioRXDMA(int argc, char* argv[]) {
+/**
+ * @brief Command handler: radio_version - Get CC1200 part version
+ */
+void VCPMenu::cmdRadioVersion(int argc, char* argv[]) {
     CC1200* cc1200 = this->globals->getCC1200();
     if (cc1200 == nullptr) {
         printf("Error: CC1200 not initialized\r\n");
         return;
     }
+    
+    
+    // Read part number and version
+    uint8_t partNumber = cc1200->readRegister(CC1200::ExtRegister::PARTNUMBER);
+    uint8_t partVersion = cc1200->readRegister(CC1200::ExtRegister::PARTVERSION);
+    
+    printf("CC1200 Part Number: 0x%02X\r\n", partNumber);
+    printf("CC1200 Part Version: 0x%02X\r\n", partVersion);
+}
 
-    uint32_t timeout = 5000; // Default 5 second timeout
-    if (argc >= 2) {
-        timeout = strtoul(argv[1], nullptr, 10);
+/**
+ * @brief Time single register reads with the cycle counter
+ * @return Average cycles per read
+ */
+static uint32_t timeRegisterReads(CC1200* cc1200, uint32_t reads) {
+    uint32_t start = DWT->CYCCNT;
+    for (uint32_t i = 0; i < reads; i++) {
+        cc1200->readRegister(CC1200::Register::IOCFG0);
     }
+    return (DWT->CYCCNT - start) / reads;
+}
 
-    printf("Waiting for packet (timeout: %lu ms)...\r\n", timeout);
-
-    // Turn on RX LED
-    this->globals->setRxLED(1);
-
-    uint32_t startTime = HAL_GetTick();
-    char buffer[128];
-    size_t bytesReceived = 0;
+/**
+ * @brief Command handler: radio_spi_bench - Compare single register read latency
+ * of the polled and HAL SPI paths
+ */
+void VCPMenu::cmdRadioSPIBench(int argc, char* argv[]) {
+    CC1200* cc1200 = this->globals->getCC1200();
+    CC1200HALBus* bus = this->globals->getCC1200Bus();
+    if (cc1200 == nullptr || bus == nullptr) {
+        printf("Error: CC1200 not initialized\r\n");
+        return;
+    }
 
-    while ((HAL_GetTick() - startTime) < timeout) {
-        if (cc1200->hasReceivedPacket()) {
-            bytesReceived = cc1200->receivePacketDMA(buffer, sizeof(buffer));
-            break;
+    uint32_t reads = 1000;
+    if (argc > 1) {
+        reads = strtoul(argv[1], NULL, 10);
+        if (reads == 0) {
+            printf("Error: read count must be at least 1\r\n");
+            return;
         }
-        HAL_Delay(10); // Small delay to prevent busy waiting
     }
 
-    // Turn off RX LED
-    this->globals->setRxLED(0);
+    // keep trace recording out of the measurement
+    bool traceWasEnabled = cc1200->isSPITraceEnabled();
+    cc1200->setSPITraceEnabled(false);
+    size_t polledMaxLen = bus->getPolledMaxLen();
 
-    if (bytesReceived > 0) {
-        printf("DMA received %u bytes: ", (unsigned int)bytesReceived);
-        for (size_t i = 0; i < bytesReceived; i++) {
-            printf("%02X", (uint8_t)buffer[i]);
-        }
-        printf("\r\n");
-    } else {
-        printf("No data received (timeout)\r\n");
-    }
+    // a register read is a one byte header and one byte of data
+    bus->setPolledMaxLen(1);
+    uint32_t polledCycles = timeRegisterReads(cc1200, reads);
+    bus->setPolledMaxLen(0);
+    uint32_t halCycles = timeRegisterReads(cc1200, reads);
+
+    bus->setPolledMaxLen(polledMaxLen);
+    cc1200->setSPITraceEnabled(traceWasEnabled);
+
+    uint32_t cyclesPerUs = SystemCoreClock / 1000000;
+    printf("Single register read, average of %lu:\r\n", reads);
+    printf("  Polled: %lu cycles (%lu ns)\r\n", polledCycles, polledCycles * 1000 / cyclesPerUs);
+    printf("  HAL:    %lu cycles (%lu ns)\r\n", halCycles, halCycles * 1000 / cyclesPerUs);
 }
 
-void VCPMenu::cmdRadioStreamTXDMA(int argc, char* argv[]) {
+/**
+ * @brief Command handler: radio_spi_trace - Control the SPI transaction trace and
+ * dump its contents, oldest first
+ */
+void VCPMenu::cmdRadioSPITrace(int argc, char* argv[]) {
     CC1200* cc1200 = this->globals->getCC1200();
     if (cc1200 == nullptr) {
         printf("Error: CC1200 not initialized\r\n");
         return;
     }
 
-    if (argc < 2) {
-        printf("Usage: radio_stream_tx_dma <hex_data>\r\n");
-        printf("Example: radio_stream_tx_dma 48656C6C6F576F726C64\r\n");
+    const char* action = argc > 1 ? argv[1] : "dump";
+    if (strcmp(action, "on") == 0) {
+        cc1200->clearSPITrace();
+        cc1200->setSPITraceEnabled(true);
+        printf("SPI trace recording\r\n");
         return;
-    }
-
-    // Parse hex data
-    std::string hexStr = argv[1];
-    if (hexStr.length() % 2 != 0) {
-        printf("Error: Hex data must have even number of characters\r\n");
+    } else if (strcmp(action, "off") == 0) {
+        cc1200->setSPITraceEnabled(false);
+        printf("SPI trace stopped, %lu transactions recorded\r\n", cc1200->getSPITraceTotal());
         return;
-    }
-
-    size_t dataLen = hexStr.length() / 2;
-    if (dataLen > 254) {
-        printf("Error: Data too long for single DMA transfer (max 254 bytes)\r\n");
+    } else if (strcmp(action, "clear") == 0) {
+        cc1200->clearSPITrace();
+        printf("SPI trace cleared\r\n");
+        return;
+    } else if (strcmp(action, "dump") != 0) {
+        printf("Usage: radio_spi_trace [on|off|clear|dump]\r\n");
         return;
     }
 
-    char data[255];
-    for (size_t i = 0; i < dataLen; i++) {
-        std::string byteStr = hexStr.substr(i * 2, 2);
-        data[i] = static_cast<char>(strtol(byteStr.c_str(), nullptr, 16));
+    // hold the ring still while it is read out
+    bool wasEnabled = cc1200->isSPITraceEnabled();
+    cc1200->setSPITraceEnabled(false);
+
+    size_t entries = cc1200->getSPITraceLen();
+    uint32_t total = cc1200->getSPITraceTotal();
+    printf("SPI trace: %u of %lu transactions, times in ticks of %lu Hz\r\n",
+           (unsigned int)entries, total, cc1200->getSPITraceFrequency());
+    printf("   #      time  duration hdr  addr  len st  flags\r\n");
+
+    // format several entries per write so the dump goes out in bulk
+    char out[512];
+    size_t outLen = 0;
+    CC1200::SPITraceEntry entry;
+    uint32_t firstTimestamp = 0;
+    for (size_t i = 0; i < entries; i++) {
+        cc1200->getSPITraceEntry(i, entry);
+        if (i == 0) {
+            firstTimestamp = entry.timestamp;
+        }
+        char line[80];
+        int n = snprintf(line, sizeof(line), "%4u %9lu %9lu 0x%02X 0x%02X %4u %02X %s%s\r\n",
+                         (unsigned int)i, entry.timestamp - firstTimestamp, entry.duration,
+                         entry.header, entry.address, entry.length, entry.status,
+                         (entry.flags & CC1200::SPI_TRACE_DMA) ? "DMA " : "",
+                         (entry.flags & CC1200::SPI_TRACE_FAILED) ? "FAIL" : "");
+        if (n <= 0) {
+            continue;
+        }
+        if (outLen + n >= sizeof(out)) {
+            out[outLen] = '\0';
+            printf("%s", out);
+            outLen = 0;
+        }
+        memcpy(out + outLen, line, n);
+        outLen += n;
+    }
+    if (outLen > 0) {
+        out[outLen] = '\0';
+        printf("%s", out);
     }
 
-    // Turn on TX LED
-    this->globals->setTxLED(1);
-
-    // Stream transmit using DMA
-    size_t bytesWritten = cc1200->writeStreamDMA(data, dataLen);
+    cc1200->setSPITraceEnabled(wasEnabled);
+}
 
-    // Turn off TX LED
-    this->globals->setTxLED(0);
+/**
+ * @brief Command handler: restart - Restart the STM32
+ */
+void VCPMenu::cmdRestart(int argc, char* argv[]) {
+    printf("Restarting system...\r\n");
+    
+    // Small delay to allow message to be sent
+    HAL_Delay(100);
+    
+    // Reset the system
+    NVIC_SystemReset();
+}
 
-    printf("DMA stream transmitted: %u of %u bytes\r\n", 
-           (unsigned int)bytesWritten, (unsigned int)dataLen);
+/**
+ * @brief Command handler: sysinfo - Display system information
+ */
+void VCPMenu::cmdSysInfo(int argc, char* argv[]) {
+    printf("\r\nSystem Information:\r\n");
+    printf("  MCU: STM32F4xx\r\n");
+    printf("  Radio: CC1200\r\n");
+    printf("  HAL Version: %u.%u.%u\r\n", HAL_GetHalVersion() >> 24, 
+           (HAL_GetHalVersion() >> 16) & 0xFF, 
+           (HAL_GetHalVersion() >> 8) & 0xFF);
+    printf("  System Clock: %lu MHz\r\n", HAL_RCC_GetSysClockFreq() / 1000000);
+    printf("  HCLK: %lu MHz\r\n", HAL_RCC_GetHCLKFreq() / 1000000);
+    CC1200* cc1200 = this->globals->getCC1200();
+    if (cc1200 != nullptr) {
+        printf("  Radio SPI: %lu kHz, %lu kHz for extended reads\r\n",
+               cc1200->getSPIFrequency(false) / 1000, cc1200->getSPIFrequency(true) / 1000);
+
+        CC1200::TransferCalibration const& calibration = cc1200->getTransferCalibration();
+        if (calibration.valid) {
+            printf("  SPI transfer calibration (burst read, polled / interrupt / DMA):\r\n");
+            for (size_t i = 0; i < CC1200::NUM_TRANSFER_CALIBRATION_POINTS; i++) {
+                printf("    %3u bytes: %lu / %lu / %lu ns\r\n", calibration.length[i],
+                       calibration.polledNs[i], calibration.itNs[i], calibration.dmaNs[i]);
+            }
+        } else {
+            printf("  SPI transfer calibration: not run or failed\r\n");
+        }
+        if (cc1200->getITMinLen() == SIZE_MAX) {
+            printf("  Interrupt used from: never\r\n");
+        } else {
+            printf("  Interrupt used from: %u bytes\r\n", (unsigned int)cc1200->getITMinLen());
+        }
+        if (cc1200->getDMAMinLen() == SIZE_MAX) {
+            printf("  DMA used from: never\r\n");
+        } else {
+            printf("  DMA used from: %u bytes\r\n", (unsigned int)cc1200->getDMAMinLen());
+        }
+    }
+    printf("  Uptime: %lu ms\r\n", HAL_GetTick());
+    printf("\r\n");
 }
 
-void VCPMenu::cmdRadioStreamRXDMA(int argc, char* argv[]) {
+/**
+ * @brief Command handler: radio_rx_pool - Receive a packet into a receive pool buffer
+ * and print it from there
+ */
+void VCPMenu::cmdRadioRXPool(int argc, char* argv[]) {
     CC1200* cc1200 = this->globals->getCC1200();
     if (cc1200 == nullptr) {
         printf("Error: CC1200 not initialized\r\n");
         return;
     }
 
-    if (argc < 3) {
-        printf("Usage: radio_stream_rx_dma <bytes> <timeout_ms>\r\n");
-        printf("Example: radio_stream_rx_dma 64 5000\r\n");
-        return;
-    }
-
-    size_t bytesToRead = strtoul(argv[1], nullptr, 10);
-    uint32_t timeout = strtoul(argv[2], nullptr, 10);
-
-    if (bytesToRead > 254) {
-        printf("Error: Too many bytes requested (max 254)\r\n");
-        return;
+    uint32_t timeout = 5000; // Default 5 second timeout
+    if (argc >= 2) {
+        timeout = strtoul(argv[1], nullptr, 10);
     }
 
-    printf("Waiting for %u bytes (timeout: %lu ms)...\r\n", 
-           (unsigned int)bytesToRead, timeout);
+    printf("Waiting for packet (timeout: %lu ms)...\r\n", timeout);
 
     // Turn on RX LED
     this->globals->setRxLED(1);
 
+    // The packet is burst straight into a receive pool buffer, which is printed from in
+    // place and then handed back
+    cc1200->sendCommand(CC1200::Command::RX);
     uint32_t startTime = HAL_GetTick();
-    char buffer[255];
-    size_t totalReceived = 0;
+    CC1200::RxPoolPacket* received = nullptr;
 
-    while (totalReceived < bytesToRead && (HAL_GetTick() - startTime) < timeout) {
-        size_t remainingBytes = bytesToRead - totalReceived;
-        size_t bytesReceived = cc1200->readStreamDMA(&buffer[totalReceived], remainingBytes);
-        
-        if (bytesReceived > 0) {
-            totalReceived += bytesReceived;
-            printf("DMA received %u bytes (total: %u)\r\n", 
-                   (unsigned int)bytesReceived, (unsigned int)totalReceived);
-        } else {
-            HAL_Delay(10); // Small delay if no data available
+    while ((HAL_GetTick() - startTime) < timeout) {
+        cc1200->drainToRxPool();
+        received = cc1200->acquireRxPoolPacket();
+        if (received != nullptr) {
+            break;
         }
+        HAL_Delay(VCP_RX_POLL_MS);
+    }
+
+    // Stop receiving, and drop anything that arrived behind the packet
+    cc1200->sendCommand(CC1200::Command::IDLE);
+    cc1200->sendCommand(CC1200::Command::FLUSH_RX);
+    while (CC1200::RxPoolPacket* extra = cc1200->acquireRxPoolPacket()) {
+        cc1200->releaseRxPoolPacket(extra);
     }
 
     // Turn off RX LED
     this->globals->setRxLED(0);
 
-    if (totalReceived > 0) {
-        printf("DMA stream received %u bytes: ", (unsigned int)totalReceived);
-        for (size_t i = 0; i < totalReceived; i++) {
-            printf("%02X", (uint8_t)buffer[i]);
+    if (received != nullptr) {
+        printf("Received %u bytes: ", (unsigned int)received->packet.length);
+        for (size_t i = 0; i < received->packet.length; i++) {
+            printf("%02X", received->packet.data[i]);
         }
         printf("\r\n");
+        cc1200->releaseRxPoolPacket(received);
     } else {
         printf("No data received (timeout)\r\n");
     }
@@ -1403,10 +1733,37 @@ void VCPMenu::cmdRadioStreamStats(int argc, char* argv[]) {
         printf("  RX Success Rate: %.2f%%\r\n", 
                (float)(rxCount * 100) / (rxCount + rxErrors));
     }
+
+    CC1200::StreamingThroughput throughput = cc1200->getStreamingThroughput();
+    printf("  DMA Buffers: %u per direction\r\n", (unsigned int)cc1200->getStreamingDMABuffers());
+    printf("  TX Bytes: %lu (%lu B/s)\r\n", throughput.txBytes, throughput.txBytesPerSecond);
+    printf("  RX Bytes: %lu (%lu B/s)\r\n", throughput.rxBytes, throughput.rxBytesPerSecond);
+    printf("  RX Dropped: %lu bytes\r\n", throughput.rxDroppedBytes);
     
     printf("\r\n");
 }
 
+void VCPMenu::cmdRadioStreamBuffers(int argc, char* argv[]) {
+    CC1200* cc1200 = this->globals->getCC1200();
+    if (cc1200 == nullptr) {
+        printf("Error: CC1200 not initialized\r\n");
+        return;
+    }
+
+    if (argc < 2) {
+        printf("Streaming DMA buffers: %u per direction\r\n", (unsigned int)cc1200->getStreamingDMABuffers());
+        printf("Usage: radio_stream_buffers <1-%u>\r\n", (unsigned int)CC1200_STREAMING_DMA_BUFFERS);
+        return;
+    }
+
+    size_t count = strtoul(argv[1], nullptr, 10);
+    if (!cc1200->setStreamingDMABuffers(count)) {
+        printf("Error: Stop streaming first, and use 1 to %u buffers\r\n", (unsigned int)CC1200_STREAMING_DMA_BUFFERS);
+        return;
+    }
+    printf("Streaming DMA buffers set to %u per direction\r\n", (unsigned int)count);
+}
+
 void VCPMenu::cmdRadioStreamDiag(int argc, char* argv[]) {
     CC1200* cc1200 = this->globals->getCC1200();
     if (cc1200 == nullptr) {
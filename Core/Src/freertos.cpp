@@ -339,7 +339,12 @@ void StartTask04(Globals* globals)
     CC1200* cc1200 = globals->getCC1200();
     if (cc1200 != nullptr) {
       // Continuous streaming is already processed in Task03
-      // This task focuses on RX LED indication
+      // This task consumes the received buffers and handles RX LED indication
+      size_t len;
+      while (cc1200->acquireStreamingRxBuffer(len) != nullptr) {
+        // the data is not used yet; handing the buffer back lets the driver drain into it
+        cc1200->releaseStreamingRxBuffer();
+      }
       
       // Update RX LED based on streaming state
       if (cc1200->isContinuousStreamingRx()) {
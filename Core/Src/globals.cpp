@@ -77,10 +77,11 @@ Globals::Globals(UART_HandleTypeDef* uart, IWDG_HandleTypeDef* iwdg, SPI_HandleT
     
     // Create CC1200 instance with hardware configuration
     // Using the defined pins from the STM32 configuration
-    cc1200 = new CC1200(spi, 
-                        // Note: Parameter order is CS then RST
-                        GPIOA, GPIO_PIN_4,  // CS pin - needs to be verified/configured
-                        _CC_RST_GPIO_Port, _CC_RST_Pin,  // Reset pin
+    cc1200Bus = new CC1200HALBus(spi,
+                                 // Note: Parameter order is CS then RST
+                                 GPIOA, GPIO_PIN_4,  // CS pin - needs to be verified/configured
+                                 _CC_RST_GPIO_Port, _CC_RST_Pin);  // Reset pin
+    cc1200 = new CC1200(*cc1200Bus,
                         [this](const std::string& msg) { this->sendDebugUSB(msg); },
                         false);  // Not CC1201
 }
@@ -95,6 +96,10 @@ Globals::~Globals() {
         delete cc1200;
         cc1200 = nullptr;
     }
+    if (cc1200Bus != nullptr) {
+        delete cc1200Bus;
+        cc1200Bus = nullptr;
+    }
 }
 
 /**
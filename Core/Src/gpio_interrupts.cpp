@@ -16,9 +16,16 @@ extern "C" void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
         if (globals != nullptr) {
             CC1200* cc1200 = globals->getCC1200();
             if (cc1200 != nullptr) {
-                // Handle the interrupt in the Radio class
-                // Handle CC1200 GPIO interrupt directly
-                // TODO: Add CC1200 GPIO interrupt handling if needed
+                if (GPIO_Pin == CC_GPIO0_Pin) {
+                    // TX FIFO drained below the threshold during a long packet
+                    cc1200->txFifoThresholdCallback();
+                } else if (GPIO_Pin == CC_GPIO2_Pin) {
+                    // RX FIFO filled above the threshold during a long packet
+                    cc1200->rxFifoThresholdCallback();
+                } else {
+                    // end of a long received packet or a TX queue packet
+                    cc1200->packetEndCallback();
+                }
             }
         }
     }
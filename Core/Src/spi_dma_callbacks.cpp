@@ -2,7 +2,7 @@
  * SPI DMA Callback Functions for CC1200 Integration
  * 
  * This file provides the bridge between STM32 HAL DMA callbacks
- * and the CC1200 driver DMA handling functions.
+ * and the CC1200 bus, which passes completion on to the driver.
  */
 
 #include "stm32f4xx_hal.h"
@@ -13,12 +13,15 @@ extern Globals* globals;
 
 /**
  * @brief SPI1 DMA TX Complete Callback
- * Called when SPI1 DMA transmission is complete
+ * Called when an SPI1 transmit-only DMA transfer is complete
  */
 extern "C" void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
 {
-    if (hspi->Instance == SPI1) {
-        // SPI1 TX DMA complete - handled by combined TxRx callback
+    if (hspi->Instance == SPI1 && globals != nullptr) {
+        CC1200HALBus* bus = globals->getCC1200Bus();
+        if (bus != nullptr) {
+            bus->dmaTransferCompleteCallback();
+        }
     }
 }
 
@@ -40,9 +43,9 @@ extern "C" void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
 extern "C" void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
 {
     if (hspi->Instance == SPI1 && globals != nullptr) {
-        CC1200* cc1200 = globals->getCC1200();
-        if (cc1200 != nullptr) {
-            cc1200->dmaTransferCompleteCallback();
+        CC1200HALBus* bus = globals->getCC1200Bus();
+        if (bus != nullptr) {
+            bus->dmaTransferCompleteCallback();
         }
     }
 }
@@ -54,9 +57,9 @@ extern "C" void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
 extern "C" void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
 {
     if (hspi->Instance == SPI1 && globals != nullptr) {
-        CC1200* cc1200 = globals->getCC1200();
-        if (cc1200 != nullptr) {
-            cc1200->dmaTransferErrorCallback();
+        CC1200HALBus* bus = globals->getCC1200Bus();
+        if (bus != nullptr) {
+            bus->dmaTransferErrorCallback();
         }
     }
 }
@@ -0,0 +1,728 @@
+/*
+ * Copyright (c) 2019-2023 USC Rocket Propulsion Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CC1200Sim.h"
+#include "CC1200Profile.h"
+
+#include <algorithm>
+#include <cstdint>
+
+// SPI header byte fields
+#define SIM_READ (1 << 7)
+#define SIM_BURST (1 << 6)
+#define SIM_ADDRESS_MASK 0x3F
+
+// SPI header addresses above the standard register space
+#define SIM_EXT_ADDR 0x2F
+#define SIM_STROBE_LAST 0x3D
+#define SIM_MEM_ACCESS 0x3E
+
+// values read back from the chip ID registers
+#define SIM_PART_NUMBER 0x20
+#define SIM_PART_VERSION 0x11
+
+// datasheet reset time
+#define SIM_RESET_TIME_NS 240000
+
+// time charged for each timestamp read, so polling loops move simulated time forward
+#define SIM_POLL_STEP_NS 100
+
+// PKT_CFG0 LENGTH_CONFIG values
+#define SIM_LENGTH_FIXED 0
+#define SIM_LENGTH_VARIABLE 1
+#define SIM_LENGTH_INFINITE 2
+
+bool CC1200Sim::Fifo::push(uint8_t value)
+{
+    if(count == sizeof(ram))
+    {
+        return false;
+    }
+    ram[last] = value;
+    last = (last + 1) % sizeof(ram);
+    ++count;
+    return true;
+}
+
+bool CC1200Sim::Fifo::pop(uint8_t& value)
+{
+    if(count == 0)
+    {
+        return false;
+    }
+    value = ram[first];
+    first = (first + 1) % sizeof(ram);
+    --count;
+    return true;
+}
+
+CC1200Sim::CC1200Sim()
+{
+    chipReset();
+}
+
+void CC1200Sim::chipReset()
+{
+    std::copy(CC1200_RESET_REGISTERS.begin(), CC1200_RESET_REGISTERS.end(), regs);
+    std::fill(std::begin(extRegs), std::end(extRegs), 0);
+    std::copy(CC1200_RESET_EXT_REGISTERS.begin(), CC1200_RESET_EXT_REGISTERS.end(), extRegs);
+    txFifo.flush();
+    rxFifo.flush();
+    enterState(State::IDLE);
+}
+
+// Time and bus functions
+
+void CC1200Sim::spend(uint64_t ns)
+{
+    // A background transfer finishes at its end time, within the span, so the transfer its
+    // completion starts runs straight after it.  Time the completion takes comes on top.
+    uint64_t const end = now + ns;
+    while(transferPending && !completingTransfer && transferDoneAt <= end)
+    {
+        if(transferDoneAt > now)
+        {
+            now = transferDoneAt;
+            runAir();
+        }
+        completingTransfer = true;
+        finishTransfer();
+        completingTransfer = false;
+    }
+    if(end > now)
+    {
+        now = end;
+        runAir();
+    }
+}
+
+void CC1200Sim::advance(uint64_t ns)
+{
+    spend(ns);
+}
+
+void CC1200Sim::select(ClockClass /*clockClass*/)
+{
+    if(transferPending)
+    {
+        ++stats.busConflicts;
+    }
+    ++stats.transactions;
+    spend(transactionOverheadNs);
+    selected = true;
+    phase = Phase::HEADER;
+}
+
+void CC1200Sim::deselect()
+{
+    if(transferPending)
+    {
+        ++stats.busConflicts;
+    }
+    selected = false;
+    phase = Phase::HEADER;
+}
+
+bool CC1200Sim::transfer(uint8_t const* txData, uint8_t* rxData, size_t len)
+{
+    if(!selected)
+    {
+        return false;
+    }
+    if(transferPending)
+    {
+        ++stats.busConflicts;
+        return false;
+    }
+
+    uint64_t const byteNs = 8000000000ULL / spiClock;
+    for(size_t i = 0; i < len; ++i)
+    {
+        spend(byteNs);
+        exchange(txData != nullptr ? txData + i : nullptr, rxData != nullptr ? rxData + i : nullptr, 1);
+    }
+    return true;
+}
+
+// Clocks bytes through the SPI decoder without charging time
+void CC1200Sim::exchange(uint8_t const* txData, uint8_t* rxData, size_t len)
+{
+    for(size_t i = 0; i < len; ++i)
+    {
+        uint8_t const miso = spiByte(txData != nullptr ? txData[i] : 0);
+        if(rxData != nullptr)
+        {
+            rxData[i] = miso;
+        }
+    }
+    stats.spiBytes += len;
+}
+
+bool CC1200Sim::writePaced(uint8_t const* data, size_t len, uint32_t gapNs)
+{
+    for(size_t i = 0; i < len; ++i)
+    {
+        if(i > 0)
+        {
+            spend(gapNs);
+        }
+        if(!transfer(data + i, nullptr, 1))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CC1200Sim::startTransfer(uint8_t const* txData, uint8_t* rxData, size_t len)
+{
+    if(!deferredTransfers)
+    {
+        bool const success = transfer(txData, rxData, len);
+        signalTransferComplete(success);
+        return true;
+    }
+
+    if(!selected || transferPending)
+    {
+        return false;
+    }
+    transferPending = true;
+    pendingTxData = txData;
+    pendingRxData = rxData;
+    pendingLen = len;
+    transferDoneAt = now + len * (8000000000ULL / spiClock);
+    return true;
+}
+
+// The bytes of a deferred transfer all move when it ends; its bus time has already passed
+void CC1200Sim::finishTransfer()
+{
+    transferPending = false;
+    exchange(pendingTxData, pendingRxData, pendingLen);
+    signalTransferComplete(true);
+}
+
+void CC1200Sim::setReset(bool asserted)
+{
+    if(asserted)
+    {
+        inReset = true;
+    }
+    else if(inReset)
+    {
+        inReset = false;
+        chipReset();
+        readyAt = now + SIM_RESET_TIME_NS;
+    }
+}
+
+void CC1200Sim::delayMs(uint32_t ms)
+{
+    spend(static_cast<uint64_t>(ms) * 1000000);
+}
+
+uint32_t CC1200Sim::getMillis()
+{
+    spend(SIM_POLL_STEP_NS);
+    return static_cast<uint32_t>(now / 1000000);
+}
+
+uint32_t CC1200Sim::getTimestamp()
+{
+    spend(SIM_POLL_STEP_NS);
+    return static_cast<uint32_t>(now / 1000);
+}
+
+// SPI protocol functions
+
+uint8_t CC1200Sim::statusByte() const
+{
+    bool const ready = !inReset && now >= readyAt;
+    return (ready ? 0 : 0x80) | (static_cast<uint8_t>(state) << 4);
+}
+
+uint8_t CC1200Sim::spiByte(uint8_t mosi)
+{
+    if(inReset)
+    {
+        return 0xFF;
+    }
+
+    uint8_t const status = statusByte();
+
+    switch(phase)
+    {
+        case Phase::HEADER:
+        {
+            readAccess = mosi & SIM_READ;
+            burst = mosi & SIM_BURST;
+            uint8_t const headerAddress = mosi & SIM_ADDRESS_MASK;
+
+            if(headerAddress < SIM_EXT_ADDR)
+            {
+                target = Target::REGISTER;
+                address = headerAddress;
+                phase = Phase::DATA;
+            }
+            else if(headerAddress == SIM_EXT_ADDR)
+            {
+                phase = Phase::EXT_ADDRESS;
+            }
+            else if(headerAddress <= SIM_STROBE_LAST)
+            {
+                // strobes take no data; the next byte is a new header
+                strobe(headerAddress);
+            }
+            else if(headerAddress == SIM_MEM_ACCESS)
+            {
+                phase = Phase::MEM_ADDRESS;
+            }
+            else
+            {
+                target = Target::FIFO;
+                phase = Phase::DATA;
+            }
+            return status;
+        }
+
+        case Phase::EXT_ADDRESS:
+            target = Target::EXT_REGISTER;
+            address = mosi;
+            phase = Phase::DATA;
+            return status;
+
+        case Phase::MEM_ADDRESS:
+            target = Target::MEMORY;
+            address = mosi;
+            phase = Phase::DATA;
+            return status;
+
+        case Phase::DATA:
+            break;
+    }
+
+    uint8_t miso = status;
+    switch(target)
+    {
+        case Target::REGISTER:
+            if(address < sizeof(regs))
+            {
+                if(readAccess)
+                {
+                    miso = regs[address];
+                }
+                else
+                {
+                    regs[address] = mosi;
+                }
+            }
+            break;
+
+        case Target::EXT_REGISTER:
+            if(readAccess)
+            {
+                miso = readExtRegister(address);
+            }
+            else if(address != static_cast<uint8_t>(CC1200::ExtRegister::NUM_TXBYTES) &&
+                    address != static_cast<uint8_t>(CC1200::ExtRegister::NUM_RXBYTES))
+            {
+                extRegs[address] = mosi;
+            }
+            break;
+
+        case Target::MEMORY:
+        {
+            Fifo& fifo = (address & 0x80) ? rxFifo : txFifo;
+            if(readAccess)
+            {
+                miso = fifo.ram[address & 0x7F];
+            }
+            else
+            {
+                fifo.ram[address & 0x7F] = mosi;
+            }
+            break;
+        }
+
+        case Target::FIFO:
+            if(readAccess)
+            {
+                if(!rxFifo.pop(miso))
+                {
+                    ++stats.rxUnderflows;
+                    enterState(State::RX_FIFO_ERROR);
+                    miso = 0;
+                }
+            }
+            else if(!txFifo.push(mosi))
+            {
+                ++stats.txOverflows;
+                enterState(State::TX_FIFO_ERROR);
+            }
+            break;
+    }
+
+    if(!burst)
+    {
+        phase = Phase::HEADER;
+    }
+    else if(target != Target::FIFO)
+    {
+        ++address;
+    }
+    return miso;
+}
+
+uint8_t CC1200Sim::readExtRegister(uint8_t extAddress)
+{
+    switch(static_cast<CC1200::ExtRegister>(extAddress))
+    {
+        case CC1200::ExtRegister::MARCSTATE:
+            switch(state)
+            {
+                case State::IDLE: return 0x41;
+                case State::RX: return 0x6D;
+                case State::TX: return 0x33;
+                case State::FSTXON: return 0x12;
+                case State::RX_FIFO_ERROR: return 0x11;
+                case State::TX_FIFO_ERROR: return 0x16;
+            }
+            return 0;
+        case CC1200::ExtRegister::RSSI1: return static_cast<uint8_t>(rssi >> 4);
+        case CC1200::ExtRegister::RSSI0: return static_cast<uint8_t>(((rssi & 0xF) << 3) | 1); // RSSI_VALID
+        case CC1200::ExtRegister::LQI_VAL: return static_cast<uint8_t>((lastCrcOk ? 0x80 : 0) | lqi);
+        case CC1200::ExtRegister::PARTNUMBER: return SIM_PART_NUMBER;
+        case CC1200::ExtRegister::PARTVERSION: return SIM_PART_VERSION;
+        case CC1200::ExtRegister::RXFIRST: return rxFifo.first;
+        case CC1200::ExtRegister::TXFIRST: return txFifo.first;
+        case CC1200::ExtRegister::RXLAST: return rxFifo.last;
+        case CC1200::ExtRegister::TXLAST: return txFifo.last;
+        case CC1200::ExtRegister::NUM_TXBYTES: return static_cast<uint8_t>(txFifo.count);
+        case CC1200::ExtRegister::NUM_RXBYTES: return static_cast<uint8_t>(rxFifo.count);
+        default: return extRegs[extAddress];
+    }
+}
+
+void CC1200Sim::strobe(uint8_t command)
+{
+    bool const fifoError = state == State::RX_FIFO_ERROR || state == State::TX_FIFO_ERROR;
+
+    switch(static_cast<CC1200::Command>(command))
+    {
+        case CC1200::Command::SOFT_RESET:
+            chipReset();
+            readyAt = now + SIM_RESET_TIME_NS;
+            break;
+        case CC1200::Command::FAST_TX_ON:
+            if(state == State::IDLE)
+            {
+                enterState(State::FSTXON);
+            }
+            break;
+        case CC1200::Command::RX:
+            if(!fifoError)
+            {
+                enterState(State::RX);
+            }
+            break;
+        case CC1200::Command::TX:
+            if(!fifoError)
+            {
+                enterState(State::TX);
+            }
+            break;
+        case CC1200::Command::IDLE:
+        case CC1200::Command::OSC_OFF:
+        case CC1200::Command::SLEEP:
+        case CC1200::Command::WAKE_ON_RADIO:
+            // power down modes are not modeled and behave like IDLE
+            enterState(State::IDLE);
+            break;
+        case CC1200::Command::FLUSH_RX:
+            if(state == State::IDLE || state == State::RX_FIFO_ERROR)
+            {
+                rxFifo.flush();
+                enterState(State::IDLE);
+            }
+            break;
+        case CC1200::Command::FLUSH_TX:
+            if(state == State::IDLE || state == State::TX_FIFO_ERROR)
+            {
+                txFifo.flush();
+                enterState(State::IDLE);
+            }
+            break;
+        default:
+            // calibration, AFC, WOR reset and NOP have no modeled effect
+            break;
+    }
+}
+
+// Radio functions
+
+uint8_t CC1200Sim::lengthConfig() const
+{
+    return (regs[static_cast<uint8_t>(CC1200::Register::PKT_CFG0)] >> PKT_CFG0_LENGTH_CONFIG) & 0b11;
+}
+
+void CC1200Sim::enterState(State newState)
+{
+    if(newState != State::TX)
+    {
+        txPacketActive = false;
+    }
+    if(newState != State::RX)
+    {
+        // a packet cut off part way is lost
+        if(rxPacketActive && !airRxQueue.empty())
+        {
+            airRxQueue.pop_front();
+        }
+        rxPacketActive = false;
+        rxStreamSynced = false;
+    }
+    if(newState != state)
+    {
+        airTime = now;
+    }
+    state = newState;
+}
+
+// helper function: the state selected by a 2 bit RXOFF_MODE or TXOFF_MODE field
+static uint8_t offModeField(uint8_t reg, uint8_t shift)
+{
+    return (reg >> shift) & 0b11;
+}
+
+void CC1200Sim::afterTx()
+{
+    ++stats.packetsSent;
+    switch(offModeField(regs[static_cast<uint8_t>(CC1200::Register::RFEND_CFG0)], RFEND_CFG0_TXOFF_MODE))
+    {
+        case 0: enterState(State::IDLE); break;
+        case 1: enterState(State::FSTXON); break;
+        case 2: break; // stay in TX for the next packet
+        default: enterState(State::RX); break;
+    }
+}
+
+void CC1200Sim::afterRx()
+{
+    ++stats.packetsReceived;
+    switch(offModeField(regs[static_cast<uint8_t>(CC1200::Register::RFEND_CFG1)], RFEND_CFG1_RXOFF_MODE))
+    {
+        case 0: enterState(State::IDLE); break;
+        case 1: enterState(State::FSTXON); break;
+        case 2: enterState(State::TX); break;
+        default: break; // stay in RX for the next packet
+    }
+}
+
+void CC1200Sim::runAir()
+{
+    if(state != State::TX && state != State::RX)
+    {
+        airTime = now;
+        return;
+    }
+
+    uint64_t const byteNs = 8000000000ULL / airRate;
+    while(now - airTime >= byteNs)
+    {
+        airTime += byteNs;
+        airByte();
+        if(state != State::TX && state != State::RX)
+        {
+            airTime = now;
+            return;
+        }
+    }
+}
+
+void CC1200Sim::airByte()
+{
+    if(state == State::TX)
+    {
+        if(!txPacketActive)
+        {
+            // the modulator sends preamble until the first byte is in the TX FIFO
+            if(txFifo.count == 0)
+            {
+                return;
+            }
+
+            txPacketActive = true;
+            txOverheadLeft = packetOverheadBytes;
+            txVariable = lengthConfig() == SIM_LENGTH_VARIABLE;
+            txAwaitingLength = txVariable;
+            txByteCount = 0;
+            sentPackets.emplace_back();
+            return;
+        }
+
+        if(txOverheadLeft > 0)
+        {
+            --txOverheadLeft;
+            return;
+        }
+
+        uint8_t value;
+        if(!txFifo.pop(value))
+        {
+            ++stats.txUnderflows;
+            enterState(State::TX_FIFO_ERROR);
+            return;
+        }
+        ++stats.txAirBytes;
+
+        bool packetDone;
+        if(txAwaitingLength)
+        {
+            txAwaitingLength = false;
+            txVariableLen = value;
+            packetDone = value == 0;
+        }
+        else
+        {
+            sentPackets.back().push_back(value);
+            ++txByteCount;
+            if(txVariable)
+            {
+                packetDone = txByteCount == txVariableLen;
+            }
+            else
+            {
+                // The chip's packet byte counter wraps at 256 and ends a fixed length
+                // packet when it matches PKT_LEN.  LENGTH_CONFIG is checked live, so a
+                // switch from infinite to fixed mid packet ends it at the right byte.
+                uint8_t pktLen = regs[static_cast<uint8_t>(CC1200::Register::PKT_LEN)];
+                packetDone = lengthConfig() == SIM_LENGTH_FIXED && (txByteCount & 0xFF) == pktLen;
+            }
+        }
+
+        if(packetDone)
+        {
+            txPacketActive = false;
+            afterTx();
+        }
+        return;
+    }
+
+    // RX
+    if(!rxPacketActive)
+    {
+        if(airRxQueue.empty())
+        {
+            return;
+        }
+
+        AirPacket const& packet = airRxQueue.front();
+        rxFrame.clear();
+        rxVariable = lengthConfig() == SIM_LENGTH_VARIABLE;
+        if(rxVariable)
+        {
+            rxFrame.push_back(static_cast<uint8_t>(packet.bytes.size()));
+        }
+        rxFrame.insert(rxFrame.end(), packet.bytes.begin(), packet.bytes.end());
+        rxPacketActive = true;
+        rxIndex = 0;
+        rxOverheadLeft = rxStreamSynced ? 0 : packetOverheadBytes;
+        return;
+    }
+
+    if(rxOverheadLeft > 0)
+    {
+        --rxOverheadLeft;
+        return;
+    }
+
+    // a fixed length packet longer than the injected payload is padded with zeros
+    uint8_t const value = rxIndex < rxFrame.size() ? rxFrame[rxIndex] : 0;
+    if(rxFifo.count == 0)
+    {
+        // the first byte into an empty RX FIFO is also latched in RXFIFO_PRE_BUF
+        extRegs[static_cast<uint8_t>(CC1200::ExtRegister::RXFIFO_PRE_BUF)] = value;
+    }
+    if(!rxFifo.push(value))
+    {
+        ++stats.rxOverflows;
+        enterState(State::RX_FIFO_ERROR);
+        return;
+    }
+    ++rxIndex;
+    ++stats.rxAirBytes;
+
+    if(rxVariable)
+    {
+        if(rxIndex < rxFrame.size())
+        {
+            return;
+        }
+    }
+    else if(lengthConfig() == SIM_LENGTH_FIXED)
+    {
+        // Like TX, the packet byte counter wraps at 256 and is compared with PKT_LEN
+        // live, so switching from infinite to fixed mid packet ends it at the right byte.
+        // The rest of a longer injected payload is lost.
+        uint8_t pktLen = regs[static_cast<uint8_t>(CC1200::Register::PKT_LEN)];
+        if((rxIndex & 0xFF) != pktLen)
+        {
+            return;
+        }
+    }
+    else
+    {
+        if(rxIndex < rxFrame.size())
+        {
+            return;
+        }
+
+        // the stream continues with the next queued chunk
+        airRxQueue.pop_front();
+        rxPacketActive = false;
+        rxStreamSynced = true;
+        return;
+    }
+
+    bool const crcOk = airRxQueue.front().crcOk;
+    airRxQueue.pop_front();
+    rxPacketActive = false;
+
+    lastCrcOk = crcOk;
+    if(regs[static_cast<uint8_t>(CC1200::Register::PKT_CFG1)] & (1 << PKT_CFG1_APPEND_STATUS))
+    {
+        if(!rxFifo.push(static_cast<uint8_t>(rssi >> 4)) ||
+           !rxFifo.push(static_cast<uint8_t>((crcOk ? 0x80 : 0) | lqi)))
+        {
+            ++stats.rxOverflows;
+            enterState(State::RX_FIFO_ERROR);
+            return;
+        }
+    }
+    afterRx();
+}
+
+void CC1200Sim::injectPacket(uint8_t const* data, size_t len, bool crcOk)
+{
+    airRxQueue.push_back({std::vector<uint8_t>(data, data + len), crcOk});
+}
+
+void CC1200Sim::setLinkQuality(int8_t rssiDbm, uint8_t lqiValue)
+{
+    rssi = static_cast<int16_t>(rssiDbm * 16);
+    lqi = lqiValue & 0x7F;
+}
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2019-2023 USC Rocket Propulsion Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CC1200_CC1200SIM_H
+#define CC1200_CC1200SIM_H
+
+#include "CC1200Bus.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/**
+ *  Behavioral model of the CC1200 SPI interface, for running the CC1200 driver on a host.
+ *
+ *  The model decodes the SPI protocol (register, extended register, strobe, FIFO and
+ *  direct memory accesses), keeps both register files and the 128 byte TX and RX FIFOs,
+ *  returns status bytes, and runs a MARC state machine with IDLE, RX, TX, FSTXON and the
+ *  two FIFO error states.  Packets move over the air at a configurable bit rate: TX
+ *  drains the TX FIFO and RX fills the RX FIFO from packets queued with injectPacket().
+ *  Fixed, variable and infinite packet length modes, APPEND_STATUS, RXOFF_MODE and
+ *  TXOFF_MODE are honoured.  Calibration, settling and the modem are not modeled.
+ *
+ *  Time is simulated.  It advances with every SPI byte at the configured SPI clock, a
+ *  fixed cost per chip select window, delays, and a small step on every timestamp read
+ *  so polling loops always make progress.  Background transfers complete immediately,
+ *  or after their bus time with setDeferredTransfers().
+ */
+class CC1200Sim : public CC1200Bus
+{
+public:
+    // SPI and air traffic counters
+    struct Stats
+    {
+        uint64_t transactions = 0;     // chip select windows
+        uint64_t spiBytes = 0;         // bytes clocked on the bus, headers included
+        uint64_t txAirBytes = 0;       // payload bytes (length byte included) sent over the air
+        uint64_t rxAirBytes = 0;       // payload bytes (length byte included) received from the air
+        uint64_t packetsSent = 0;
+        uint64_t packetsReceived = 0;
+        uint64_t txUnderflows = 0;
+        uint64_t txOverflows = 0;
+        uint64_t rxOverflows = 0;
+        uint64_t rxUnderflows = 0;
+        uint64_t busConflicts = 0;     // chip select or polled transfers while a background transfer runs
+    };
+
+    CC1200Sim();
+
+    /**
+     * Set the over-the-air bit rate
+     * @param bitsPerSecond Data rate, e.g. 100000 for 50ksps 4FSK
+     */
+    void setAirRate(uint32_t bitsPerSecond) { airRate = bitsPerSecond; }
+    uint32_t getAirRate() const { return airRate; }
+
+    /**
+     * Set the SPI clock used for both transaction classes
+     * @param hz SPI clock frequency
+     */
+    void setSPIClock(uint32_t hz) { spiClock = hz; }
+
+    /**
+     * Make background transfers take their bus time.  startTransfer() returns at once;
+     * the bytes move, and the completion is signalled, when simulated time reaches the
+     * end of the transfer, from whichever call moves it on, as an interrupt would.  Off
+     * by default: transfers complete inside startTransfer().
+     * @param deferred true to complete background transfers after their bus time
+     */
+    void setDeferredTransfers(bool deferred) { deferredTransfers = deferred; }
+
+    /**
+     * Set the fixed time charged for each chip select window, covering chip select setup
+     * and the driver's per-call overhead on the target
+     * @param ns Overhead in ns
+     */
+    void setTransactionOverhead(uint32_t ns) { transactionOverheadNs = ns; }
+
+    /**
+     * Set the bytes sent over the air around every packet: preamble, sync word and CRC
+     * @param bytes Overhead in bytes
+     */
+    void setPacketOverhead(uint32_t bytes) { packetOverheadBytes = bytes; }
+
+    /**
+     * Queue a packet to arrive over the air the next time the chip is in RX.  In
+     * variable length mode the length byte is added; in fixed length mode the payload
+     * is padded or cut to PKT_LEN; in infinite mode the bytes are appended to the stream.
+     * @param data Payload
+     * @param len Payload length
+     * @param crcOk CRC result reported in the appended status bytes
+     */
+    void injectPacket(uint8_t const* data, size_t len, bool crcOk = true);
+
+    /**
+     * Set the signal quality reported in the RSSI and LQI registers and status bytes
+     * @param rssiDbm RSSI in dBm
+     * @param lqi Link quality indicator (0-127)
+     */
+    void setLinkQuality(int8_t rssiDbm, uint8_t lqi);
+
+    /**
+     * Get the payloads sent over the air, in order, without the length byte
+     * @return Sent packets; in infinite mode a single growing packet
+     */
+    std::deque<std::vector<uint8_t>>& getSentPackets() { return sentPackets; }
+
+    /**
+     * @return Packets and stream bytes still waiting to be received
+     */
+    size_t getPendingRxPackets() const { return airRxQueue.size(); }
+
+    /**
+     * Get the FIFO fill levels without SPI traffic, e.g. to model the FIFO threshold
+     * GPIO interrupts
+     * @return Bytes in the FIFO
+     */
+    size_t getTxFifoCount() const { return txFifo.count; }
+    size_t getRxFifoCount() const { return rxFifo.count; }
+
+    Stats const& getStats() const { return stats; }
+    void resetStats() { stats = Stats(); }
+
+    /**
+     * @return Simulated time in ns
+     */
+    uint64_t getTimeNs() const { return now; }
+
+    /**
+     * Run the radio for a span of simulated time without any SPI traffic
+     * @param ns Time to advance
+     */
+    void advance(uint64_t ns);
+
+    // CC1200Bus implementation
+    void select(ClockClass clockClass) override;
+    void deselect() override;
+    bool transfer(uint8_t const* txData, uint8_t* rxData, size_t len) override;
+    bool writePaced(uint8_t const* data, size_t len, uint32_t gapNs) override;
+    bool startTransfer(uint8_t const* txData, uint8_t* rxData, size_t len) override;
+    // the model has no CPU time, so an interrupt driven transfer costs what DMA does
+    bool startTransferIT(uint8_t const* txData, uint8_t* rxData, size_t len) override { return startTransfer(txData, rxData, len); }
+    void abortTransfer() override { transferPending = false; }
+    uint32_t getClockFrequency(ClockClass /*clockClass*/) const override { return spiClock; }
+    void setReset(bool asserted) override;
+    void delayMs(uint32_t ms) override;
+    uint32_t getMillis() override;
+    uint32_t getTimestamp() override;
+    uint32_t getTimestampFrequency() const override { return 1000000; }
+
+private:
+    // status byte STATE field values
+    enum class State : uint8_t
+    {
+        IDLE = 0,
+        RX = 1,
+        TX = 2,
+        FSTXON = 3,
+        RX_FIFO_ERROR = 6,
+        TX_FIFO_ERROR = 7
+    };
+
+    // SPI decoder phase within a chip select window
+    enum class Phase
+    {
+        HEADER,
+        EXT_ADDRESS,
+        MEM_ADDRESS,
+        DATA
+    };
+
+    // what the data bytes of an access go to
+    enum class Target
+    {
+        REGISTER,
+        EXT_REGISTER,
+        MEMORY,
+        FIFO
+    };
+
+    // 128 byte FIFO with the chip's FIRST/LAST pointers, so direct memory access sees
+    // the same layout as the hardware
+    struct Fifo
+    {
+        uint8_t ram[128] = {};
+        uint8_t first = 0;
+        uint8_t last = 0;
+        size_t count = 0;
+
+        void flush() { first = last = 0; count = 0; }
+        bool push(uint8_t value);
+        bool pop(uint8_t& value);
+    };
+
+    // configuration
+    bool deferredTransfers = false;
+    uint32_t airRate = 100000;
+    uint32_t spiClock = 6000000;
+    uint32_t transactionOverheadNs = 1000;
+    uint32_t packetOverheadBytes = 10;
+
+    // registers and FIFOs
+    uint8_t regs[0x2F] = {};
+    uint8_t extRegs[0x100] = {};
+    Fifo txFifo;
+    Fifo rxFifo;
+
+    // chip state
+    State state = State::IDLE;
+    bool inReset = false;
+    uint64_t readyAt = 0;
+    int16_t rssi = -60 * 16; // 1/16 dBm
+    uint8_t lqi = 100;
+
+    // SPI decoder
+    bool selected = false;
+    Phase phase = Phase::HEADER;
+    Target target = Target::REGISTER;
+    bool readAccess = false;
+    bool burst = false;
+    uint8_t address = 0;
+
+    // air interface.  airTime is the simulated time up to which the radio has run.
+    uint64_t now = 0;
+    uint64_t airTime = 0;
+    bool txPacketActive = false;
+    uint32_t txOverheadLeft = 0;        // air byte times left of preamble/sync/CRC
+    bool txVariable = false;            // the current TX packet has a length byte
+    bool txAwaitingLength = false;      // variable length: next FIFO byte is the length
+    size_t txVariableLen = 0;           // variable length: payload length from the length byte
+    size_t txByteCount = 0;             // payload bytes sent of the current TX packet
+    struct AirPacket
+    {
+        std::vector<uint8_t> bytes;
+        bool crcOk;
+    };
+    std::deque<AirPacket> airRxQueue;
+    bool rxPacketActive = false;
+    bool rxStreamSynced = false;        // infinite mode: sync found, chunks run back to back
+    uint32_t rxOverheadLeft = 0;
+    bool rxVariable = false;            // the current RX packet has a length byte
+    std::vector<uint8_t> rxFrame;       // bytes of the packet being received, as framed on air
+    size_t rxIndex = 0;
+    bool lastCrcOk = true;
+    std::deque<std::vector<uint8_t>> sentPackets;
+
+    // background transfer in flight, in deferred mode
+    bool transferPending = false;
+    bool completingTransfer = false;
+    uint8_t const* pendingTxData = nullptr;
+    uint8_t* pendingRxData = nullptr;
+    size_t pendingLen = 0;
+    uint64_t transferDoneAt = 0;
+
+    Stats stats;
+
+    void chipReset();
+    uint8_t statusByte() const;
+    uint8_t spiByte(uint8_t mosi);
+    void strobe(uint8_t command);
+    uint8_t readExtRegister(uint8_t address);
+    uint8_t lengthConfig() const;
+    void enterState(State newState);
+    void afterTx();
+    void afterRx();
+    void runAir();
+    void airByte();
+    void spend(uint64_t ns);
+    void exchange(uint8_t const* txData, uint8_t* rxData, size_t len);
+    void finishTransfer();
+};
+
+#endif //CC1200_CC1200SIM_H
@@ -0,0 +1,859 @@
+/*
+ * Copyright (c) 2019-2023 USC Rocket Propulsion Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host benchmark of the CC1200 driver's data paths against the CC1200Sim chip model.
+// For each path it reports SPI bytes per payload byte, transactions per packet, and
+// any FIFO errors the chip model saw.  See Host/README.md for how to build it.
+
+#include "CC1200_HAL.h"
+#include "CC1200Bits.h"
+#include "CC1200Sim.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Packet payload length and count for the packet paths
+#define BENCH_PACKET_LEN 60
+#define BENCH_PACKET_COUNT 200
+
+// Bytes moved by the stream paths, and the chunk counted as one packet for them
+#define BENCH_STREAM_BYTES 16384
+#define BENCH_STREAM_CHUNK 64
+
+// Size of the chip's TX and RX FIFOs
+#define BENCH_FIFO_SIZE 128
+
+// Period at which the streaming task calls processContinuousStreaming() on the target
+#define BENCH_STREAM_TASK_PERIOD_MS 5
+
+// Period of a fast streaming task, which calls again while its transfers are on the wire
+#define BENCH_FAST_TASK_PERIOD_US 50
+
+// Period at which a packet receive task calls drainReceivedPackets()
+#define BENCH_RX_POLL_PERIOD_MS 5
+
+// Interval at which the benchmark samples the FIFO threshold and packet GPIO lines it waits on
+#define BENCH_GPIO_SAMPLE_NS 20000
+
+// Air rate of the high rate framed stream TX path, whatever rate the others run at
+#define BENCH_HIGH_AIR_RATE 1000000
+
+// Bytes the high rate path sends first, so the driver has timed a FIFO service and
+// picks its threshold from the measurement
+#define BENCH_WARMUP_BYTES 1024
+
+// FIFO level at which the long packet RX path is drained.  The path receives one packet of
+// each length from BENCH_LONG_RX_MIN_LEN to CC1200_LONG_RX_MAX_LEN, so every remaining
+// payload length, 256 and 257 bytes included, lands on a drain for one of them.
+#define BENCH_LONG_RX_DRAIN_LEVEL 64
+#define BENCH_LONG_RX_MIN_LEN 257
+
+// Give up on a path after this much simulated time
+#define BENCH_TIMEOUT_MS 60000
+
+// PKT_CFG0 LENGTH_CONFIG value for infinite packet length mode
+#define BENCH_LENGTH_INFINITE 2
+
+// Shortest FIFO transfer that goes by DMA or the SPI interrupt when the command line
+// forces one of them
+#define BENCH_FORCED_MIN_LEN 8
+
+// FIFO transfer method forced from the command line.  CALIBRATED keeps what the driver's
+// calibration picked, which is polled SPI on the model.
+enum class ForcedMethod
+{
+    CALIBRATED,
+    DMA,
+    INTERRUPT
+};
+
+static ForcedMethod forcedMethod = ForcedMethod::CALIBRATED;
+
+struct BenchResult
+{
+    char const* name;
+    size_t payloadBytes;
+    size_t packets;
+    bool complete;
+
+    // continuous streaming paths only
+    uint64_t taskNs;            // simulated time spent in processContinuousStreaming()
+    uint64_t taskMaxNs;         // longest call
+    size_t taskCalls;
+    uint32_t bytesPerSecond;    // from getStreamingThroughput()
+    uint32_t droppedBytes;
+
+    // polled paths only: SPI traffic of the driver calls that moved data, so the bench's own
+    // polling (state waits, calls that found nothing to move) stays out of the SPI columns
+    bool pathOnly;
+    uint64_t pathSpiBytes;
+    uint64_t pathTransactions;
+};
+
+static void printHeader()
+{
+    std::printf("%-28s %9s %8s %10s %9s %10s %9s %s\n",
+                "path", "payload", "packets", "SPI bytes", "SPI/byte", "txns", "txns/pkt", "FIFO errors");
+}
+
+static void printResult(BenchResult const& result, CC1200Sim const& sim)
+{
+    CC1200Sim::Stats const& stats = sim.getStats();
+    uint64_t const spiBytes = result.pathOnly ? result.pathSpiBytes : stats.spiBytes;
+    uint64_t const transactions = result.pathOnly ? result.pathTransactions : stats.transactions;
+    double const payload = result.payloadBytes > 0 ? static_cast<double>(result.payloadBytes) : 1.0;
+    double const packets = result.packets > 0 ? static_cast<double>(result.packets) : 1.0;
+    std::printf("%-28s %9zu %8zu %10llu %9.2f %10llu %9.1f txu=%llu txo=%llu rxo=%llu rxu=%llu%s\n",
+                result.name, result.payloadBytes, result.packets,
+                static_cast<unsigned long long>(spiBytes), spiBytes / payload,
+                static_cast<unsigned long long>(transactions), transactions / packets,
+                static_cast<unsigned long long>(stats.txUnderflows), static_cast<unsigned long long>(stats.txOverflows),
+                static_cast<unsigned long long>(stats.rxOverflows), static_cast<unsigned long long>(stats.rxUnderflows),
+                result.complete ? "" : "  (incomplete)");
+    if(result.taskCalls > 0)
+    {
+        std::printf("%-28s %lu B/s, %.1f us per call, %.1f us longest, %lu bytes dropped\n", "",
+                    static_cast<unsigned long>(result.bytesPerSecond), result.taskNs / 1000.0 / result.taskCalls,
+                    result.taskMaxNs / 1000.0, static_cast<unsigned long>(result.droppedBytes));
+    }
+    if(stats.busConflicts > 0)
+    {
+        std::printf("%-28s %llu bus accesses during a background transfer\n", "",
+                    static_cast<unsigned long long>(stats.busConflicts));
+    }
+}
+
+// helper function: add the SPI traffic since a snapshot to the data path counts
+static void countPath(BenchResult& result, CC1200Sim const& sim, CC1200Sim::Stats const& before)
+{
+    CC1200Sim::Stats const& stats = sim.getStats();
+    result.pathOnly = true;
+    result.pathSpiBytes += stats.spiBytes - before.spiBytes;
+    result.pathTransactions += stats.transactions - before.transactions;
+}
+
+// helper function: deterministic test payload
+static std::vector<uint8_t> makePayload(size_t len, uint8_t seed)
+{
+    std::vector<uint8_t> payload(len);
+    for(size_t i = 0; i < len; ++i)
+    {
+        payload[i] = static_cast<uint8_t>(seed + i * 7);
+    }
+    return payload;
+}
+
+// helper function: bring up the driver and switch to infinite packet length mode if asked
+static bool startRadio(CC1200& radio, CC1200Sim& sim, bool infinite)
+{
+    if(!radio.begin())
+    {
+        return false;
+    }
+    // a forced background method runs with deferred transfers, so the waits for them are
+    // exercised too
+    if(forcedMethod == ForcedMethod::DMA)
+    {
+        radio.setDMAMinLen(BENCH_FORCED_MIN_LEN);
+        sim.setDeferredTransfers(true);
+    }
+    else if(forcedMethod == ForcedMethod::INTERRUPT)
+    {
+        radio.setDMAMinLen(SIZE_MAX);
+        radio.setITMinLen(BENCH_FORCED_MIN_LEN);
+        sim.setDeferredTransfers(true);
+    }
+    // match the 4FSK symbol rate to the simulated air rate; the driver picks its FIFO
+    // threshold from it
+    radio.setSymbolRate(sim.getAirRate() / 2.0f);
+    if(infinite)
+    {
+        uint8_t pktCfg0 = radio.readRegister(CC1200::Register::PKT_CFG0);
+        pktCfg0 &= ~(0b11 << PKT_CFG0_LENGTH_CONFIG);
+        pktCfg0 |= BENCH_LENGTH_INFINITE << PKT_CFG0_LENGTH_CONFIG;
+        radio.writeRegister(CC1200::Register::PKT_CFG0, pktCfg0);
+    }
+    sim.resetStats();
+    return true;
+}
+
+static bool timedOut(CC1200Sim const& sim, uint64_t startNs)
+{
+    return sim.getTimeNs() - startNs > static_cast<uint64_t>(BENCH_TIMEOUT_MS) * 1000000;
+}
+
+static BenchResult benchEnqueuePacket(CC1200& radio, CC1200Sim& sim)
+{
+    BenchResult result = {"enqueuePacket", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0};
+    startRadio(radio, sim, false);
+    uint64_t const start = sim.getTimeNs();
+
+    std::vector<uint8_t> payload = makePayload(BENCH_PACKET_LEN, 1);
+    while(result.packets < BENCH_PACKET_COUNT && !timedOut(sim, start))
+    {
+        CC1200Sim::Stats const before = sim.getStats();
+        if(!radio.enqueuePacket(reinterpret_cast<char const*>(payload.data()), payload.size()))
+        {
+            radio.updateState();
+            continue;
+        }
+        radio.sendCommand(CC1200::Command::TX);
+        countPath(result, sim, before);
+        radio.waitForState(CC1200::State::IDLE, 100000);
+        ++result.packets;
+        result.payloadBytes += payload.size();
+    }
+
+    result.complete = result.packets == BENCH_PACKET_COUNT && sim.getSentPackets().size() == BENCH_PACKET_COUNT;
+    return result;
+}
+
+static BenchResult benchReceivePacket(CC1200& radio, CC1200Sim& sim)
+{
+    BenchResult result = {"receivePacket", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0};
+    startRadio(radio, sim, false);
+    uint64_t const start = sim.getTimeNs();
+
+    std::vector<uint8_t> payload = makePayload(BENCH_PACKET_LEN, 2);
+    for(size_t i = 0; i < BENCH_PACKET_COUNT; ++i)
+    {
+        sim.injectPacket(payload.data(), payload.size());
+    }
+
+    // the default profile stays in RX between packets
+    char buffer[256];
+    radio.sendCommand(CC1200::Command::RX);
+    while(result.packets < BENCH_PACKET_COUNT && !timedOut(sim, start))
+    {
+        // wait for the end of a packet, as a task woken by the packet received GPIO would
+        if(sim.getStats().packetsReceived <= result.packets)
+        {
+            sim.advance(BENCH_GPIO_SAMPLE_NS);
+            continue;
+        }
+        CC1200Sim::Stats const before = sim.getStats();
+        if(!radio.hasReceivedPacket())
+        {
+            continue;
+        }
+        size_t len = radio.receivePacket(buffer, sizeof(buffer));
+        if(len > 0)
+        {
+            countPath(result, sim, before);
+            ++result.packets;
+            result.payloadBytes += len;
+        }
+    }
+
+    result.complete = result.packets == BENCH_PACKET_COUNT;
+    return result;
+}
+
+static BenchResult benchDrainReceivedPackets(CC1200& radio, CC1200Sim& sim)
+{
+    BenchResult result = {"drainReceivedPackets", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0};
+    startRadio(radio, sim, false);
+    uint64_t const start = sim.getTimeNs();
+
+    std::vector<uint8_t> payload = makePayload(BENCH_PACKET_LEN, 7);
+    for(size_t i = 0; i < BENCH_PACKET_COUNT; ++i)
+    {
+        sim.injectPacket(payload.data(), payload.size());
+    }
+
+    // A task polling for packets, each pass taking everything that arrived meanwhile.  At
+    // high air rates it has to poll before half the FIFO fills.
+    uint64_t pollNs = static_cast<uint64_t>(BENCH_RX_POLL_PERIOD_MS) * 1000000;
+    uint64_t const halfFifoNs = 64ULL * 8 * 1000000000 / sim.getAirRate();
+    if(pollNs > halfFifoNs)
+    {
+        pollNs = halfFifoNs;
+    }
+
+    radio.sendCommand(CC1200::Command::RX);
+    while(result.packets < BENCH_PACKET_COUNT && !timedOut(sim, start))
+    {
+        CC1200Sim::Stats const before = sim.getStats();
+        size_t const drained = radio.drainReceivedPackets([&result](CC1200::PacketDescriptor const& packet) {
+            result.payloadBytes += packet.length;
+        });
+        if(drained > 0)
+        {
+            countPath(result, sim, before);
+            result.packets += drained;
+        }
+        sim.advance(pollNs);
+    }
+
+    result.complete = result.packets == BENCH_PACKET_COUNT && sim.getStats().rxOverflows == 0;
+    return result;
+}
+
+static BenchResult benchRxPool(CC1200& radio, CC1200Sim& sim)
+{
+    BenchResult result = {"RX pool", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0};
+    startRadio(radio, sim, false);
+    uint64_t const start = sim.getTimeNs();
+
+    std::vector<uint8_t> payload = makePayload(BENCH_PACKET_LEN, 8);
+    for(size_t i = 0; i < BENCH_PACKET_COUNT; ++i)
+    {
+        sim.injectPacket(payload.data(), payload.size());
+    }
+
+    // same polling as the drainReceivedPackets() task, with each packet handed on and
+    // released by its consumer
+    uint64_t pollNs = static_cast<uint64_t>(BENCH_RX_POLL_PERIOD_MS) * 1000000;
+    uint64_t const halfFifoNs = 64ULL * 8 * 1000000000 / sim.getAirRate();
+    if(pollNs > halfFifoNs)
+    {
+        pollNs = halfFifoNs;
+    }
+
+    bool intact = true;
+    radio.sendCommand(CC1200::Command::RX);
+    while(result.packets < BENCH_PACKET_COUNT && !timedOut(sim, start))
+    {
+        CC1200Sim::Stats const before = sim.getStats();
+        if(radio.drainToRxPool() > 0)
+        {
+            countPath(result, sim, before);
+        }
+        while(CC1200::RxPoolPacket* packet = radio.acquireRxPoolPacket())
+        {
+            intact = intact && packet->packet.length == payload.size() &&
+                     std::equal(payload.begin(), payload.end(), packet->packet.data);
+            ++result.packets;
+            result.payloadBytes += packet->packet.length;
+            radio.releaseRxPoolPacket(packet);
+        }
+        sim.advance(pollNs);
+    }
+
+    result.complete = intact && result.packets == BENCH_PACKET_COUNT && sim.getStats().rxOverflows == 0;
+    return result;
+}
+
+static BenchResult benchWriteStream(CC1200& radio, CC1200Sim& sim)
+{
+    BenchResult result = {"writeStream", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0};
+    startRadio(radio, sim, true);
+    uint64_t const start = sim.getTimeNs();
+
+    std::vector<uint8_t> payload = makePayload(BENCH_STREAM_BYTES, 3);
+    radio.sendCommand(CC1200::Command::TX);
+    while(result.payloadBytes < payload.size() && !timedOut(sim, start))
+    {
+        size_t chunk = payload.size() - result.payloadBytes;
+        if(chunk > BENCH_STREAM_CHUNK)
+        {
+            chunk = BENCH_STREAM_CHUNK;
+        }
+        // wait for room for the whole chunk, as a task woken at the FIFO threshold would
+        if(BENCH_FIFO_SIZE - sim.getTxFifoCount() < chunk)
+        {
+            sim.advance(BENCH_GPIO_SAMPLE_NS);
+            continue;
+        }
+        CC1200Sim::Stats const before = sim.getStats();
+        size_t const written = radio.writeStream(reinterpret_cast<char const*>(payload.data()) + result.payloadBytes, chunk);
+        if(written > 0)
+        {
+            countPath(result, sim, before);
+            result.payloadBytes += written;
+        }
+    }
+
+    result.packets = result.payloadBytes / BENCH_STREAM_CHUNK;
+    result.complete = result.payloadBytes == payload.size();
+    return result;
+}
+
+static BenchResult benchReadStream(CC1200& radio, CC1200Sim& sim)
+{
+    BenchResult result = {"readStream", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0};
+    startRadio(radio, sim, true);
+    uint64_t const start = sim.getTimeNs();
+
+    std::vector<uint8_t> payload = makePayload(BENCH_STREAM_BYTES, 4);
+    for(size_t offset = 0; offset < payload.size(); offset += BENCH_STREAM_CHUNK)
+    {
+        sim.injectPacket(payload.data() + offset, BENCH_STREAM_CHUNK);
+    }
+
+    char buffer[BENCH_STREAM_CHUNK];
+    radio.sendCommand(CC1200::Command::RX);
+    while(result.payloadBytes < payload.size() && !timedOut(sim, start))
+    {
+        // wait for a whole chunk, as a task woken at the FIFO threshold would
+        if(sim.getRxFifoCount() < sizeof(buffer))
+        {
+            sim.advance(BENCH_GPIO_SAMPLE_NS);
+            continue;
+        }
+        CC1200Sim::Stats const before = sim.getStats();
+        size_t const read = radio.readStream(buffer, sizeof(buffer));
+        if(read > 0)
+        {
+            countPath(result, sim, before);
+            result.payloadBytes += read;
+        }
+    }
+
+    result.packets = result.payloadBytes / BENCH_STREAM_CHUNK;
+    result.complete = result.payloadBytes == payload.size();
+    return result;
+}
+
+// Fixed length packets over 256 bytes with status appended, each received with
+// startLongPacketRx().  The driver switches from infinite to fixed length when fewer than
+// 256 payload bytes are left; switching a lap early or late ends the packet at the wrong
+// byte.
+static BenchResult benchLongPacketRx(CC1200& radio, CC1200Sim& sim)
+{
+    BenchResult result = {"long packet RX", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0};
+    startRadio(radio, sim, false);
+    uint8_t const pktCfg1 = radio.readRegister(CC1200::Register::PKT_CFG1);
+    radio.writeRegister(CC1200::Register::PKT_CFG1, pktCfg1 | (1 << PKT_CFG1_APPEND_STATUS));
+    sim.resetStats();
+    uint64_t const start = sim.getTimeNs();
+    uint64_t const byteNs = 8000000000ULL / sim.getAirRate();
+
+    bool intact = true;
+    for(size_t len = BENCH_LONG_RX_MIN_LEN; len <= CC1200_LONG_RX_MAX_LEN && intact && !timedOut(sim, start); ++len)
+    {
+        std::vector<uint8_t> payload = makePayload(len, 9);
+        if(!radio.startLongPacketRx(len))
+        {
+            break;
+        }
+        sim.injectPacket(payload.data(), payload.size());
+
+        // the FIFO threshold and end of packet interrupts, at byte resolution so the
+        // drains land at the same FIFO level every time
+        uint64_t const packetsBefore = sim.getStats().packetsReceived;
+        CC1200::LongRxPacket const* packet = nullptr;
+        while(packet == nullptr && !timedOut(sim, start))
+        {
+            sim.advance(byteNs);
+            if(sim.getRxFifoCount() >= BENCH_LONG_RX_DRAIN_LEVEL)
+            {
+                radio.rxFifoThresholdCallback();
+            }
+            if(sim.getStats().packetsReceived != packetsBefore)
+            {
+                radio.packetEndCallback();
+            }
+            packet = radio.peekLongRxPacket();
+        }
+        intact = packet != nullptr && packet->length == len && packet->crcOk &&
+                 std::equal(payload.begin(), payload.end(), packet->data);
+        if(packet != nullptr)
+        {
+            radio.releaseLongRxPacket();
+        }
+        radio.stopLongPacketRx();
+        if(intact)
+        {
+            ++result.packets;
+            result.payloadBytes += len;
+        }
+    }
+
+    result.complete = intact && result.packets == CC1200_LONG_RX_MAX_LEN - BENCH_LONG_RX_MIN_LEN + 1;
+    return result;
+}
+
+// helper function: stream the 32 byte pattern until BENCH_STREAM_BYTES have gone over the
+// air, timing each processContinuousStreaming() call
+static BenchResult runContinuousTx(CC1200& radio, CC1200Sim& sim, BenchResult result, uint32_t periodUs)
+{
+    startRadio(radio, sim, true);
+    uint64_t const start = sim.getTimeNs();
+
+    std::vector<uint8_t> pattern = makePayload(32, 5);
+    radio.startContinuousStreamingTx(reinterpret_cast<char const*>(pattern.data()), pattern.size());
+    radio.sendCommand(CC1200::Command::TX);
+    // an underflow leaves the chip in TX_FIFO_ERROR until the next call recovers it
+    while(sim.getStats().txAirBytes < BENCH_STREAM_BYTES && !timedOut(sim, start))
+    {
+        uint64_t const callStart = sim.getTimeNs();
+        radio.processContinuousStreaming();
+        result.taskNs += sim.getTimeNs() - callStart;
+        result.taskMaxNs = std::max<uint64_t>(result.taskMaxNs, sim.getTimeNs() - callStart);
+        ++result.taskCalls;
+        sim.advance(static_cast<uint64_t>(periodUs) * 1000);
+    }
+    radio.stopContinuousStreamingTx();
+    result.bytesPerSecond = radio.getStreamingThroughput().txBytesPerSecond;
+
+    result.payloadBytes = sim.getStats().txAirBytes;
+    result.packets = result.payloadBytes / BENCH_STREAM_CHUNK;
+    result.complete = result.payloadBytes >= BENCH_STREAM_BYTES;
+    return result;
+}
+
+// helper function: receive BENCH_STREAM_BYTES, handing each filled buffer straight back and
+// timing each processContinuousStreaming() call
+static BenchResult runContinuousRx(CC1200& radio, CC1200Sim& sim, BenchResult result, uint32_t periodUs)
+{
+    startRadio(radio, sim, true);
+    uint64_t const start = sim.getTimeNs();
+
+    std::vector<uint8_t> payload = makePayload(BENCH_STREAM_BYTES, 6);
+    for(size_t offset = 0; offset < payload.size(); offset += BENCH_STREAM_CHUNK)
+    {
+        sim.injectPacket(payload.data() + offset, BENCH_STREAM_CHUNK);
+    }
+
+    radio.startContinuousStreamingRx(false);
+    radio.sendCommand(CC1200::Command::RX);
+    // the FIFO level comes from the model, so the loop adds no SPI traffic of its own
+    while((sim.getPendingRxPackets() > 0 || sim.getRxFifoCount() > 0) && !timedOut(sim, start))
+    {
+        uint64_t const callStart = sim.getTimeNs();
+        radio.processContinuousStreaming();
+        result.taskNs += sim.getTimeNs() - callStart;
+        result.taskMaxNs = std::max<uint64_t>(result.taskMaxNs, sim.getTimeNs() - callStart);
+        ++result.taskCalls;
+
+        size_t len;
+        while(radio.acquireStreamingRxBuffer(len) != nullptr)
+        {
+            result.payloadBytes += len;
+            radio.releaseStreamingRxBuffer();
+        }
+        sim.advance(static_cast<uint64_t>(periodUs) * 1000);
+    }
+    radio.stopContinuousStreamingRx();
+
+    // reads still in flight at the end have landed now
+    size_t len;
+    while(radio.acquireStreamingRxBuffer(len) != nullptr)
+    {
+        result.payloadBytes += len;
+        radio.releaseStreamingRxBuffer();
+    }
+    CC1200::StreamingThroughput const throughput = radio.getStreamingThroughput();
+    result.bytesPerSecond = throughput.rxBytesPerSecond;
+    result.droppedBytes = throughput.rxDroppedBytes;
+
+    result.packets = result.payloadBytes / BENCH_STREAM_CHUNK;
+    result.complete = sim.getPendingRxPackets() == 0;
+    return result;
+}
+
+static BenchResult benchContinuousTx(CC1200& radio, CC1200Sim& sim)
+{
+    return runContinuousTx(radio, sim, {"processContinuousStreaming TX", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0},
+                           BENCH_STREAM_TASK_PERIOD_MS * 1000);
+}
+
+static BenchResult benchContinuousRx(CC1200& radio, CC1200Sim& sim)
+{
+    return runContinuousRx(radio, sim, {"processContinuousStreaming RX", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0},
+                           BENCH_STREAM_TASK_PERIOD_MS * 1000);
+}
+
+// The deferred rows let each background transfer take its bus time, as DMA does on the
+// target, so the number of staging buffers decides how much one call can queue.
+
+static BenchResult benchContinuousTxOneBuffer(CC1200& radio, CC1200Sim& sim)
+{
+    sim.setDeferredTransfers(true);
+    radio.setStreamingDMABuffers(1);
+    return runContinuousTx(radio, sim, {"continuous TX, 1 buffer", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0},
+                           BENCH_STREAM_TASK_PERIOD_MS * 1000);
+}
+
+static BenchResult benchContinuousTxBuffers(CC1200& radio, CC1200Sim& sim)
+{
+    sim.setDeferredTransfers(true);
+    radio.setStreamingDMABuffers(CC1200_STREAMING_DMA_BUFFERS);
+    return runContinuousTx(radio, sim, {"continuous TX, all buffers", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0},
+                           BENCH_STREAM_TASK_PERIOD_MS * 1000);
+}
+
+static BenchResult benchContinuousTxFastTask(CC1200& radio, CC1200Sim& sim)
+{
+    sim.setDeferredTransfers(true);
+    return runContinuousTx(radio, sim, {"continuous TX, 50 us task", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0},
+                           BENCH_FAST_TASK_PERIOD_US);
+}
+
+static BenchResult benchContinuousRxOneBuffer(CC1200& radio, CC1200Sim& sim)
+{
+    sim.setDeferredTransfers(true);
+    radio.setStreamingDMABuffers(1);
+    return runContinuousRx(radio, sim, {"continuous RX, 1 buffer", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0},
+                           BENCH_STREAM_TASK_PERIOD_MS * 1000);
+}
+
+static BenchResult benchContinuousRxBuffers(CC1200& radio, CC1200Sim& sim)
+{
+    sim.setDeferredTransfers(true);
+    radio.setStreamingDMABuffers(CC1200_STREAMING_DMA_BUFFERS);
+    return runContinuousRx(radio, sim, {"continuous RX, all buffers", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0},
+                           BENCH_STREAM_TASK_PERIOD_MS * 1000);
+}
+
+// helper function: run the radio for a span of time, raising the FIFO threshold interrupts
+// the way the CC1200 GPIOs would
+static void runWithInterrupts(CC1200& radio, CC1200Sim& sim, uint64_t ns)
+{
+    // FIFO levels at which the threshold lines fire for the FIFO_THR the driver chose
+    size_t const txRefillLevel = 127 - radio.getFifoThreshold();
+    size_t const rxDrainLevel = radio.getFifoThreshold();
+
+    for(uint64_t elapsed = 0; elapsed < ns; elapsed += BENCH_GPIO_SAMPLE_NS)
+    {
+        bool const txFifoWasLow = sim.getTxFifoCount() < txRefillLevel;
+        uint64_t const packetsSent = sim.getStats().packetsSent;
+        sim.advance(BENCH_GPIO_SAMPLE_NS);
+        if(radio.isFramedStreamTxActive() && sim.getTxFifoCount() < txRefillLevel)
+        {
+            radio.txFifoThresholdCallback();
+        }
+        if(radio.isFramedStreamRxActive() && sim.getRxFifoCount() > rxDrainLevel)
+        {
+            radio.rxFifoThresholdCallback();
+        }
+
+        // the TX queue counts on the lines only interrupting on an edge
+        if(radio.isTxQueueActive())
+        {
+            if(!txFifoWasLow && sim.getTxFifoCount() < txRefillLevel)
+            {
+                radio.txFifoThresholdCallback();
+            }
+            if(sim.getStats().packetsSent != packetsSent)
+            {
+                radio.packetEndCallback();
+            }
+        }
+    }
+}
+
+static BenchResult benchTxQueue(CC1200& radio, CC1200Sim& sim)
+{
+    BenchResult result = {"TX queue", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0};
+    startRadio(radio, sim, false);
+    uint64_t const start = sim.getTimeNs();
+
+    // a task with a backlog, queueing whatever fits each time it runs
+    std::vector<uint8_t> payload = makePayload(BENCH_PACKET_LEN, 8);
+    radio.startTxQueue();
+    while(result.packets < BENCH_PACKET_COUNT && !timedOut(sim, start))
+    {
+        while(result.packets < BENCH_PACKET_COUNT && radio.queuePacket(payload.data(), payload.size()))
+        {
+            ++result.packets;
+            result.payloadBytes += payload.size();
+        }
+        runWithInterrupts(radio, sim, static_cast<uint64_t>(BENCH_STREAM_TASK_PERIOD_MS) * 1000000);
+        radio.pollTxQueue();
+    }
+    while(radio.getTxQueueFree() < CC1200_TX_QUEUE_LEN && !timedOut(sim, start))
+    {
+        runWithInterrupts(radio, sim, static_cast<uint64_t>(BENCH_STREAM_TASK_PERIOD_MS) * 1000000);
+    }
+    bool const drained = radio.stopTxQueue(BENCH_TIMEOUT_MS);
+
+    result.complete = drained && sim.getSentPackets().size() == BENCH_PACKET_COUNT && radio.getTxQueueUnderflows() == 0;
+    return result;
+}
+
+// helper function: send a payload as a framed stream, the way a task with a backlog
+// would, and drain it.  Returns false if it didn't all go out, or the driver had to
+// restart the transmission after an underflow.
+static bool sendFramedStream(CC1200& radio, CC1200Sim& sim, std::vector<uint8_t> const& payload, size_t& sent)
+{
+    uint64_t const start = sim.getTimeNs();
+    sent = 0;
+    radio.startFramedStreamTx();
+    while(sent < payload.size() && !timedOut(sim, start))
+    {
+        sent += radio.framedStreamWrite(payload.data() + sent, payload.size() - sent);
+        runWithInterrupts(radio, sim, static_cast<uint64_t>(BENCH_STREAM_TASK_PERIOD_MS) * 1000000);
+        radio.pollFramedStream();
+    }
+    while(radio.getFramedStreamTxFree() < CC1200_STREAM_RING_LEN && !timedOut(sim, start))
+    {
+        runWithInterrupts(radio, sim, static_cast<uint64_t>(BENCH_STREAM_TASK_PERIOD_MS) * 1000000);
+    }
+    bool const drained = radio.stopFramedStreamTx(BENCH_TIMEOUT_MS);
+    return sent == payload.size() && drained && radio.getFramedStreamStats().txUnderflows == 0;
+}
+
+static BenchResult benchFramedStreamTx(CC1200& radio, CC1200Sim& sim)
+{
+    BenchResult result = {"framed stream TX", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0};
+    startRadio(radio, sim, false);
+
+    std::vector<uint8_t> payload = makePayload(BENCH_STREAM_BYTES, 7);
+    result.complete = sendFramedStream(radio, sim, payload, result.payloadBytes);
+    CC1200::FramedStreamStats const stats = radio.getFramedStreamStats();
+    result.packets = stats.txFrames - stats.txIdleFrames;
+    return result;
+}
+
+static BenchResult benchFramedStreamTxHighRate(CC1200& radio, CC1200Sim& sim)
+{
+    BenchResult result = {"framed stream TX 1 Mbps", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0};
+    sim.setAirRate(BENCH_HIGH_AIR_RATE);
+    startRadio(radio, sim, false);
+
+    size_t sent;
+    bool const warmedUp = sendFramedStream(radio, sim, makePayload(BENCH_WARMUP_BYTES, 9), sent);
+    sim.resetStats();
+
+    std::vector<uint8_t> payload = makePayload(BENCH_STREAM_BYTES, 7);
+    result.complete = sendFramedStream(radio, sim, payload, result.payloadBytes) && warmedUp;
+    CC1200::FramedStreamStats const stats = radio.getFramedStreamStats();
+    result.packets = stats.txFrames - stats.txIdleFrames;
+    return result;
+}
+
+static BenchResult benchFramedStreamRx(CC1200& radio, CC1200Sim& sim)
+{
+    BenchResult result = {"framed stream RX", 0, 0, false, 0, 0, 0, 0, 0, false, 0, 0};
+
+    // frames as the transmitter would send them, back to back
+    std::vector<uint8_t> payload = makePayload(BENCH_STREAM_BYTES, 8);
+    std::vector<uint8_t> air;
+    {
+        CC1200Sim txSim;
+        CC1200 txRadio(txSim, [](std::string const&) {});
+        startRadio(txRadio, txSim, false);
+        txRadio.startFramedStreamTx();
+        size_t queued = 0;
+        while(txRadio.getFramedStreamTxFree() < CC1200_STREAM_RING_LEN || queued < payload.size())
+        {
+            queued += txRadio.framedStreamWrite(payload.data() + queued, payload.size() - queued);
+            runWithInterrupts(txRadio, txSim, static_cast<uint64_t>(BENCH_STREAM_TASK_PERIOD_MS) * 1000000);
+        }
+        txRadio.stopFramedStreamTx(BENCH_TIMEOUT_MS);
+        air = txSim.getSentPackets().back();
+    }
+
+    startRadio(radio, sim, false);
+    uint64_t const start = sim.getTimeNs();
+    for(size_t offset = 0; offset < air.size(); offset += BENCH_STREAM_CHUNK)
+    {
+        size_t const len = air.size() - offset < BENCH_STREAM_CHUNK ? air.size() - offset : BENCH_STREAM_CHUNK;
+        sim.injectPacket(air.data() + offset, len);
+    }
+
+    std::vector<uint8_t> received;
+    uint8_t buffer[BENCH_STREAM_CHUNK];
+    radio.startFramedStreamRx();
+    while(received.size() < payload.size() && !timedOut(sim, start))
+    {
+        runWithInterrupts(radio, sim, static_cast<uint64_t>(BENCH_STREAM_TASK_PERIOD_MS) * 1000000);
+        radio.pollFramedStream();
+        size_t len;
+        while((len = radio.framedStreamRead(buffer, sizeof(buffer))) > 0)
+        {
+            received.insert(received.end(), buffer, buffer + len);
+        }
+    }
+    CC1200::FramedStreamStats const stats = radio.getFramedStreamStats();
+    radio.stopFramedStreamRx();
+
+    result.payloadBytes = received.size();
+    result.packets = stats.rxFrames - stats.rxIdleFrames;
+    result.complete = received == payload;
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t airRate = 100000;
+    if(argc > 1)
+    {
+        airRate = std::strtoul(argv[1], nullptr, 10);
+    }
+    if(argc > 2)
+    {
+        if(std::strcmp(argv[2], "dma") == 0)
+        {
+            forcedMethod = ForcedMethod::DMA;
+        }
+        else if(std::strcmp(argv[2], "it") == 0)
+        {
+            forcedMethod = ForcedMethod::INTERRUPT;
+        }
+        else
+        {
+            std::fprintf(stderr, "usage: %s [air rate in bps] [dma|it]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    typedef BenchResult (*BenchFunction)(CC1200&, CC1200Sim&);
+    BenchFunction const benches[] = {
+        benchEnqueuePacket,
+        benchTxQueue,
+        benchReceivePacket,
+        benchDrainReceivedPackets,
+        benchRxPool,
+        benchLongPacketRx,
+        benchWriteStream,
+        benchReadStream,
+        benchContinuousTx,
+        benchContinuousRx,
+        benchContinuousTxOneBuffer,
+        benchContinuousTxBuffers,
+        benchContinuousTxFastTask,
+        benchContinuousRxOneBuffer,
+        benchContinuousRxBuffers,
+        benchFramedStreamTx,
+        benchFramedStreamTxHighRate,
+        benchFramedStreamRx
+    };
+
+    std::printf("CC1200 driver host benchmark: air rate %lu bps, packets of %d bytes, streams of %d bytes in %d byte chunks\n",
+                static_cast<unsigned long>(airRate), BENCH_PACKET_LEN, BENCH_STREAM_BYTES, BENCH_STREAM_CHUNK);
+    if(forcedMethod != ForcedMethod::CALIBRATED)
+    {
+        std::printf("FIFO transfers of %d bytes and more forced to %s, with deferred transfers\n", BENCH_FORCED_MIN_LEN,
+                    forcedMethod == ForcedMethod::DMA ? "DMA" : "the SPI interrupt");
+    }
+    std::printf("\n");
+    printHeader();
+
+    int failures = 0;
+    for(BenchFunction bench : benches)
+    {
+        // fresh chip and driver for each path
+        CC1200Sim sim;
+        sim.setAirRate(airRate);
+        CC1200 radio(sim, [](std::string const&) {});
+
+        BenchResult result = bench(radio, sim);
+        printResult(result, sim);
+        if(!result.complete || sim.getStats().busConflicts > 0)
+        {
+            ++failures;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}